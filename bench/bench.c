@@ -0,0 +1,27 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <time.h>
+
+#include "bench.h"
+
+/*
+Returns: Monotonic wall-clock time in seconds
+*/
+double get_seconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+Summary: Adds row with total and per-item time to result table
+*/
+void add_measurement(Table *table, const char *label, size_t num_items, double seconds)
+{
+    add_cell_fmt(table, " %s ", label);
+    add_cell_fmt(table, " %zu ", num_items);
+    add_cell_fmt(table, " %.3f ", seconds * 1e3);
+    add_cell_fmt(table, " %.3f ", num_items == 0 ? 0 : seconds * 1e6 / num_items);
+    next_row(table);
+}
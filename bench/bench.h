@@ -0,0 +1,11 @@
+#pragma once
+#include <stddef.h>
+#include "../src/table/table.h"
+
+typedef struct {
+    void (*run)(Table *table);
+    const char *name;
+} Benchmark;
+
+double get_seconds();
+void add_measurement(Table *table, const char *label, size_t num_items, double seconds);
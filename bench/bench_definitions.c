@@ -0,0 +1,119 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "../src/client/commands/commands.h"
+#include "../src/client/core/arith_context.h"
+#include "bench_definitions.h"
+
+#define NUM_DEFINITIONS 100000
+#define CHUNK_SIZE      10000
+#define NAME_LENGTH     4
+// Each level calls the previous one twice
+#define NUM_NESTED      18
+
+// Writes name of i-th definition, names only consist of letters since digits would end the token
+static void get_name(size_t i, char out_name[NAME_LENGTH + 2])
+{
+    out_name[0] = 'u';
+    for (size_t j = NAME_LENGTH; j > 0; j--)
+    {
+        out_name[j] = 'a' + i % 26;
+        i /= 26;
+    }
+    out_name[NAME_LENGTH + 1] = '\0';
+}
+
+/*
+Summary: Writes definitions [start, start + CHUNK_SIZE) to file
+    Constants, binary functions and functions that call previously defined ones alternate
+*/
+static void write_chunk(FILE *file, size_t start)
+{
+    char name[NAME_LENGTH + 2];
+    char prev_name[NAME_LENGTH + 2];
+    for (size_t i = start; i < start + CHUNK_SIZE; i++)
+    {
+        get_name(i, name);
+        if (i > 0) get_name(i - 1, prev_name);
+        switch (i % 3)
+        {
+            case 0:
+                fprintf(file, "%s = %zu\n", name, i);
+                break;
+            case 1:
+                fprintf(file, "%s(x, y) = x * y + %s\n", name, prev_name);
+                break;
+            default:
+                fprintf(file, "%s(x) = %s(x, 2) - x\n", name, prev_name);
+        }
+    }
+}
+
+/*
+Summary: Loads chunks of generated definitions one after another
+    Time per definition should stay flat as the number of already defined functions grows
+*/
+static void definitions_bench(Table *table)
+{
+    for (size_t start = 0; start < NUM_DEFINITIONS; start += CHUNK_SIZE)
+    {
+        char path[] = "/tmp/ccalc_bench_XXXXXX";
+        char command[sizeof(path) + 10];
+        int fd = mkstemp(path);
+        if (fd == -1) return;
+        sprintf(command, "load %s", path);
+        FILE *file = fdopen(fd, "w");
+        write_chunk(file, start);
+        fclose(file);
+
+        double begin = get_seconds();
+        exec_command(command);
+        double end = get_seconds();
+
+        remove(path);
+
+        char label[50];
+        sprintf(label, "Load %zu-%zu", start, start + CHUNK_SIZE);
+        add_measurement(table, label, CHUNK_SIZE, end - begin);
+    }
+
+    char clear_command[] = "clear";
+    double begin = get_seconds();
+    exec_command(clear_command);
+    add_measurement(table, "Clear all", NUM_DEFINITIONS, get_seconds() - begin);
+
+    // Calls are evaluated without expanding right hand sides, which would grow exponentially
+    char command[100];
+    begin = get_seconds();
+    for (size_t i = 0; i < NUM_NESTED; i++)
+    {
+        if (i == 0)
+        {
+            sprintf(command, "nesta(x) = x^2 + 1");
+        }
+        else
+        {
+            sprintf(command, "nest%c(x) = nest%c(x) - nest%c(x / 2)", (char)('a' + i), (char)('a' + i - 1), (char)('a' + i - 1));
+        }
+        exec_command(command);
+    }
+    add_measurement(table, "Define nested", NUM_NESTED, get_seconds() - begin);
+
+    begin = get_seconds();
+    sprintf(command, "nest%c(3)", (char)('a' + NUM_NESTED - 1));
+    Node *result = NULL;
+    arith_parse_symbolic(command, 0, &result);
+    add_measurement(table, "Evaluate nested", (size_t)1 << (NUM_NESTED - 1), get_seconds() - begin);
+    free_tree(result);
+    exec_command(clear_command);
+}
+
+Benchmark get_definitions_bench()
+{
+    return (Benchmark){
+        .run = definitions_bench,
+        .name = "Definitions"
+    };
+}
@@ -0,0 +1,4 @@
+#pragma once
+#include "bench.h"
+
+Benchmark get_definitions_bench();
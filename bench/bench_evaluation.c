@@ -0,0 +1,251 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/engine/tree/tree_util.h"
+#include "../src/engine/parsing/parser.h"
+#include "../src/client/core/arith_context.h"
+#include "../src/client/core/arith_evaluation.h"
+#include "../src/client/core/bytecode.h"
+#include "../src/client/core/jit.h"
+#include "../src/client/core/gradient.h"
+#include "../tests/fuzzer.h"
+#include "bench_evaluation.h"
+
+#define NUM_TREES       200
+#define MAX_INNER_NODES 20
+#define NUM_BINDINGS    2000
+
+// Same names as used by fuzzer
+#define NUM_VARS 5
+static const char *var_names[] = { "x", "y", "z", "abc", "def" };
+
+// Shapes of typical workloads that are compiled to superinstructions
+#define NUM_EXPRESSIONS 6
+static const char *expressions[] = {
+    "x * y + z",
+    "3 * x + 2 * y - z",
+    "x^2 + y^3",
+    "sin(x) * cos(y)",
+    "abc * x^2 + def * x + z",
+    "exp(-x^2 / 2) / sqrt(2 * pi)"
+};
+
+// Function of all variables whose partial derivatives share subexpressions
+#define GRADIENT_EXPRESSION "exp(-x^2 / 2) * sin(y * z) + abc * def^2 + ln(x^2 + y^2 + z^2 + abc^2 + def^2)"
+
+/*
+Summary: Straightforward recursive evaluation that looks up variables by name
+*/
+static ListenerError tree_walk(const Node *tree, const double *var_values, double *out)
+{
+    switch (get_type(tree))
+    {
+        case NTYPE_CONSTANT:
+            *out = get_const_value(tree);
+            return LISTENERERR_SUCCESS;
+
+        case NTYPE_VARIABLE:
+            for (size_t i = 0; i < NUM_VARS; i++)
+            {
+                if (strcmp(get_var_name(tree), var_names[i]) == 0)
+                {
+                    *out = var_values[i];
+                    return LISTENERERR_SUCCESS;
+                }
+            }
+            return LISTENERERR_VARIABLE_ENCOUNTERED;
+
+        case NTYPE_OPERATOR:
+        {
+            double args[MAX_CHILDREN];
+            for (size_t i = 0; i < get_num_children(tree); i++)
+            {
+                ListenerError err = tree_walk(get_child(tree, i), var_values, &args[i]);
+                if (err != LISTENERERR_SUCCESS) return err;
+            }
+            return arith_op_evaluate(get_op(tree), get_num_children(tree), args, out);
+        }
+    }
+    return LISTENERERR_UNKNOWN_OP;
+}
+
+static double get_binding(size_t i, size_t var)
+{
+    return 0.001 * (double)i + 0.5 * (double)var;
+}
+
+/*
+Summary: Evaluates each program with NUM_BINDINGS different variable bindings, one row at a time
+*/
+static void measure_rows(Table *table, const char *label, size_t num_trees, const Program *programs)
+{
+    double var_values[NUM_VARS];
+    volatile double sink = 0;
+
+    double begin = get_seconds();
+    for (size_t i = 0; i < num_trees; i++)
+    {
+        for (size_t j = 0; j < NUM_BINDINGS; j++)
+        {
+            for (size_t k = 0; k < NUM_VARS; k++) var_values[k] = get_binding(j, k);
+            double res = 0;
+            run_program(&programs[i], var_values, &res);
+            sink += res;
+        }
+    }
+    add_measurement(table, label, num_trees * NUM_BINDINGS, get_seconds() - begin);
+}
+
+/*
+Summary: Evaluates each tree with NUM_BINDINGS different variable bindings by tree walk,
+    by interpreted and native program and column-at-a-time
+*/
+static void measure(Table *table, const char *label, size_t num_trees, Node **trees)
+{
+    double var_values[NUM_VARS];
+    volatile double sink = 0;
+    char row_label[100];
+
+    double begin = get_seconds();
+    for (size_t i = 0; i < num_trees; i++)
+    {
+        for (size_t j = 0; j < NUM_BINDINGS; j++)
+        {
+            for (size_t k = 0; k < NUM_VARS; k++) var_values[k] = get_binding(j, k);
+            double res = 0;
+            tree_walk(trees[i], var_values, &res);
+            sink += res;
+        }
+    }
+    sprintf(row_label, "%s: tree walk", label);
+    add_measurement(table, row_label, num_trees * NUM_BINDINGS, get_seconds() - begin);
+
+    bool prev_jit = set_jit_enabled(false);
+    begin = get_seconds();
+    Program *programs = malloc(num_trees * sizeof(Program));
+    for (size_t i = 0; i < num_trees; i++)
+    {
+        compile_program(trees[i], NUM_VARS, var_names, &programs[i]);
+    }
+    sprintf(row_label, "%s: compile", label);
+    add_measurement(table, row_label, num_trees, get_seconds() - begin);
+
+    set_jit_enabled(true);
+    begin = get_seconds();
+    Program *native_programs = malloc(num_trees * sizeof(Program));
+    for (size_t i = 0; i < num_trees; i++)
+    {
+        compile_program(trees[i], NUM_VARS, var_names, &native_programs[i]);
+    }
+    sprintf(row_label, "%s: compile native", label);
+    add_measurement(table, row_label, num_trees, get_seconds() - begin);
+    set_jit_enabled(prev_jit);
+
+    sprintf(row_label, "%s: program", label);
+    measure_rows(table, row_label, num_trees, programs);
+    sprintf(row_label, "%s: native", label);
+    measure_rows(table, row_label, num_trees, native_programs);
+
+    double *columns = malloc(NUM_VARS * NUM_BINDINGS * sizeof(double));
+    const double *column_ptrs[NUM_VARS];
+    for (size_t k = 0; k < NUM_VARS; k++)
+    {
+        for (size_t j = 0; j < NUM_BINDINGS; j++) columns[k * NUM_BINDINGS + j] = get_binding(j, k);
+        column_ptrs[k] = columns + k * NUM_BINDINGS;
+    }
+    double *results = malloc(NUM_BINDINGS * sizeof(double));
+    ListenerError *errors = malloc(NUM_BINDINGS * sizeof(ListenerError));
+
+    begin = get_seconds();
+    for (size_t i = 0; i < num_trees; i++)
+    {
+        run_program_batch(&programs[i], NUM_BINDINGS, column_ptrs, results, errors);
+        sink += results[0];
+    }
+    sprintf(row_label, "%s: batch", label);
+    add_measurement(table, row_label, num_trees * NUM_BINDINGS, get_seconds() - begin);
+    free(columns);
+    free(results);
+    free(errors);
+
+    for (size_t i = 0; i < num_trees; i++)
+    {
+        free_program(&programs[i]);
+        free_program(&native_programs[i]);
+    }
+    free(programs);
+    free(native_programs);
+}
+
+/*
+Summary: Compares one reverse sweep with one compiled forward mode derivative per variable
+*/
+static void measure_gradient(Table *table)
+{
+    Node *tree = parse_easy(g_ctx, GRADIENT_EXPRESSION);
+    double value = 0;
+    double gradient[NUM_VARS];
+
+    Gradient tape;
+    compile_gradient(tree, NUM_VARS, var_names, &tape);
+    double begin = get_seconds();
+    for (size_t i = 0; i < NUM_BINDINGS; i++)
+    {
+        double bindings[NUM_VARS];
+        for (size_t j = 0; j < NUM_VARS; j++) bindings[j] = get_binding(i, j);
+        run_gradient(&tape, bindings, &value, gradient);
+    }
+    add_measurement(table, "Gradient: reverse mode", NUM_BINDINGS, get_seconds() - begin);
+    free_gradient(&tape);
+
+    const Operator *deriv = ctx_lookup_op(g_ctx, "deriv", OP_PLACE_FUNCTION);
+    Program programs[NUM_VARS];
+    for (size_t i = 0; i < NUM_VARS; i++)
+    {
+        Node *derivative = malloc_operator_node(deriv, 2, 0);
+        set_child(derivative, 0, tree_copy(tree));
+        set_child(derivative, 1, malloc_variable_node(var_names[i], 0, 0));
+        compile_program(derivative, NUM_VARS, var_names, &programs[i]);
+        free_tree(derivative);
+    }
+    begin = get_seconds();
+    for (size_t i = 0; i < NUM_BINDINGS; i++)
+    {
+        double bindings[NUM_VARS];
+        for (size_t j = 0; j < NUM_VARS; j++) bindings[j] = get_binding(i, j);
+        for (size_t j = 0; j < NUM_VARS; j++) run_program(&programs[j], bindings, &gradient[j]);
+    }
+    add_measurement(table, "Gradient: forward mode per variable", NUM_BINDINGS, get_seconds() - begin);
+
+    for (size_t i = 0; i < NUM_VARS; i++) free_program(&programs[i]);
+    free_tree(tree);
+}
+
+static void evaluation_bench(Table *table)
+{
+    Node *trees[NUM_TREES];
+    for (size_t i = 0; i < NUM_TREES; i++)
+    {
+        get_random_tree(MAX_INNER_NODES, &trees[i]);
+    }
+    measure(table, "Random trees", NUM_TREES, trees);
+    for (size_t i = 0; i < NUM_TREES; i++) free_tree(trees[i]);
+
+    for (size_t i = 0; i < NUM_EXPRESSIONS; i++)
+    {
+        trees[i] = parse_easy(g_ctx, expressions[i]);
+    }
+    measure(table, "Workload", NUM_EXPRESSIONS, trees);
+    for (size_t i = 0; i < NUM_EXPRESSIONS; i++) free_tree(trees[i]);
+
+    measure_gradient(table);
+}
+
+Benchmark get_evaluation_bench()
+{
+    return (Benchmark){
+        .run = evaluation_bench,
+        .name = "Evaluation"
+    };
+}
@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../src/client/core/integer_kernels.h"
+#include "../src/client/core/vector_math.h"
+#include "bench_kernels.h"
+
+#define NUM_CALLS 1000000
+// Same size as batches of run_program_batch
+#define ARRAY_SIZE 256
+#define NUM_ARRAYS 4000
+
+// Sum of results keeps calls from being optimized away
+static volatile double sink;
+
+/*
+Summary: Measures integer operators over ranges where the former implementations were slowest,
+    i.e. large Fibonacci numbers, coprime arguments of gcd with large quotients and large factorials
+*/
+static void kernels_bench(Table *table)
+{
+    double sum = 0;
+    double begin = get_seconds();
+    for (size_t i = 0; i < NUM_CALLS; i++) sum += int_fib(i % 1477);
+    add_measurement(table, "fib(0..1476)", NUM_CALLS, get_seconds() - begin);
+
+    begin = get_seconds();
+    for (size_t i = 0; i < NUM_CALLS; i++) sum += int_gcd(1e15 + i, 3 + i % 1000);
+    add_measurement(table, "gcd(1e15 + i, i)", NUM_CALLS, get_seconds() - begin);
+
+    begin = get_seconds();
+    for (size_t i = 0; i < NUM_CALLS; i++) sum += int_gcd((double)rand() * rand(), (double)rand() * rand());
+    add_measurement(table, "gcd(random)", NUM_CALLS, get_seconds() - begin);
+
+    begin = get_seconds();
+    for (size_t i = 0; i < NUM_CALLS; i++) sum += int_factorial(i % 171);
+    add_measurement(table, "(0..170)!", NUM_CALLS, get_seconds() - begin);
+
+    begin = get_seconds();
+    for (size_t i = 0; i < NUM_CALLS; i++) sum += int_binomial(60, i % 61);
+    add_measurement(table, "60 C (0..60)", NUM_CALLS, get_seconds() - begin);
+
+    begin = get_seconds();
+    for (size_t i = 0; i < NUM_CALLS; i++) sum += int_binomial(1000, i % 1001);
+    add_measurement(table, "1000 C (0..1000)", NUM_CALLS, get_seconds() - begin);
+    sink = sum;
+}
+
+/*
+Summary: Measures transcendental functions over arrays with libm and with the SIMD kernels of the processor
+*/
+static void vmath_bench(Table *table)
+{
+    static const char *level_names[] = { "libm", "SSE2", "AVX2" };
+    static const char *func_names[] = { "exp", "ln", "sin", "cos", "atan", "pow" };
+    double x[ARRAY_SIZE];
+    double y[ARRAY_SIZE];
+    double out[ARRAY_SIZE];
+    for (size_t i = 0; i < ARRAY_SIZE; i++)
+    {
+        x[i] = 0.1 + i * 0.05;
+        y[i] = 3.5 - i * 0.02;
+    }
+
+    VmathLevel best = vmath_get_level();
+    for (VmathLevel level = VMATH_SCALAR; level <= best; level++)
+    {
+        vmath_set_level(level);
+        for (size_t func = 0; func < sizeof(func_names) / sizeof(func_names[0]); func++)
+        {
+            double begin = get_seconds();
+            for (size_t i = 0; i < NUM_ARRAYS; i++)
+            {
+                switch (func)
+                {
+                    case 0: vmath_exp(ARRAY_SIZE, x, out); break;
+                    case 1: vmath_ln(ARRAY_SIZE, x, out); break;
+                    case 2: vmath_sin(ARRAY_SIZE, x, out); break;
+                    case 3: vmath_cos(ARRAY_SIZE, x, out); break;
+                    case 4: vmath_atan(ARRAY_SIZE, x, out); break;
+                    default: vmath_pow(ARRAY_SIZE, x, y, out);
+                }
+            }
+            char label[50];
+            sprintf(label, "%s (%s)", func_names[func], level_names[level]);
+            add_measurement(table, label, ARRAY_SIZE * NUM_ARRAYS, get_seconds() - begin);
+        }
+    }
+    vmath_set_level(best);
+}
+
+static void all_kernels_bench(Table *table)
+{
+    kernels_bench(table);
+    vmath_bench(table);
+}
+
+Benchmark get_kernels_bench()
+{
+    return (Benchmark){
+        .run = all_kernels_bench,
+        .name = "Kernels"
+    };
+}
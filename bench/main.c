@@ -0,0 +1,58 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../src/table/table.h"
+#include "../src/client/commands/commands.h"
+#include "../src/client/version.h"
+
+#include "bench.h"
+#include "bench_evaluation.h"
+#include "bench_definitions.h"
+#include "bench_kernels.h"
+
+/*
+Benchmarks are compiled with optimizations, results are printed as a table
+Run with "make bench"
+*/
+
+static const size_t NUM_BENCHMARKS = 3;
+static Benchmark (*benchmark_getters[])() = {
+    get_evaluation_bench,
+    get_definitions_bench,
+    get_kernels_bench
+};
+
+int main()
+{
+    srand(0);
+    init_commands();
+    Table *table = get_empty_table();
+    set_default_alignments(table, 4,
+        (TextAlignment[]){ ALIGN_LEFT, ALIGN_RIGHT, ALIGN_RIGHT, ALIGN_RIGHT });
+    add_cell(table, " Benchmark ");
+    add_cell(table, " Items ");
+    add_cell(table, " Total [ms] ");
+    add_cell(table, " Per item [us] ");
+    override_alignment_of_row(table, ALIGN_CENTER);
+    next_row(table);
+
+    for (size_t i = 0; i < NUM_BENCHMARKS; i++)
+    {
+        Benchmark bench = benchmark_getters[i]();
+        set_hline(table, BORDER_SINGLE);
+        set_span(table, 4, 1);
+        override_alignment(table, ALIGN_CENTER);
+        add_cell_fmt(table, " %s ", bench.name);
+        next_row(table);
+        set_hline(table, BORDER_SINGLE);
+        bench.run(table);
+    }
+
+    make_boxed(table, BORDER_SINGLE);
+    set_all_vlines(table, BORDER_SINGLE);
+    print_table(table);
+    free_table(table);
+    unload_commands();
+    printf("Version: %s\n", CCALC_VERSION);
+    return EXIT_SUCCESS;
+}
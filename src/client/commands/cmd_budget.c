@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "../../util/console_util.h"
+#include "../../util/string_util.h"
+#include "../../util/governor.h"
+#include "../../table/table.h"
+#include "../core/arith_context.h"
+#include "../core/arith_evaluation.h"
+#include "cmd_budget.h"
+
+#define SHOW_CODE 1
+#define SET_CODE  2
+
+#define BUDGET_COMMAND "budget"
+#define NUM_LIMITS 4
+
+static const char *LIMIT_NAMES[NUM_LIMITS] = { "steps", "matchings", "time", "nodes" };
+static const char *LIMIT_DESCRIPTIONS[NUM_LIMITS] = {
+    "Rewrite steps",
+    "Partial matchings",
+    "Seconds",
+    "Live nodes"
+};
+
+int cmd_budget_check(const char *input)
+{
+    if (strcmp(BUDGET_COMMAND, input) == 0) return SHOW_CODE;
+    if (begins_with(BUDGET_COMMAND " ", input)) return SET_CODE;
+    return false;
+}
+
+static double get_limit(const Budget *budget, size_t index)
+{
+    switch (index)
+    {
+        case 0:  return (double)budget->max_rewrite_steps;
+        case 1:  return (double)budget->max_matchings;
+        case 2:  return budget->max_seconds;
+        default: return (double)budget->max_nodes;
+    }
+}
+
+static void set_limit(Budget *budget, size_t index, double value)
+{
+    switch (index)
+    {
+        case 0:  budget->max_rewrite_steps = (size_t)value; break;
+        case 1:  budget->max_matchings = (size_t)value; break;
+        case 2:  budget->max_seconds = value; break;
+        default: budget->max_nodes = (size_t)value;
+    }
+}
+
+static void print_budget()
+{
+    Budget budget = governor_get_budget();
+    Table *table = get_empty_table();
+    add_cell(table, " Limit ");
+    add_cell(table, " Name ");
+    add_cell(table, " Per command ");
+    next_row(table);
+    set_hline(table, BORDER_SINGLE);
+    for (size_t i = 0; i < NUM_LIMITS; i++)
+    {
+        add_cell_fmt(table, " %s ", LIMIT_DESCRIPTIONS[i]);
+        add_cell_fmt(table, " %s ", LIMIT_NAMES[i]);
+        double limit = get_limit(&budget, i);
+        if (limit == 0)
+        {
+            add_cell(table, " unlimited ");
+        }
+        else
+        {
+            add_cell_fmt(table, " %g ", limit);
+        }
+        next_row(table);
+    }
+    set_default_alignments(table, 3, (TextAlignment[]){ ALIGN_LEFT, ALIGN_LEFT, ALIGN_RIGHT });
+    make_boxed(table, BORDER_SINGLE);
+    print_table(table);
+    free_table(table);
+}
+
+/*
+Summary: Shows or sets limits of resources of each command, a command that exceeds them stops with a partially
+    simplified result or an error instead of running unbounded
+    Syntax: budget [steps|matchings|time|nodes <limit>], limit 0 is unlimited
+*/
+bool cmd_budget_exec(char *input, int code)
+{
+    if (code == SHOW_CODE)
+    {
+        print_budget();
+        return true;
+    }
+
+    char *name = input + strlen(BUDGET_COMMAND) + 1;
+    char *limit_input = strchr(name, ' ');
+    if (limit_input != NULL)
+    {
+        *limit_input = '\0';
+        limit_input++;
+    }
+
+    size_t index = 0;
+    while (index < NUM_LIMITS && strcmp(LIMIT_NAMES[index], name) != 0) index++;
+    if (index == NUM_LIMITS || limit_input == NULL)
+    {
+        report_error_at(strlen(BUDGET_COMMAND) + 1, strlen(name),
+            "Error: Expected steps, matchings, time or nodes followed by limit\n");
+        return false;
+    }
+
+    size_t prompt_len = (size_t)(limit_input - input);
+    Node *limit_node = NULL;
+    if (!arith_parse(limit_input, prompt_len, &limit_node)) return false;
+    double limit = 0;
+    if (count_all_variable_nodes(limit_node) > 0
+        || tree_reduce(limit_node, arith_op_evaluate, &limit, NULL) != LISTENERERR_SUCCESS
+        || limit < 0)
+    {
+        report_error_at(prompt_len, strlen(limit_input), "Error: Limit must be a non-negative constant\n");
+        free_tree(limit_node);
+        return false;
+    }
+    free_tree(limit_node);
+
+    Budget budget = governor_get_budget();
+    set_limit(&budget, index, limit);
+    governor_set_budget(budget);
+    if (limit == 0)
+    {
+        whisper("%s are unlimited\n", LIMIT_DESCRIPTIONS[index]);
+    }
+    else
+    {
+        whisper("%s are limited to %g per command\n", LIMIT_DESCRIPTIONS[index], get_limit(&budget, index));
+    }
+    return true;
+}
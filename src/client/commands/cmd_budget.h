@@ -0,0 +1,5 @@
+#pragma once
+#include <stdbool.h>
+
+int cmd_budget_check(const char *input);
+bool cmd_budget_exec(char *input, int code);
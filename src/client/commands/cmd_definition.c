@@ -3,6 +3,7 @@
 
 #include "../../util/string_util.h"
 #include "../../util/console_util.h"
+#include "../../util/alloc_wrappers.h"
 #include "../../engine/tree/node.h"
 #include "../../engine/tree/tree_util.h"
 #include "../../engine/parsing/tokenizer.h"
@@ -11,6 +12,7 @@
 
 #include "cmd_definition.h"
 #include "../core/arith_context.h"
+#include "../core/plugins.h"
 
 #define DEFINITION_OP   "="
 
@@ -66,13 +68,90 @@ static bool do_left_checks(Node *left_n, int strlen)
     return true;
 }
 
-static bool add_function(char *name, char *left, char *right, bool is_constant)
+/*
+Summary: Determines number of parameters of "name(var_1, ..., var_n)" by counting top-level delimiters
+Params
+    tokens:     Tokens of left side of definition
+    name_index: Index of name token
+Returns: Number of parameters, 0 when no parameter list or an empty one follows the name
+*/
+static size_t count_parameters(const Vector *tokens, size_t name_index)
+{
+    size_t depth = 0;
+    size_t num_delimiters = 0;
+    bool empty = true;
+    for (size_t i = name_index + 1; i < vec_count(tokens); i++)
+    {
+        const char *token = *(const char**)vec_get(tokens, i);
+        if (is_space(token[0])) continue;
+
+        if (depth == 0 && !is_opening_parenthesis(token)) break;
+
+        if (is_opening_parenthesis(token))
+        {
+            depth++;
+            if (depth == 1) continue;
+        }
+        else if (is_closing_parenthesis(token))
+        {
+            depth--;
+            if (depth == 0) break;
+        }
+        else if (depth == 1 && is_delimiter(token))
+        {
+            num_delimiters++;
+            continue;
+        }
+        empty = false;
+    }
+    return empty ? 0 : num_delimiters + 1;
+}
+
+// Returns number of tokens that are not whitespace
+static size_t count_non_space_tokens(const Vector *tokens)
+{
+    size_t res = 0;
+    for (size_t i = 0; i < vec_count(tokens); i++)
+    {
+        if (!is_space((*(const char**)vec_get(tokens, i))[0])) res++;
+    }
+    return res;
+}
+
+/*
+Summary: Checks that nothing but an empty parameter list "()" follows the name token
+*/
+static bool is_followed_by_empty_list(const Vector *tokens, size_t name_index)
+{
+    const char *expected[] = { "(", ")" };
+    size_t num_matched = 0;
+    for (size_t i = name_index + 1; i < vec_count(tokens); i++)
+    {
+        const char *token = *(const char**)vec_get(tokens, i);
+        if (is_space(token[0])) continue;
+        if (num_matched == 2 || strcmp(token, expected[num_matched]) != 0) return false;
+        num_matched++;
+    }
+    return num_matched == 2;
+}
+
+/*
+Summary: Adds function operator with its final arity and the rule that eliminates it
+    The left side is tokenized exactly once and the operator is added exactly once,
+    so the cost of a definition does not grow with the number of functions already defined
+Params
+    tokens:     Tokens of left side, ownership is passed to this function
+    name_index: Index of name token in tokens
+*/
+static bool add_function(Vector tokens, size_t name_index, char *left, char *right)
 {
+    const char *name_token = *(const char**)vec_get(&tokens, name_index);
+
     // First check if function already exists
-    const Operator *op = ctx_lookup_op(g_ctx, name, OP_PLACE_FUNCTION);
+    const Operator *op = ctx_lookup_op(g_ctx, name_token, OP_PLACE_FUNCTION);
     if (op != NULL)
     {
-        if (op->id < NUM_ARITH_OPS)
+        if (op->id < NUM_ARITH_OPS || is_plugin_op(op))
         {
             report_error(ERR_BUILTIN_REDEFINITION);
         }
@@ -80,30 +159,46 @@ static bool add_function(char *name, char *left, char *right, bool is_constant)
         {
             report_error(ERR_REDEFINITION);
         }
-        
+
         // Don't goto error since no new operator has been added to context
-        free(name);
+        free_tokens(&tokens);
         return false;
     }
 
-    // Add function operator to parse left input
-    // Must be OP_DYNAMIC_ARITY because we do not know the actual arity yet
+    // Name of operator must outlive tokens
+    char *name = malloc_wrapper(strlen(name_token) + 1);
+    strcpy(name, name_token);
+
     ParsingResult left_result = { .error = PERR_NULL };
     ParsingResult right_result = { .error = PERR_NULL };
     const Operator *new_op = NULL;
+    size_t num_left_tokens = vec_count(&tokens);
+    bool is_constant = count_non_space_tokens(&tokens) == 1;
 
-    // To successfully parse inputs like "x = 5", we can't add a function with dynamic arity because
-    // the user would have to type "x() = 5" since dynamic arity functions require parameter lists
-    if (!is_constant)
+    // To successfully parse inputs like "x = 5", constants are added without parameter list
+    if (is_constant)
     {
-        ctx_add_op(g_ctx, op_get_function(name, OP_DYNAMIC_ARITY));
+        new_op = ctx_add_op(g_ctx, op_get_constant(name));
     }
     else
     {
-        new_op = ctx_add_op(g_ctx, op_get_constant(name));
+        size_t arity = count_parameters(&tokens, name_index);
+        if (arity == 0)
+        {
+            // "x() = 5" defines a constant as well, only its name is parsed
+            if (!is_followed_by_empty_list(&tokens, name_index))
+            {
+                report_error_at(0, strlen(left), ERR_NOT_A_FUNC);
+                free_tokens(&tokens);
+                free(name);
+                return false;
+            }
+            num_left_tokens = name_index + 1;
+        }
+        new_op = ctx_add_op(g_ctx, op_get_function(name, arity));
     }
 
-    if (!arith_parse_raw(left, 0, &left_result))
+    if (!arith_parse_tokens_raw(tokens, num_left_tokens, 0, &left_result))
     {
         goto error;
     }
@@ -114,16 +209,6 @@ static bool add_function(char *name, char *left, char *right, bool is_constant)
         goto error;
     }
 
-    // Assign correct arity:
-    // Since operators are const, we can't change the arity directly
-    // A new operator with correct arity has to be created
-    if (!is_constant)
-    {
-        ctx_delete_op(g_ctx, name, OP_PLACE_FUNCTION);
-        new_op = ctx_add_op(g_ctx, op_get_function(name, get_num_children(left_result.tree)));
-        set_op(left_result.tree, new_op);
-    }
-
     // Parse right expression raw to detect a recursive definition
     if (!arith_parse_raw(right, (size_t)(right - left), &right_result))
     {
@@ -192,52 +277,25 @@ bool cmd_definition_exec(char *input, __attribute__((unused)) int code)
     *right_input = '\0';
     right_input += strlen(DEFINITION_OP);
     
-    // Tokenize function definition to get its name. Name is first token.
+    // Tokenize function definition once, tokens are reused to parse left side
     Vector tokens;
-    tokenize(input, &g_ctx->keywords_trie, &tokens);
+    tokenize(input, g_ctx, &tokens);
     
     // Function name is first token that is not a space
-    char *name = NULL;
-    size_t non_space_tokens = 0;
-    for (size_t i = 0; i < vec_count(&tokens); i++)
+    size_t name_index = 0;
+    while (name_index < vec_count(&tokens) && is_space((*(char**)vec_get(&tokens, name_index))[0]))
     {
-        char *token = *(char**)vec_get(&tokens, i);
-        if (is_space(token[0]))
-        {
-            free(token);
-        }
-        else
-        {
-            non_space_tokens++;
-            if (name == NULL)
-            {
-                name = token;
-            }
-            else
-            {
-                free(token);
-            }
-        }
+        name_index++;
     }
 
-    vec_destroy(&tokens);
-
-    if (name == NULL)
+    if (name_index == vec_count(&tokens) || !is_letter((*(char**)vec_get(&tokens, name_index))[0]))
     {
+        free_tokens(&tokens);
         report_error_at(0, strlen(input), ERR_NOT_A_FUNC);
         return false;
     }
     else
     {
-        if (!is_letter(name[0]))
-        {
-            free(name);
-            report_error_at(0, strlen(input), ERR_NOT_A_FUNC);
-            return false;
-        }
-        else
-        {
-            return add_function(name, input, right_input, non_space_tokens == 1);
-        }
+        return add_function(tokens, name_index, input, right_input);
     }
 }
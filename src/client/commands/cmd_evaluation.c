@@ -10,25 +10,65 @@
 #include "../core/arith_context.h"
 #include "../core/history.h"
 #include "../core/arith_evaluation.h"
+#include "../core/result_cache.h"
 
 int cmd_evaluation_check(__attribute__((unused)) const char *input)
 {
     return true;
 }
 
+/*
+Summary: Expands all calls of user-defined functions in copy of tree
+Returns: Copy, or NULL if result of tree can not be cached since it contains variables or depends on history or rand
+*/
+static Node *get_cache_key(const Node *tree)
+{
+        Node *key = tree_copy(tree);
+        expand_composite_functions(&key, true);
+        if (count_all_variable_nodes(key) > 0 || !is_pure_tree(key))
+        {
+                free_tree(key);
+                return NULL;
+        }
+        return key;
+}
+
 /*
 Summary: The evaluation command is executed when input is no other command (hence last in command array in commands.c)
+    Results of expressions without variables are cached, they are looked up before the expression is simplified
 */
 bool cmd_evaluation_exec(char *input, __attribute__((unused)) int code)
 {
+        ParsingResult res;
+        if (!arith_parse_raw(input, 0, &res)) return false;
+
         Node *node;
-        if (!arith_parse(input, 0, &node)) return false;
+        Node *key = get_cache_key(res.tree);
+        double cached = 0;
+        if (key != NULL && result_cache_lookup(key, &cached))
+        {
+                free_tree(key);
+                key = NULL;
+                free_result(&res, true);
+                node = malloc_constant_node(cached, 0);
+        }
+        else if (!arith_postprocess_symbolic(&res, 0, &node))
+        {
+                free_tree(key);
+                return false;
+        }
+
         whisper("= ");
         print_tree(node, true);
         printf("\n");
         if (get_type(node) == NTYPE_CONSTANT)
         {
-            history_add(get_const_value(node));
+                history_add(get_const_value(node));
+                if (key != NULL) result_cache_insert(key, get_const_value(node));
+        }
+        else
+        {
+                free_tree(key);
         }
         free_tree(node);
         return true;
@@ -0,0 +1,60 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "../../util/console_util.h"
+#include "../../util/string_util.h"
+#include "../../util/string_builder.h"
+#include "../core/c_export.h"
+#include "cmd_export.h"
+
+#define COMMAND   "export "
+#define C_COMMAND "export c "
+
+#define BUILDER_STARTSIZE 1024
+
+int cmd_export_check(const char *input)
+{
+    return begins_with(COMMAND, input);
+}
+
+/*
+Summary: Writes user-defined functions and constants as C module to file
+*/
+bool cmd_export_exec(char *input, __attribute__((unused)) int code)
+{
+    if (!begins_with(C_COMMAND, input))
+    {
+        report_error("Error: Unknown format. Syntax is:\n"
+            "export c <path>\n");
+        return false;
+    }
+
+    char *path = strip(input + strlen(C_COMMAND));
+    StringBuilder builder = strbuilder_create(BUILDER_STARTSIZE);
+    // File is only created when all functions can be exported
+    if (!export_c_module(&builder))
+    {
+        vec_destroy(&builder);
+        return false;
+    }
+
+    FILE *file = fopen(path, "w");
+    if (file == NULL)
+    {
+        report_error("Error writing file: %s\n", strerror(errno));
+        vec_destroy(&builder);
+        return false;
+    }
+    bool written = fputs(builder.buffer, file) != EOF;
+    written = fclose(file) == 0 && written;
+    vec_destroy(&builder);
+    if (!written)
+    {
+        report_error("Error writing file: %s\n", strerror(errno));
+        return false;
+    }
+
+    whisper("Exported functions to %s\n", path);
+    return true;
+}
@@ -0,0 +1,5 @@
+#pragma once
+#include <stdbool.h>
+
+int cmd_export_check(const char *input);
+bool cmd_export_exec(char *input, int code);
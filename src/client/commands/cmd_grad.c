@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "../../util/console_util.h"
+#include "../../util/string_util.h"
+#include "../../util/string_builder.h"
+#include "../../engine/tree/tree_to_string.h"
+#include "../../table/table.h"
+#include "../core/arith_context.h"
+#include "../core/arith_evaluation.h"
+#include "../core/gradient.h"
+#include "cmd_grad.h"
+
+#define GRAD_COMMAND "grad "
+#define DOUBLE_FMT   "%-.10f"
+#define STRBUILDER_STARTSIZE 16
+
+int cmd_grad_check(const char *input)
+{
+    return begins_with(GRAD_COMMAND, input);
+}
+
+/*
+Summary: Parses point as arguments of a call of function, so that the parser checks the number of arguments
+Params
+    out_values: Value of i-th argument is written to out_values[i]
+*/
+static bool parse_point(const char *name, char *point, size_t prompt_len, double *out_values)
+{
+    Vector builder = strbuilder_create(STRBUILDER_STARTSIZE);
+    strbuilder_append(&builder, "%s(%s)", name, point);
+
+    ParsingResult result;
+    bool success = arith_parse_raw(builder.buffer, prompt_len - strlen(name) - 1, &result);
+    vec_destroy(&builder);
+    if (!success) return false;
+
+    for (size_t i = 0; i < get_num_children(result.tree); i++)
+    {
+        const Node *arg = get_child(result.tree, i);
+        if (count_all_variable_nodes(arg) > 0
+            || tree_reduce(arg, arith_op_evaluate, &out_values[i], NULL) != LISTENERERR_SUCCESS)
+        {
+            report_error_at(prompt_len, strlen(point), "Error: Coordinates must be constants\n");
+            success = false;
+            break;
+        }
+    }
+    free_result(&result, true);
+    return success;
+}
+
+/*
+Summary: Prints value and all partial derivatives of a user-defined function at a point,
+    computed by one evaluation and one backward sweep (see tree_gradient)
+    Syntax: grad <func> ; <x0>, <y0>, ...
+*/
+bool cmd_grad_exec(char *input, __attribute__((unused)) int code)
+{
+    char *args[2];
+    if (str_split(input + strlen(GRAD_COMMAND), args, 1, ";") != 2)
+    {
+        report_error("Error: Invalid syntax. Syntax is:\n"
+            "grad <func> ; <x0>, <y0>, ...\n");
+        return false;
+    }
+    char *name = strip(args[0]);
+    char *point = strip(args[1]);
+
+    const Operator *op = ctx_lookup_op(g_ctx, name, OP_PLACE_FUNCTION);
+    RewriteRule *function = op == NULL ? NULL : get_composite_function(op);
+    if (function == NULL)
+    {
+        report_error_at(name - input, strlen(name), "Error: Unknown user-defined function\n");
+        return false;
+    }
+
+    size_t num_params = get_num_children(function->pattern.pattern);
+    const char *params[MAX_CHILDREN];
+    double values[MAX_CHILDREN];
+    double gradient[MAX_CHILDREN];
+    for (size_t i = 0; i < num_params; i++)
+    {
+        params[i] = get_var_name(get_child(function->pattern.pattern, i));
+    }
+    if (!parse_point(name, point, (size_t)(point - input), values)) return false;
+
+    double value = 0;
+    ListenerError err = tree_gradient(function->after, num_params, params, values, &value, gradient);
+    if (err != LISTENERERR_SUCCESS)
+    {
+        report_error("Error: %s\n", listenererr_to_str(err));
+        return false;
+    }
+
+    whisper("%s(%s) = ", name, point);
+    printf(CONSTANT_TYPE_FMT "\n", value);
+    Table *table = get_empty_table();
+    if (is_interactive())
+    {
+        add_cell(table, " Parameter ");
+        add_cell(table, " Partial derivative ");
+        next_row(table);
+        set_hline(table, BORDER_SINGLE);
+    }
+    for (size_t i = 0; i < num_params; i++)
+    {
+        add_cell_fmt(table, " %s ", params[i]);
+        add_cell_fmt(table, " " DOUBLE_FMT " ", gradient[i]);
+        next_row(table);
+    }
+    if (is_interactive()) make_boxed(table, BORDER_SINGLE);
+    print_table(table);
+    free_table(table);
+    return true;
+}
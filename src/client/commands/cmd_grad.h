@@ -0,0 +1,5 @@
+#pragma once
+#include <stdbool.h>
+
+int cmd_grad_check(const char *input);
+bool cmd_grad_exec(char *input, int code);
@@ -36,12 +36,28 @@ static const char *LICENSE =
     "You should have received a copy of the GNU General Public License\n"
     "along with this program.  If not, see <https://www.gnu.org/licenses/>.\n";
 
-#define NUM_COMMANDS 9
+#define NUM_COMMANDS 20
 static const char *COMMAND_TABLE[NUM_COMMANDS][2] = {
     { "<func|const> = <after>",                  "Adds function or constant" },
     { "table <expr> ; <from> ; <to> ; <step>  \n"
-      "   [fold <expr> ; <init>]",               "Prints table of values" },
-    { "load [simplification] <path>",            "Executes commands or loads simplification ruleset in file" },
+      "   [fold <expr> ; <init>]\n"
+      "   [> [header] <path>]",                  "Prints table of values or writes it as binary file" },
+    { "table <expr> ; <var>: <from> ; <to> ;  \n"
+      "   <step> [; <var>: ...]",                "Prints values for all combinations of variables" },
+    { "threads [<n>]",                           "Shows or sets number of worker threads" },
+    { "budget [steps|matchings|time|nodes  \n"
+      "   <n>]",                                 "Shows or sets limits of resources per command" },
+    { "export c <path>",                         "Writes functions and constants as C module" },
+    { "memo [<func> [<capacity>]]",              "Shows caches or caches results of a function" },
+    { "grad <func> ; <x0>, <y0>, ...",           "Computes all partial derivatives of a function at a point" },
+    { "series <expr> ; <var> ; <from> ; <to>",   "Sums expression for var = from, from + 1, ..., to" },
+    { "integrate <expr> ; <var> ; <a> ; <b>  \n"
+      "   [; <tol>]",                            "Computes definite integral numerically" },
+    { "solve <expr> ; <var> ; <x0>",             "Searches root of expression near x0" },
+    { "montecarlo <expr> ; <samples>  \n"
+      "   [; <seed>]",                           "Computes mean and variance of random expression" },
+    { "map <expr> < <path>",                     "Appends value of expression to each row of CSV file" },
+    { "load [simplification|plugin] <path>",     "Executes commands or loads simplification ruleset or plugin" },
     { "clear [<func>]",                          "Clears all or one function or constant" },
     { "help [operators]",                        "Shows this message or a verbose list of all operators" },
     { "license",                                 "Shows information about ccalc's license" },
@@ -176,7 +192,7 @@ static int print_op(Operator *op)
 static void print_ops_between(size_t start, size_t end)
 {
     int remaining_width = TTY_WIDTH;
-    ListNode *curr = list_get_node(&g_ctx->op_list, start);
+    ListNode *curr = list_get_node(&g_builtin_ctx->op_list, start);
     while (curr != NULL && start != end)
     {
         Operator *op = (Operator*)curr->data;
@@ -204,7 +220,7 @@ static void print_op_table(OpPlacement place, bool assoc, bool precedence, bool
     add_cell(table, " Description ");
     next_row(table);
 
-    ListNode *curr = list_get_node(&g_ctx->op_list, PSEUDO_IND);
+    ListNode *curr = list_get_node(&g_builtin_ctx->op_list, PSEUDO_IND);
     size_t index = PSEUDO_IND;
     while (curr != NULL && index < LAST_IND)
     {
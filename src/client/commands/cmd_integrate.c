@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "../../util/console_util.h"
+#include "../../util/string_util.h"
+#include "../../engine/tree/tree_to_string.h"
+#include "../core/arith_context.h"
+#include "../core/arith_evaluation.h"
+#include "../core/history.h"
+#include "../core/bytecode.h"
+#include "../core/integration.h"
+#include "cmd_table.h"
+#include "cmd_integrate.h"
+
+#define INTEGRATE_COMMAND "integrate "
+#define DEFAULT_TOLERANCE 1e-10
+
+int cmd_integrate_check(const char *input)
+{
+    return begins_with(INTEGRATE_COMMAND, input);
+}
+
+/*
+Summary: Computes definite integral of expression by adaptive quadrature
+    Syntax: integrate <expr> ; <var> ; <a> ; <b> [; <tol>]
+*/
+bool cmd_integrate_exec(char *input, __attribute__((unused)) int code)
+{
+    char *args[5];
+    size_t num_args = str_split(input + strlen(INTEGRATE_COMMAND), args, 4, ";", ";", ";", ";");
+    if (num_args != 4 && num_args != 5)
+    {
+        report_error("Error: Invalid syntax. Syntax is:\n"
+            "integrate <expr> ; <var> ; <a> ; <b> [; <tol>]\n");
+        return false;
+    }
+
+    for (size_t i = 0; i < num_args; i++)
+    {
+        args[i] = strip(args[i]);
+    }
+
+    bool success = false;
+    Node *expr = NULL;
+    Node *var_node = NULL;
+    double a = 0;
+    double b = 0;
+    double tol = DEFAULT_TOLERANCE;
+    if (!parse_expr_of_var(input, args[0], args[1], &expr, &var_node)
+        || !parse_constant(input, args[2], &a)
+        || !parse_constant(input, args[3], &b)
+        || (num_args == 5 && !parse_constant(input, args[4], &tol)))
+    {
+        goto exit;
+    }
+    const char *var = get_var_name(var_node);
+
+    if (!isfinite(a) || !isfinite(b))
+    {
+        report_error("Error: Bounds must be finite\n");
+        goto exit;
+    }
+    if (!(tol > 0) || !isfinite(tol))
+    {
+        report_error_at(args[4] - input, strlen(args[4]), "Error: Tolerance must be positive\n");
+        goto exit;
+    }
+
+    Program program;
+    if (!compile_program(expr, 1, &var, &program))
+    {
+        report_error_at(args[0] - input, strlen(args[0]), "Error: Expression can not be compiled\n");
+        goto exit;
+    }
+    IntegrationResult result = integrate_program(&program, a, b, tol);
+    free_program(&program);
+
+    if (result.eval_error != LISTENERERR_SUCCESS)
+    {
+        report_error("Error: %s for %s = " CONSTANT_TYPE_FMT "\n",
+            listenererr_to_str(result.eval_error), var, result.error_point);
+        goto exit;
+    }
+
+    whisper("= ");
+    printf(CONSTANT_TYPE_FMT "\n", result.integral);
+    printf("Estimated error: %g, evaluations: %zu\n", result.error, result.num_evaluations);
+    if (!result.converged)
+    {
+        report_error("Tolerance not reached, result is best estimate\n");
+    }
+    history_add(result.integral);
+    success = true;
+
+    exit:
+    free_tree(expr);
+    free_tree(var_node);
+    return success;
+}
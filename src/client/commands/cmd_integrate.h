@@ -0,0 +1,5 @@
+#pragma once
+#include <stdbool.h>
+
+int cmd_integrate_check(const char *input);
+bool cmd_integrate_exec(char *input, int code);
@@ -6,11 +6,13 @@
 #include "../../util/console_util.h"
 #include "../../util/string_util.h"
 #include "../simplification/simplification.h"
+#include "../core/plugins.h"
 #include "cmd_load.h"
 #include "commands.h"
 
 #define COMMAND "load "
 #define LOAD_SIMPLIFICATION "load simplification "
+#define LOAD_PLUGIN         "load plugin "
 
 int cmd_load_check(const char *input)
 {
@@ -18,7 +20,7 @@ int cmd_load_check(const char *input)
 }
 
 /*
-Summary: Opens file and processes its content as from stdin
+Summary: Opens file and processes its content as from stdin, or loads simplification ruleset or plugin
 */
 bool cmd_load_exec(char *input, __attribute__((unused)) int code)
 {
@@ -38,6 +40,13 @@ bool cmd_load_exec(char *input, __attribute__((unused)) int code)
             return true;
         }
     }
+    else if (begins_with(LOAD_PLUGIN, input))
+    {
+        ssize_t count = load_plugin(input + strlen(LOAD_PLUGIN));
+        if (count == -1) return false;
+        whisper("Successfully loaded plugin (%ld operators)\n", count);
+        return true;
+    }
     else
     {
         // Normal load command
@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "../../util/console_util.h"
+#include "../../util/string_util.h"
+#include "../../util/string_builder.h"
+#include "../../util/governor.h"
+#include "../../engine/tree/tree_to_string.h"
+#include "../../engine/tree/tree_util.h"
+#include "../core/arith_context.h"
+#include "../core/bytecode.h"
+#include "../core/csv.h"
+#include "cmd_map.h"
+
+#define MAP_COMMAND "map "
+#define STRBUILDER_STARTSIZE 32
+
+int cmd_map_check(const char *input)
+{
+    return begins_with(MAP_COMMAND, input);
+}
+
+/*
+Summary: Binds each variable of expression to column of header with same name
+Returns: False if a variable has no column, error has been reported then
+*/
+static bool find_columns(char *header, char delimiter, size_t num_vars, const char **vars, size_t *out_columns)
+{
+    char *names[CSV_MAX_COLUMNS];
+    size_t num_columns = csv_split(header, delimiter, CSV_MAX_COLUMNS, names);
+    if (num_columns > CSV_MAX_COLUMNS) num_columns = CSV_MAX_COLUMNS;
+
+    for (size_t i = 0; i < num_vars; i++)
+    {
+        out_columns[i] = num_columns;
+        for (size_t j = 0; j < num_columns; j++)
+        {
+            if (strcmp(strip(names[j]), vars[i]) == 0)
+            {
+                out_columns[i] = j;
+                break;
+            }
+        }
+        if (out_columns[i] == num_columns)
+        {
+            report_error("Error: No column named '%s'\n", vars[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+Summary: Evaluates expression for each row of CSV or TSV file and prints rows with result appended
+    Variables of expression are bound to columns of the same name in header row
+    Syntax: map <expr> < <path>
+*/
+bool cmd_map_exec(char *input, __attribute__((unused)) int code)
+{
+    char *args[2];
+    if (str_split(input + strlen(MAP_COMMAND), args, 1, "<") != 2)
+    {
+        report_error("Error: Invalid syntax. Syntax is:\n"
+            "map <expr> < <path>\n");
+        return false;
+    }
+    args[0] = strip(args[0]);
+    args[1] = strip(args[1]);
+
+    Node *expr = NULL;
+    if (!arith_parse(args[0], (size_t)(args[0] - input), &expr)) return false;
+
+    const char *vars[CSV_MAX_COLUMNS];
+    bool sufficient = false;
+    size_t num_vars = list_variables(expr, CSV_MAX_COLUMNS, vars, &sufficient);
+    if (!sufficient)
+    {
+        report_error_at(args[0] - input, strlen(args[0]), "Error: More than %d variables\n", CSV_MAX_COLUMNS);
+        free_tree(expr);
+        return false;
+    }
+
+    FILE *file = fopen(args[1], "r");
+    if (file == NULL)
+    {
+        report_error("Error reading file: %s\n", strerror(errno));
+        free_tree(expr);
+        return false;
+    }
+
+    bool success = false;
+    CsvReader reader = csv_create_reader(file);
+    char *header = csv_read_line(&reader);
+    if (header == NULL)
+    {
+        report_error("Error: File has no header row\n");
+        goto exit;
+    }
+
+    Program program;
+    if (!compile_program(expr, num_vars, vars, &program))
+    {
+        report_error_at(args[0] - input, strlen(args[0]), "Error: Expression can not be compiled\n");
+        goto exit;
+    }
+
+    // Header is split in place, thus copied to write it back
+    char delimiter = csv_detect_delimiter(header);
+    Vector builder = strbuilder_create(STRBUILDER_STARTSIZE);
+    strbuilder_append(&builder, "%s", header);
+    size_t columns[CSV_MAX_COLUMNS];
+    if (!find_columns(header, delimiter, num_vars, vars, columns))
+    {
+        vec_destroy(&builder);
+        free_program(&program);
+        goto exit;
+    }
+    fputs(builder.buffer, stdout);
+    fputc(delimiter, stdout);
+    strbuilder_clear(&builder);
+    tree_to_strbuilder(&builder, expr, false);
+    csv_write_field(stdout, builder.buffer, delimiter);
+    vec_destroy(&builder);
+    fputc('\n', stdout);
+
+    CsvMapResult result;
+    bool written = csv_map(&reader, stdout, delimiter, &program, columns, &result);
+    free_program(&program);
+    if (ferror(file) || !written)
+    {
+        report_error("Error: %s\n", strerror(errno));
+        goto exit;
+    }
+    if (governor_is_stopped())
+    {
+        report_error("Error: %s after %zu rows\n", governor_state_to_str(governor_get_state()), result.num_rows);
+        goto exit;
+    }
+
+    whisper("%zu rows, %zu errors\n", result.num_rows, result.num_errors);
+    success = true;
+
+    exit:
+    csv_free_reader(&reader);
+    fclose(file);
+    free_tree(expr);
+    return success;
+}
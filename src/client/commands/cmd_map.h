@@ -0,0 +1,5 @@
+#pragma once
+#include <stdbool.h>
+
+int cmd_map_check(const char *input);
+bool cmd_map_exec(char *input, int code);
@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "../../util/console_util.h"
+#include "../../util/string_util.h"
+#include "../../util/linked_list.h"
+#include "../../table/table.h"
+#include "../core/arith_context.h"
+#include "../core/arith_evaluation.h"
+#include "../core/result_cache.h"
+#include "cmd_memo.h"
+
+#define SHOW_CODE 1
+#define SET_CODE  2
+
+#define MEMO_COMMAND "memo"
+
+int cmd_memo_check(const char *input)
+{
+    if (strcmp(MEMO_COMMAND, input) == 0) return SHOW_CODE;
+    if (begins_with(MEMO_COMMAND " ", input)) return SET_CODE;
+    return false;
+}
+
+/*
+Summary: Prints capacity, size and hit/miss counters of every cache of function results and of cache of results
+    of expressions without variables
+*/
+static void print_memos()
+{
+    Table *table = get_empty_table();
+    add_cell(table, " Function ");
+    add_cell(table, " Capacity ");
+    add_cell(table, " Cached ");
+    add_cell(table, " Hits ");
+    add_cell(table, " Misses ");
+    next_row(table);
+    set_hline(table, BORDER_SINGLE);
+
+    size_t num_memos = 0;
+    for (ListNode *curr = g_composite_functions->first; curr != NULL; curr = curr->next)
+    {
+        const Operator *op = get_op(((RewriteRule*)curr->data)->pattern.pattern);
+        const MemoCache *memo = get_composite_memo(op);
+        if (memo == NULL) continue;
+        add_cell_fmt(table, " %s ", op->name);
+        add_cell_fmt(table, " %zu ", memo->capacity);
+        add_cell_fmt(table, " %zu ", memo->count);
+        add_cell_fmt(table, " %zu ", memo->hits);
+        add_cell_fmt(table, " %zu ", memo->misses);
+        next_row(table);
+        num_memos++;
+    }
+
+    if (num_memos == 0)
+    {
+        printf("No function results are cached\n");
+    }
+    else
+    {
+        set_default_alignments(table, 5,
+            (TextAlignment[]){ ALIGN_LEFT, ALIGN_RIGHT, ALIGN_RIGHT, ALIGN_RIGHT, ALIGN_RIGHT });
+        make_boxed(table, BORDER_SINGLE);
+        print_table(table);
+    }
+    free_table(table);
+
+    ResultCacheStats stats = result_cache_get_stats();
+    printf("Results of expressions: %zu of %zu cached, %zu hits, %zu misses\n",
+        stats.count, stats.capacity, stats.hits, stats.misses);
+}
+
+/*
+Summary: Shows caches of function results or enables, resizes or disables the cache of a function
+    Syntax: memo [<func> [<capacity>]], capacity 0 disables cache
+*/
+bool cmd_memo_exec(char *input, int code)
+{
+    if (code == SHOW_CODE)
+    {
+        print_memos();
+        return true;
+    }
+
+    char *name = input + strlen(MEMO_COMMAND) + 1;
+    char *capacity_input = strchr(name, ' ');
+    if (capacity_input != NULL)
+    {
+        *capacity_input = '\0';
+        capacity_input++;
+    }
+
+    const Operator *op = ctx_lookup_op(g_ctx, name, OP_PLACE_FUNCTION);
+    if (op == NULL || get_composite_function(op) == NULL)
+    {
+        report_error_at(strlen(MEMO_COMMAND) + 1, strlen(name), "Error: Unknown user-defined function\n");
+        return false;
+    }
+
+    double capacity = MEMO_DEFAULT_CAPACITY;
+    if (capacity_input != NULL)
+    {
+        size_t prompt_len = (size_t)(capacity_input - input);
+        Node *capacity_node = NULL;
+        if (!arith_parse(capacity_input, prompt_len, &capacity_node)) return false;
+        if (count_all_variable_nodes(capacity_node) > 0
+            || tree_reduce(capacity_node, arith_op_evaluate, &capacity, NULL) != LISTENERERR_SUCCESS
+            || capacity < 0)
+        {
+            report_error_at(prompt_len, strlen(capacity_input), "Error: Capacity must be a non-negative constant\n");
+            free_tree(capacity_node);
+            return false;
+        }
+        free_tree(capacity_node);
+    }
+
+    if (!set_composite_memo(op, (size_t)capacity))
+    {
+        report_error("Error: Results of %s can not be cached since it depends on history or rand\n", name);
+        return false;
+    }
+    if ((size_t)capacity == 0)
+    {
+        whisper("Results of %s are not cached anymore\n", name);
+    }
+    else
+    {
+        whisper("Caching up to %zu results of %s\n", (size_t)capacity, name);
+    }
+    return true;
+}
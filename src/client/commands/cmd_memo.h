@@ -0,0 +1,5 @@
+#pragma once
+#include <stdbool.h>
+
+int cmd_memo_check(const char *input);
+bool cmd_memo_exec(char *input, int code);
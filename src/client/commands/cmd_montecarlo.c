@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "../../util/console_util.h"
+#include "../../util/string_util.h"
+#include "../../engine/tree/tree_to_string.h"
+#include "../../engine/tree/tree_util.h"
+#include "../core/arith_context.h"
+#include "../core/arith_evaluation.h"
+#include "../core/history.h"
+#include "../core/bytecode.h"
+#include "../core/random.h"
+#include "../core/montecarlo.h"
+#include "cmd_table.h"
+#include "cmd_montecarlo.h"
+
+#define MONTECARLO_COMMAND "montecarlo "
+// Seeds are limited to integers that are exactly representable as double, so that they can be typed in again
+#define MAX_SEED 9007199254740992.0 // 2^53
+
+int cmd_montecarlo_check(const char *input)
+{
+    return begins_with(MONTECARLO_COMMAND, input);
+}
+
+/*
+Summary: Parses argument that needs to be a natural number less than or equal to max
+*/
+static bool parse_natural(char *input, char *arg, double max, double *out)
+{
+    if (!parse_constant(input, arg, out)) return false;
+    if (!(*out >= 0) || *out > max || *out != trunc(*out))
+    {
+        report_error_at(arg - input, strlen(arg), "Error: Must be a natural number less than %g\n", max);
+        return false;
+    }
+    return true;
+}
+
+/*
+Summary: Evaluates expression that calls rand many times in parallel and prints mean and variance of results
+    Syntax: montecarlo <expr> ; <samples> [; <seed>]
+*/
+bool cmd_montecarlo_exec(char *input, __attribute__((unused)) int code)
+{
+    char *args[3];
+    size_t num_args = str_split(input + strlen(MONTECARLO_COMMAND), args, 2, ";", ";");
+    if (num_args != 2 && num_args != 3)
+    {
+        report_error("Error: Invalid syntax. Syntax is:\n"
+            "montecarlo <expr> ; <samples> [; <seed>]\n");
+        return false;
+    }
+
+    for (size_t i = 0; i < num_args; i++)
+    {
+        args[i] = strip(args[i]);
+    }
+
+    double num_samples = 0;
+    double seed = (double)(random_next() >> 11);
+    if (!parse_natural(input, args[1], MONTECARLO_MAX_SAMPLES, &num_samples)
+        || (num_args == 3 && !parse_natural(input, args[2], MAX_SEED, &seed)))
+    {
+        return false;
+    }
+    if (num_samples == 0)
+    {
+        report_error_at(args[1] - input, strlen(args[1]), "Error: At least one sample is needed\n");
+        return false;
+    }
+
+    // Expression is not simplified, since calls of rand would be replaced by a single random constant
+    ParsingResult parsed;
+    if (!arith_parse_raw(args[0], (size_t)(args[0] - input), &parsed)) return false;
+    if (count_all_variable_nodes(parsed.tree) > 0)
+    {
+        report_error_at(args[0] - input, strlen(args[0]), "Error: Not constant\n");
+        free_result(&parsed, true);
+        return false;
+    }
+
+    Program program;
+    if (!compile_program(parsed.tree, 0, NULL, &program))
+    {
+        report_error_at(args[0] - input, strlen(args[0]), "Error: Expression can not be compiled\n");
+        free_result(&parsed, true);
+        return false;
+    }
+    free_result(&parsed, true);
+    MonteCarloResult result = monte_carlo(&program, (size_t)num_samples, (uint64_t)seed);
+    free_program(&program);
+
+    if (result.error != LISTENERERR_SUCCESS)
+    {
+        report_error("Error: %s in sample %zu\n", listenererr_to_str(result.error), result.error_sample + 1);
+        return false;
+    }
+
+    whisper("= ");
+    printf(CONSTANT_TYPE_FMT "\n", result.mean);
+    printf("Standard error: %g, variance: %g, seed: %.0f\n",
+        sqrt(result.variance / num_samples), result.variance, seed);
+    history_add(result.mean);
+    return true;
+}
@@ -0,0 +1,5 @@
+#pragma once
+#include <stdbool.h>
+
+int cmd_montecarlo_check(const char *input);
+bool cmd_montecarlo_exec(char *input, int code);
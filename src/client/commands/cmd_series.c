@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "../../util/console_util.h"
+#include "../../util/string_util.h"
+#include "../../engine/tree/tree_to_string.h"
+#include "../core/arith_context.h"
+#include "../core/arith_evaluation.h"
+#include "../core/history.h"
+#include "../core/bytecode.h"
+#include "../core/series.h"
+#include "cmd_table.h"
+#include "cmd_series.h"
+
+#define SERIES_COMMAND "series "
+
+int cmd_series_check(const char *input)
+{
+    return begins_with(SERIES_COMMAND, input);
+}
+
+/*
+Summary: Sums expression over integer steps of a variable without building a table
+    Syntax: series <expr> ; <var> ; <from> ; <to>
+*/
+bool cmd_series_exec(char *input, __attribute__((unused)) int code)
+{
+    char *args[4];
+    if (str_split(input + strlen(SERIES_COMMAND), args, 3, ";", ";", ";") != 4)
+    {
+        report_error("Error: Invalid syntax. Syntax is:\n"
+            "series <expr> ; <var> ; <from> ; <to>\n");
+        return false;
+    }
+
+    for (size_t i = 0; i < 4; i++)
+    {
+        args[i] = strip(args[i]);
+    }
+
+    bool success = false;
+    Node *expr = NULL;
+    Node *var_node = NULL;
+    double from_val = 0;
+    double to_val = 0;
+    if (!parse_expr_of_var(input, args[0], args[1], &expr, &var_node)
+        || !parse_constant(input, args[2], &from_val)
+        || !parse_constant(input, args[3], &to_val))
+    {
+        goto exit;
+    }
+    const char *var = get_var_name(var_node);
+
+    if (!isfinite(from_val) || !isfinite(to_val))
+    {
+        report_error("Error: Bounds must be finite\n");
+        goto exit;
+    }
+    if (series_num_terms(from_val, to_val) > SERIES_MAX_TERMS)
+    {
+        report_error("Error: Too many terms\n");
+        goto exit;
+    }
+
+    Program program;
+    if (!compile_program(expr, 1, &var, &program))
+    {
+        report_error_at(args[0] - input, strlen(args[0]), "Error: Expression can not be compiled\n");
+        goto exit;
+    }
+    SeriesResult result = series_sum(&program, from_val, to_val);
+    free_program(&program);
+
+    if (result.error != LISTENERERR_SUCCESS)
+    {
+        report_error("Error: %s for %s = " CONSTANT_TYPE_FMT "\n",
+            listenererr_to_str(result.error), var, from_val + result.error_index);
+        goto exit;
+    }
+
+    whisper("= ");
+    printf(CONSTANT_TYPE_FMT "\n", result.sum);
+    history_add(result.sum);
+    success = true;
+
+    exit:
+    free_tree(expr);
+    free_tree(var_node);
+    return success;
+}
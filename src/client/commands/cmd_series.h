@@ -0,0 +1,5 @@
+#pragma once
+#include <stdbool.h>
+
+int cmd_series_check(const char *input);
+bool cmd_series_exec(char *input, int code);
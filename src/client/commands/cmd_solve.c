@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "../../util/console_util.h"
+#include "../../util/string_util.h"
+#include "../../engine/tree/tree_to_string.h"
+#include "../../engine/tree/tree_util.h"
+#include "../core/arith_context.h"
+#include "../core/arith_evaluation.h"
+#include "../core/history.h"
+#include "../core/bytecode.h"
+#include "../core/roots.h"
+#include "../simplification/simplification.h"
+#include "cmd_table.h"
+#include "cmd_solve.h"
+
+#define SOLVE_COMMAND "solve "
+
+int cmd_solve_check(const char *input)
+{
+    return begins_with(SOLVE_COMMAND, input);
+}
+
+/*
+Summary: Compiles derivative of expression, in forward mode where possible (see can_compile_derivatives)
+    and from derivative rules of simplification ruleset otherwise
+Returns: False if derivative is not available (LISTENERERR_IMPOSSIBLE_DERIV or no ruleset)
+*/
+static bool compile_derivative(const Node *expr, const char *var, Program *out_program)
+{
+    Node *tree = malloc_operator_node(ctx_lookup_op(g_ctx, "deriv", OP_PLACE_FUNCTION), 2, 0);
+    set_child(tree, 0, tree_copy(expr));
+    set_child(tree, 1, malloc_variable_node(var, 0, 0));
+
+    bool success = false;
+    if (can_compile_derivatives(tree))
+    {
+        success = compile_program(tree, 1, &var, out_program);
+    }
+    else if (simplification_is_initialized() && simplify(&tree, NULL) == LISTENERERR_SUCCESS)
+    {
+        success = compile_program(tree, 1, &var, out_program);
+    }
+    free_tree(tree);
+    return success;
+}
+
+/*
+Summary: Searches root of expression near initial guess, see find_root
+    Syntax: solve <expr> ; <var> ; <x0>
+*/
+bool cmd_solve_exec(char *input, __attribute__((unused)) int code)
+{
+    char *args[3];
+    if (str_split(input + strlen(SOLVE_COMMAND), args, 2, ";", ";") != 3)
+    {
+        report_error("Error: Invalid syntax. Syntax is:\n"
+            "solve <expr> ; <var> ; <x0>\n");
+        return false;
+    }
+
+    for (size_t i = 0; i < 3; i++)
+    {
+        args[i] = strip(args[i]);
+    }
+
+    bool success = false;
+    Node *expr = NULL;
+    Node *var_node = NULL;
+    double x0 = 0;
+    if (!parse_expr_of_var(input, args[0], args[1], &expr, &var_node)
+        || !parse_constant(input, args[2], &x0))
+    {
+        goto exit;
+    }
+    const char *var = get_var_name(var_node);
+
+    if (!isfinite(x0))
+    {
+        report_error_at(args[2] - input, strlen(args[2]), "Error: Initial guess must be finite\n");
+        goto exit;
+    }
+
+    Program program;
+    Program derivative;
+    if (!compile_program(expr, 1, &var, &program))
+    {
+        report_error_at(args[0] - input, strlen(args[0]), "Error: Expression can not be compiled\n");
+        goto exit;
+    }
+    bool has_derivative = compile_derivative(expr, var, &derivative);
+    if (!has_derivative) whisper("Derivative not available, using Brent's method\n");
+    RootResult result = find_root(&program, has_derivative ? &derivative : NULL, x0);
+    free_program(&program);
+    if (has_derivative) free_program(&derivative);
+
+    if (!result.converged)
+    {
+        report_error("Error: No root found, best estimate is %s = " CONSTANT_TYPE_FMT " (residual: %g)\n",
+            var, result.root, result.value);
+        goto exit;
+    }
+
+    whisper("%s = ", var);
+    printf(CONSTANT_TYPE_FMT "\n", result.root);
+    printf("Residual: %g, evaluations: %zu\n", result.value, result.num_evaluations);
+    history_add(result.root);
+    success = true;
+
+    exit:
+    free_tree(expr);
+    free_tree(var_node);
+    return success;
+}
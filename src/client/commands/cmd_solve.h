@@ -0,0 +1,5 @@
+#pragma once
+#include <stdbool.h>
+
+int cmd_solve_check(const char *input);
+bool cmd_solve_exec(char *input, int code);
@@ -1,23 +1,48 @@
+#include <stdio.h>
 #include <string.h>
+#include <math.h>
+#include <errno.h>
 
 #include "../../util/console_util.h"
 #include "../../util/string_util.h"
 #include "../../util/string_builder.h"
+#include "../../util/alloc_wrappers.h"
+#include "../../util/parallel.h"
+#include "../../util/binary_writer.h"
+#include "../../util/governor.h"
 #include "../../engine/tree/tree_to_string.h"
 #include "../../engine/tree/tree_util.h"
 #include "../../table/table.h"
 #include "../core/arith_context.h"
 #include "../core/history.h"
 #include "../core/arith_evaluation.h"
+#include "../core/bytecode.h"
+#include "../core/grid.h"
 #include "cmd_table.h"
 
 #define COMMAND      "table "
 #define FOLD_KEYWORD " fold "
 #define FOLD_VAR_1   "x"
 #define FOLD_VAR_2   "y"
+#define OUTPUT_KEYWORD ">"
+#define HEADER_KEYWORD "header "
+// First bytes of binary output when a header is requested
+#define BINARY_MAGIC   "CCALCF64"
 
 #define STRBUILDER_STARTSIZE 10
+// Minimum number of rows to evaluate column-at-a-time
+#define BATCH_THRESHOLD      64
+// Number of rows that are evaluated by a worker at once
+#define CHUNK_SIZE         4096
+// Number of chunks whose rows are buffered before they are consumed, bounds memory of large tables
+#define WAVE_SIZE            64
 #define DOUBLE_FMT "%-.10f"
+// Grids of two variables with at most this many columns and cells are printed as matrix, others row by row
+#define MATRIX_MAX_COLUMNS   16
+#define MATRIX_MAX_CELLS 100000
+// Cells of a grid are indexed by integers that are exactly representable as double
+#define GRID_MAX_CELLS 9007199254740992.0 // 2^53
+#define GRID_SYNTAX "table <expr> ; <var>: <from> ; <to> ; <step> [; <var>: <from> ; <to> ; <step> ...]\n"
 
 int cmd_table_check(const char *input)
 {
@@ -34,15 +59,545 @@ bool check_if_constant(const char *base, const char *string, const Node *node)
     return true;
 }
 
+/*
+Summary: Parses argument that needs to be a constant and evaluates it, reports error otherwise
+*/
+bool parse_constant(char *input, char *arg, double *out)
+{
+    Node *node = NULL;
+    if (!arith_parse(arg, (size_t)(arg - input), &node)) return false;
+    bool success = check_if_constant(input, arg, node);
+    if (success) *out = arith_evaluate(node);
+    free_tree(node);
+    return success;
+}
+
+/*
+Summary: Parses expression and name of its variable, reports error if expression contains other variables
+Params
+    out_expr, out_var_node: Need to be freed (can be NULL) even if false is returned
+Returns: True if expression only contains variable (or no variable at all), name is get_var_name(*out_var_node)
+*/
+bool parse_expr_of_var(char *input, char *expr_arg, char *var_arg, Node **out_expr, Node **out_var_node)
+{
+    *out_expr = NULL;
+    *out_var_node = NULL;
+    if (!arith_parse(expr_arg, (size_t)(expr_arg - input), out_expr)
+        || !arith_parse(var_arg, (size_t)(var_arg - input), out_var_node))
+    {
+        return false;
+    }
+
+    if (get_type(*out_var_node) != NTYPE_VARIABLE)
+    {
+        report_error_at(var_arg - input, strlen(var_arg), "Error: Not a variable\n");
+        return false;
+    }
+
+    const char *var = get_var_name(*out_var_node);
+    if (count_all_variable_nodes(*out_expr) != get_variable_nodes((const Node**)out_expr, var, 0, NULL))
+    {
+        report_error_at(expr_arg - input, strlen(expr_arg),
+            "Error: Expression must not contain any variables except '%s'\n", var);
+        return false;
+    }
+    return true;
+}
+
+/*
+Summary: Evaluates expression by tree_reduce after its variables have been replaced by values
+    Used for expressions that can not be compiled, e.g. derivatives when no ruleset is loaded
+*/
+static ListenerError reduce_expr(const Node *expr, size_t num_vars, const char **vars, const double *values,
+    double *out)
+{
+    Node *current_expr = tree_copy(expr);
+    for (size_t i = 0; i < num_vars; i++)
+    {
+        Node *current_val = malloc_constant_node(values[i], 0);
+        replace_variable_nodes(&current_expr, current_val, vars[i]);
+        free_tree(current_val);
+    }
+    ListenerError err = tree_reduce(current_expr, arith_op_evaluate, out, NULL);
+    free_tree(current_expr);
+    return err;
+}
+
+/*
+Summary: Evaluates expression with variables x and y, by its program if it could be compiled
+*/
+static ListenerError evaluate_fold(const Program *fold_program, const Node *fold_expr, double x, double y, double *out)
+{
+    static const char *fold_vars[] = { FOLD_VAR_1, FOLD_VAR_2 };
+    double fold_values[] = { x, y };
+    if (fold_program != NULL) return run_program(fold_program, fold_values, out);
+    return reduce_expr(fold_expr, 2, fold_vars, fold_values, out);
+}
+
+/*
+Summary: Evaluates program for each value, column-at-a-time when there are enough rows
+    and the order of evaluation does not matter
+    Rows are reduced one by one when expression could not be compiled (program is NULL then)
+*/
+static void evaluate_rows(const Program *program, const Node *expr, size_t num_vars, const char *var,
+    size_t num_rows, const double *values, double *out_results, ListenerError *out_errors)
+{
+    if (program == NULL)
+    {
+        for (size_t i = 0; i < num_rows; i++)
+        {
+            out_errors[i] = reduce_expr(expr, num_vars, &var, values + i, out_results + i);
+        }
+    }
+    else if (num_rows >= BATCH_THRESHOLD && !program->has_side_effects)
+    {
+        run_program_batch(program, num_rows, &values, out_results, out_errors);
+    }
+    else
+    {
+        for (size_t i = 0; i < num_rows; i++)
+        {
+            out_errors[i] = run_program(program, values + i, out_results + i);
+        }
+    }
+}
+
+// State of table that is shared by workers and consumer of chunks
+typedef struct {
+    const Node *expr;
+    size_t num_vars;             // Expression contains variable var when 1
+    const char *var;
+    const Program *expr_program; // NULL when expression could not be compiled
+    const Node *fold_expr;       // NULL when there is no fold
+    const Program *fold_program; // NULL when there is no fold or it could not be compiled
+    bool parallel_fold;          // Fold is associative, thus workers fold their chunks and partial results are combined
+    size_t num_rows;
+    size_t first_chunk;          // Index of first chunk of current wave
+    double *values;              // Per row of current wave
+    double *results;             // Per row of current wave
+    ListenerError *errors;       // Per row of current wave
+    double *partial_folds;       // Per chunk of current wave, only used for parallel fold
+    bool *has_partial_fold;      // Per chunk of current wave, false when no row of chunk could be evaluated
+    Table *table;                // NULL when rows are written as binary records
+    BinaryWriter *writer;        // NULL when rows are added to table
+    double *records;             // Binary records of a chunk, NULL when rows are added to table
+    double fold_val;
+    bool stopped;                // Set when a chunk has not been consumed because command has been stopped
+} TableJob;
+
+/*
+Returns: True if fold expression is x+y, x*y, max(x, y) or min(x, y) with any order of operands
+*/
+static bool is_associative_fold(const Node *fold_expr)
+{
+    if (get_type(fold_expr) != NTYPE_OPERATOR || get_num_children(fold_expr) != 2) return false;
+    size_t id = get_op(fold_expr)->id;
+    if (id != 4 && id != 6 && id != 34 && id != 35) return false;
+    const Node *a = get_child(fold_expr, 0);
+    const Node *b = get_child(fold_expr, 1);
+    // Only x and y can occur in fold expression
+    return get_type(a) == NTYPE_VARIABLE && get_type(b) == NTYPE_VARIABLE
+        && strcmp(get_var_name(a), get_var_name(b)) != 0;
+}
+
+/*
+Summary: Computes range of rows of chunk of current wave, indices are relative to first row of wave
+*/
+static void get_chunk_range(const TableJob *job, size_t chunk_index, size_t *out_start, size_t *out_end)
+{
+    size_t num_wave_rows = job->num_rows - job->first_chunk * CHUNK_SIZE;
+    *out_start = chunk_index * CHUNK_SIZE;
+    *out_end = *out_start + CHUNK_SIZE < num_wave_rows ? *out_start + CHUNK_SIZE : num_wave_rows;
+}
+
+/*
+Summary: Evaluates rows of chunk and folds them if fold is parallel, runs on worker thread
+*/
+static void table_work(size_t chunk_index, void *context)
+{
+    TableJob *job = (TableJob*)context;
+    size_t start, end;
+    get_chunk_range(job, chunk_index, &start, &end);
+    evaluate_rows(job->expr_program, job->expr, job->num_vars, job->var,
+        end - start, job->values + start, job->results + start, job->errors + start);
+
+    if (job->parallel_fold)
+    {
+        bool has_fold = false;
+        double fold = 0;
+        for (size_t i = start; i < end; i++)
+        {
+            if (job->errors[i] != LISTENERERR_SUCCESS) continue;
+            if (has_fold)
+            {
+                evaluate_fold(job->fold_program, job->fold_expr, fold, job->results[i], &fold);
+            }
+            else
+            {
+                fold = job->results[i];
+                has_fold = true;
+            }
+        }
+        job->partial_folds[chunk_index] = fold;
+        job->has_partial_fold[chunk_index] = has_fold;
+    }
+}
+
+/*
+Summary: Folds result of row into fold value when fold is not parallel
+*/
+static void fold_row(TableJob *job, size_t row)
+{
+    if (job->fold_expr == NULL || job->parallel_fold || job->errors[row] != LISTENERERR_SUCCESS) return;
+    double fold_val = job->fold_val;
+    // Like arith_evaluate, an erroneous fold expression yields 0
+    job->fold_val = 0;
+    evaluate_fold(job->fold_program, job->fold_expr, fold_val, job->results[row], &job->fold_val);
+}
+
+/*
+Summary: Writes rows of chunk as records of value, result (NaN if erroneous) and fold value if there is a fold
+    Runs on calling thread in order of chunks, so records are written as soon as their chunk is evaluated
+*/
+static void binary_consume(size_t chunk_index, void *context)
+{
+    TableJob *job = (TableJob*)context;
+    if (job->stopped || governor_is_stopped())
+    {
+        job->stopped = true;
+        return;
+    }
+    size_t start, end;
+    get_chunk_range(job, chunk_index, &start, &end);
+
+    size_t record_size = job->fold_expr != NULL ? 3 : 2;
+    for (size_t i = start; i < end; i++)
+    {
+        fold_row(job, i);
+        double *record = job->records + (i - start) * record_size;
+        record[0] = job->values[i];
+        record[1] = job->errors[i] == LISTENERERR_SUCCESS ? job->results[i] : NAN;
+        if (job->fold_expr != NULL) record[2] = job->fold_val;
+    }
+    binary_write_doubles(job->writer, (end - start) * record_size, job->records);
+}
+
+/*
+Summary: Adds rows of chunk to table and folds them, runs on calling thread in order of chunks
+*/
+static void table_consume(size_t chunk_index, void *context)
+{
+    TableJob *job = (TableJob*)context;
+    if (job->stopped || governor_is_stopped())
+    {
+        job->stopped = true;
+        return;
+    }
+    size_t start, end;
+    get_chunk_range(job, chunk_index, &start, &end);
+
+    for (size_t i = start; i < end; i++)
+    {
+        fold_row(job, i);
+        if (is_interactive()) add_cell_fmt(job->table, " %zu ", job->first_chunk * CHUNK_SIZE + i + 1);
+        add_cell_fmt(job->table, " " DOUBLE_FMT " ", job->values[i]);
+
+        if (job->errors[i] == LISTENERERR_SUCCESS)
+        {
+            add_cell_fmt(job->table, " " DOUBLE_FMT " ", job->results[i]);
+        }
+        else
+        {
+            add_cell_fmt(job->table, " Error ");
+        }
+
+        next_row(job->table);
+    }
+
+    if (job->parallel_fold && job->has_partial_fold[chunk_index])
+    {
+        evaluate_fold(job->fold_program, job->fold_expr, job->fold_val, job->partial_folds[chunk_index], &job->fold_val);
+    }
+}
+
+/*
+Summary: Counts values start, start + step, ... that do not pass end, they are computed by repeated addition
+    Stops early when command is stopped
+Returns: False if step is lost to rounding before end is passed, the values would never pass it then
+*/
+static bool count_rows(double start, double end, double step, size_t *out_count)
+{
+    size_t count = 0;
+    for (double value = start; (step > 0 ? value <= end : value >= end) && !governor_is_stopped(); count++)
+    {
+        double next = value + step;
+        if (next == value) return false;
+        value = next;
+    }
+    *out_count = count;
+    return true;
+}
+
+/*
+Returns: True if second argument of table command begins with name of variable followed by colon
+*/
+static bool is_grid_syntax(const char *args)
+{
+    const char *c = strchr(args, ';');
+    if (c == NULL) return false;
+    c++;
+    while (is_space(*c)) c++;
+    if (!is_letter(*c)) return false;
+    while (is_letter(*c) || is_digit(*c)) c++;
+    while (is_space(*c)) c++;
+    return *c == ':';
+}
+
+// State of grid that is shared with consumer of its cells
+typedef struct {
+    const Grid *grid;
+    Table *table; // NULL when rows are printed as they are evaluated
+} GridTableJob;
+
+/*
+Summary: Adds cells of grid with two axes to matrix, rows correspond to values of first axis
+*/
+static void grid_matrix_consume(size_t first_cell, size_t num_cells, const double *results,
+    const ListenerError *errors, void *context)
+{
+    GridTableJob *job = (GridTableJob*)context;
+    size_t num_columns = job->grid->axes[1].count;
+    for (size_t i = 0; i < num_cells; i++)
+    {
+        size_t cell = first_cell + i;
+        if (cell % num_columns == 0)
+        {
+            add_cell_fmt(job->table, " " DOUBLE_FMT " ", grid_axis_value(&job->grid->axes[0], cell / num_columns));
+        }
+        if (errors[i] == LISTENERERR_SUCCESS)
+        {
+            add_cell_fmt(job->table, " " DOUBLE_FMT " ", results[i]);
+        }
+        else
+        {
+            add_cell(job->table, " Error ");
+        }
+        if (cell % num_columns == num_columns - 1) next_row(job->table);
+    }
+}
+
+/*
+Summary: Prints one line per cell of grid with values of all axes and result
+*/
+static void grid_rows_consume(size_t first_cell, size_t num_cells, const double *results,
+    const ListenerError *errors, void *context)
+{
+    GridTableJob *job = (GridTableJob*)context;
+    double values[GRID_MAX_AXES];
+    for (size_t i = 0; i < num_cells; i++)
+    {
+        grid_cell_values(job->grid, first_cell + i, values);
+        for (size_t j = 0; j < job->grid->num_axes; j++)
+        {
+            printf(DOUBLE_FMT " ", values[j]);
+        }
+        if (errors[i] == LISTENERERR_SUCCESS)
+        {
+            printf(DOUBLE_FMT "\n", results[i]);
+        }
+        else
+        {
+            printf("Error\n");
+        }
+    }
+}
+
+/*
+Summary: Prints values of expression for all combinations of values of its variables
+    Syntax: table <expr> ; <var>: <from> ; <to> ; <step> [; <var>: <from> ; <to> ; <step> ...]
+*/
+static bool grid_table_exec(char *input, char *args)
+{
+    // Expression and three arguments for each axis
+    char *parts[1 + 3 * GRID_MAX_AXES];
+    size_t num_parts = 0;
+    for (char *c = args; c != NULL; num_parts++)
+    {
+        if (num_parts == 1 + 3 * GRID_MAX_AXES)
+        {
+            report_error("Error: More than %d variables\n", GRID_MAX_AXES);
+            return false;
+        }
+        parts[num_parts] = c;
+        c = strchr(c, ';');
+        if (c != NULL) *c++ = '\0';
+    }
+    if (num_parts % 3 != 1)
+    {
+        report_error("Error: Invalid syntax. Syntax is:\n" GRID_SYNTAX);
+        return false;
+    }
+
+    bool success = false;
+    size_t num_axes = num_parts / 3;
+    GridAxis axes[GRID_MAX_AXES];
+    Node *var_nodes[GRID_MAX_AXES] = { NULL };
+    Node *expr = NULL;
+    char *expr_arg = strip(parts[0]);
+    if (!arith_parse(expr_arg, (size_t)(expr_arg - input), &expr)) goto exit;
+
+    size_t num_var_nodes = 0;
+    double num_cells = 1;
+    for (size_t i = 0; i < num_axes; i++)
+    {
+        char *var_arg = parts[3 * i + 1];
+        char *from_arg = strchr(var_arg, ':');
+        if (from_arg == NULL)
+        {
+            report_error("Error: Invalid syntax. Syntax is:\n" GRID_SYNTAX);
+            goto exit;
+        }
+        *from_arg++ = '\0';
+        var_arg = strip(var_arg);
+        from_arg = strip(from_arg);
+        char *to_arg = strip(parts[3 * i + 2]);
+        char *step_arg = strip(parts[3 * i + 3]);
+
+        if (!arith_parse(var_arg, (size_t)(var_arg - input), &var_nodes[i])) goto exit;
+        if (get_type(var_nodes[i]) != NTYPE_VARIABLE)
+        {
+            report_error_at(var_arg - input, strlen(var_arg), "Error: Not a variable\n");
+            goto exit;
+        }
+        axes[i].var = get_var_name(var_nodes[i]);
+        for (size_t j = 0; j < i; j++)
+        {
+            if (strcmp(axes[i].var, axes[j].var) == 0)
+            {
+                report_error_at(var_arg - input, strlen(var_arg), "Error: Variable '%s' occurs twice\n", axes[i].var);
+                goto exit;
+            }
+        }
+
+        double to = 0;
+        if (!parse_constant(input, from_arg, &axes[i].from)
+            || !parse_constant(input, to_arg, &to)
+            || !parse_constant(input, step_arg, &axes[i].step))
+        {
+            goto exit;
+        }
+        if (!isfinite(axes[i].from) || !isfinite(to) || !isfinite(axes[i].step) || axes[i].step == 0)
+        {
+            report_error_at(step_arg - input, strlen(step_arg), "Error: Bounds and 'step' must be finite, 'step' must not be zero\n");
+            goto exit;
+        }
+
+        // Adjust step direction to reach end
+        axes[i].step = to < axes[i].from ? -fabs(axes[i].step) : fabs(axes[i].step);
+        double count = grid_axis_count(axes[i].from, to, axes[i].step);
+        num_cells *= count;
+        if (num_cells > GRID_MAX_CELLS)
+        {
+            report_error("Error: Grid has more than %g cells\n", GRID_MAX_CELLS);
+            goto exit;
+        }
+        axes[i].count = (size_t)count;
+        num_var_nodes += get_variable_nodes((const Node**)&expr, axes[i].var, 0, NULL);
+    }
+
+    if (num_var_nodes != count_all_variable_nodes(expr))
+    {
+        report_error_at(expr_arg - input, strlen(expr_arg), "Error: Expression contains variable without values\n");
+        goto exit;
+    }
+
+    Grid grid;
+    if (!grid_compile(expr, num_axes, axes, &grid))
+    {
+        report_error_at(expr_arg - input, strlen(expr_arg), "Error: Expression can not be compiled\n");
+        goto exit;
+    }
+
+    GridTableJob job = { .grid = &grid, .table = NULL };
+    bool completed;
+    if (num_axes == 2 && axes[1].count <= MATRIX_MAX_COLUMNS && grid.num_cells <= MATRIX_MAX_CELLS)
+    {
+        // Header row holds values of second axis, first column values of first axis
+        job.table = get_empty_table();
+        add_cell_fmt(job.table, " %s \\ %s ", axes[0].var, axes[1].var);
+        for (size_t i = 0; i < axes[1].count; i++)
+        {
+            add_cell_fmt(job.table, " " DOUBLE_FMT " ", grid_axis_value(&axes[1], i));
+        }
+        next_row(job.table);
+        set_hline(job.table, BORDER_SINGLE);
+        completed = grid_evaluate(&grid, grid_matrix_consume, &job);
+        if (completed)
+        {
+            TextAlignment alignments[MATRIX_MAX_COLUMNS + 1];
+            for (size_t i = 0; i <= axes[1].count; i++)
+            {
+                alignments[i] = ALIGN_RIGHT;
+            }
+            set_default_alignments(job.table, axes[1].count + 1, alignments);
+            print_table(job.table);
+        }
+        free_table(job.table);
+    }
+    else
+    {
+        for (size_t i = 0; i < num_axes; i++)
+        {
+            whisper("%s ", axes[i].var);
+        }
+        Vector builder = strbuilder_create(STRBUILDER_STARTSIZE);
+        tree_to_strbuilder(&builder, expr, false);
+        whisper("%s\n", builder.buffer);
+        vec_destroy(&builder);
+        completed = grid_evaluate(&grid, grid_rows_consume, &job);
+    }
+    grid_free(&grid);
+    if (!completed)
+    {
+        report_error("Error: %s\n", governor_state_to_str(governor_get_state()));
+        goto exit;
+    }
+    success = true;
+
+    exit:
+    free_tree(expr);
+    for (size_t i = 0; i < num_axes; i++)
+    {
+        free_tree(var_nodes[i]);
+    }
+    return success;
+}
+
 bool cmd_table_exec(char *input, __attribute__((unused)) int code)
 {
+    if (is_grid_syntax(input + strlen(COMMAND))) return grid_table_exec(input, input + strlen(COMMAND));
+
+    // Optionally: Part of command after ">" names file that receives binary output
+    char *path = strstr(input + strlen(COMMAND), OUTPUT_KEYWORD);
+    bool binary_header = false;
+    if (path != NULL)
+    {
+        *path = '\0';
+        path = strip(path + strlen(OUTPUT_KEYWORD));
+        if (begins_with(HEADER_KEYWORD, path))
+        {
+            binary_header = true;
+            path = strip(path + strlen(HEADER_KEYWORD));
+        }
+    }
+
     char *args[6];
     size_t num_args = str_split(input + strlen(COMMAND), args, 5, ";", ";", ";", FOLD_KEYWORD, ";");
 
     if (num_args != 4 && num_args != 6)
     {
         report_error("Error: Invalid syntax. Syntax is:\n"
-               "table <expr> ; <from> ; <to> ; <step> [fold <expr> ; <init>]\n");
+               "table <expr> ; <from> ; <to> ; <step> [fold <expr> ; <init>] [> [header] <path>]\n");
         return false;
     }
 
@@ -130,10 +685,35 @@ bool cmd_table_exec(char *input, __attribute__((unused)) int code)
         step_val *= -1;
     }
 
-    Table *table = get_empty_table();
+    size_t num_rows = 0;
+    if (!count_rows(start_val, end_val, step_val, &num_rows))
+    {
+        report_error_at(args[3] - input, strlen(args[3]), "Error: 'step' is too small to advance from 'from' to 'to'\n");
+        goto exit;
+    }
+    if (governor_is_stopped())
+    {
+        report_error("Error: %s\n", governor_state_to_str(governor_get_state()));
+        goto exit;
+    }
+
+    FILE *file = NULL;
+    BinaryWriter writer;
+    if (path != NULL)
+    {
+        file = fopen(path, "wb");
+        if (file == NULL)
+        {
+            report_error("Error writing file: %s\n", strerror(errno));
+            goto exit;
+        }
+        writer = binary_writer_create(file);
+    }
+
+    Table *table = file == NULL ? get_empty_table() : NULL;
     
     // Print header row only if interactive
-    if (is_interactive())
+    if (is_interactive() && table != NULL)
     {
         add_empty_cell(table);
         if (num_vars != 0)
@@ -152,50 +732,103 @@ bool cmd_table_exec(char *input, __attribute__((unused)) int code)
         next_row(table);
     }
 
-    // Loop through all values and add them to table
-    for (size_t i = 1; step_val > 0 ? start_val <= end_val : start_val >= end_val; i++)
-    {
-        Node *current_expr = tree_copy(expr);
-        Node *current_val = malloc_constant_node(start_val, 0);
-        replace_variable_nodes(&current_expr, current_val, var);
+    // Compile expressions once, compilation fails for derivatives that can neither be computed
+    // in forward mode nor have been rewritten, those expressions are reduced for each row instead
+    Program expr_program;
+    Program fold_program;
+    const char *fold_vars[] = { FOLD_VAR_1, FOLD_VAR_2 };
+    bool expr_compiled = compile_program(expr, num_vars, &var, &expr_program);
+    bool fold_compiled = num_args == 6 && compile_program(fold_expr, 2, fold_vars, &fold_program);
 
-        double result = 0;
-        ListenerError err = tree_reduce(current_expr, arith_op_evaluate, &result, NULL);
+    size_t num_chunks = (num_rows + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    size_t wave_size = num_chunks < WAVE_SIZE ? num_chunks : WAVE_SIZE;
 
-        if (is_interactive()) add_cell_fmt(table, " %zu ", i);
-        add_cell_fmt(table, " " DOUBLE_FMT " ", start_val);
+    // Header: magic, number of columns and number of rows (each 8 bytes)
+    if (file != NULL && binary_header)
+    {
+        binary_write_bytes(&writer, strlen(BINARY_MAGIC), BINARY_MAGIC);
+        binary_write_u64(&writer, num_args == 6 ? 3 : 2);
+        binary_write_u64(&writer, num_rows);
+    }
 
-        if (err == LISTENERERR_SUCCESS)
-        {
-            add_cell_fmt(table, " " DOUBLE_FMT " ", result);
+    // Partial folds are only used when there is more than one chunk to not change rounding of small tables
+    // Binary output contains fold value of each row, thus fold is sequential then
+    TableJob job = {
+        .expr = expr,
+        .num_vars = num_vars,
+        .var = var,
+        .expr_program = expr_compiled ? &expr_program : NULL,
+        .fold_expr = num_args == 6 ? fold_expr : NULL,
+        .fold_program = fold_compiled ? &fold_program : NULL,
+        .parallel_fold = fold_compiled && num_chunks > 1 && file == NULL && is_associative_fold(fold_expr),
+        .num_rows = num_rows,
+        .first_chunk = 0,
+        .values = malloc_wrapper((wave_size * CHUNK_SIZE + 1) * sizeof(double)),
+        .results = malloc_wrapper((wave_size * CHUNK_SIZE + 1) * sizeof(double)),
+        .errors = malloc_wrapper((wave_size * CHUNK_SIZE + 1) * sizeof(ListenerError)),
+        .partial_folds = malloc_wrapper((wave_size + 1) * sizeof(double)),
+        .has_partial_fold = malloc_wrapper((wave_size + 1) * sizeof(bool)),
+        .table = table,
+        .writer = file != NULL ? &writer : NULL,
+        .records = file != NULL ? malloc_wrapper(CHUNK_SIZE * 3 * sizeof(double)) : NULL,
+        .fold_val = fold_val,
+        .stopped = false
+    };
 
-            if (num_args == 6)
-            {
-                Node *current_fold = tree_copy(fold_expr);
-                Node *current_fold_x = malloc_constant_node(fold_val, 0);
-                Node *current_fold_y = malloc_constant_node(result, 0);
-                replace_variable_nodes(&current_fold, current_fold_x, FOLD_VAR_1);
-                replace_variable_nodes(&current_fold, current_fold_y, FOLD_VAR_2);
-                fold_val = arith_evaluate(current_fold);
-                free_tree(current_fold);
-                free_tree(current_fold_x);
-                free_tree(current_fold_y);
-            }
-        }
-        else
+    // Rows that call rand need to be evaluated in order on a single thread, as well as rows that are reduced
+    size_t num_threads = !expr_compiled || expr_program.has_side_effects ? 1 : get_num_workers();
+    for (; job.first_chunk < num_chunks && !job.stopped; job.first_chunk += WAVE_SIZE)
+    {
+        size_t num_wave_chunks = num_chunks - job.first_chunk < WAVE_SIZE ? num_chunks - job.first_chunk : WAVE_SIZE;
+        size_t num_wave_rows = num_rows - job.first_chunk * CHUNK_SIZE;
+        if (num_wave_rows > WAVE_SIZE * CHUNK_SIZE) num_wave_rows = WAVE_SIZE * CHUNK_SIZE;
+        // Values are computed like the rows were counted
+        for (size_t i = 0; i < num_wave_rows; i++)
         {
-            add_cell_fmt(table, " Error ");
+            job.values[i] = start_val;
+            start_val += step_val;
         }
+        run_chunks_ordered(num_wave_chunks, num_threads, table_work,
+            table != NULL ? table_consume : binary_consume, &job);
+    }
+    fold_val = job.fold_val;
+    bool stopped = job.stopped;
 
-        free_tree(current_expr);
-        free_tree(current_val);
-        next_row(table);
-        start_val += step_val;
+    free(job.values);
+    free(job.results);
+    free(job.errors);
+    free(job.partial_folds);
+    free(job.has_partial_fold);
+    free(job.records);
+
+    if (table != NULL)
+    {
+        if (!stopped)
+        {
+            set_default_alignments(table, 3, (TextAlignment[]){ ALIGN_RIGHT, ALIGN_RIGHT, ALIGN_RIGHT });
+            print_table(table);
+        }
+        free_table(table);
     }
+    if (expr_compiled) free_program(&expr_program);
+    if (fold_compiled) free_program(&fold_program);
 
-    set_default_alignments(table, 3, (TextAlignment[]){ ALIGN_RIGHT, ALIGN_RIGHT, ALIGN_RIGHT });
-    print_table(table);
-    free_table(table);
+    if (file != NULL)
+    {
+        bool written = binary_writer_finish(&writer);
+        written = fclose(file) == 0 && written;
+        if (!written)
+        {
+            report_error("Error writing file: %s\n", strerror(errno));
+            goto exit;
+        }
+    }
+    if (stopped)
+    {
+        report_error("Error: %s\n", governor_state_to_str(governor_get_state()));
+        goto exit;
+    }
+    if (file != NULL) whisper("Wrote %zu rows to %s\n", num_rows, path);
 
     if (num_args == 6) // Contains fold expression
     {
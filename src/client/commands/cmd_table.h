@@ -1,5 +1,9 @@
 #pragma once
 #include <stdbool.h>
+#include "../../engine/tree/node.h"
 
 int cmd_table_check(const char *input);
 bool cmd_table_exec(char *input, int code);
+bool check_if_constant(const char *base, const char *string, const Node *node);
+bool parse_constant(char *input, char *arg, double *out);
+bool parse_expr_of_var(char *input, char *expr_arg, char *var_arg, Node **out_expr, Node **out_var_node);
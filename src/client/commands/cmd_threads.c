@@ -0,0 +1,52 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "../../util/console_util.h"
+#include "../../util/string_util.h"
+#include "../../util/parallel.h"
+#include "../core/arith_context.h"
+#include "../core/arith_evaluation.h"
+#include "cmd_threads.h"
+
+#define SHOW_CODE 1
+#define SET_CODE  2
+
+#define THREADS_COMMAND "threads"
+
+int cmd_threads_check(const char *input)
+{
+    if (strcmp(THREADS_COMMAND, input) == 0) return SHOW_CODE;
+    if (begins_with(THREADS_COMMAND " ", input)) return SET_CODE;
+    return false;
+}
+
+/*
+Summary: Shows or sets number of worker threads used by commands that evaluate many values
+*/
+bool cmd_threads_exec(char *input, int code)
+{
+    if (code == SHOW_CODE)
+    {
+        printf("Using %zu worker threads\n", get_num_workers());
+        return true;
+    }
+
+    input += strlen(THREADS_COMMAND) + 1;
+    Node *count_node = NULL;
+    if (!arith_parse(input, strlen(THREADS_COMMAND) + 1, &count_node)) return false;
+
+    double count = 0;
+    if (count_all_variable_nodes(count_node) > 0
+        || tree_reduce(count_node, arith_op_evaluate, &count, NULL) != LISTENERERR_SUCCESS
+        || count < 1)
+    {
+        report_error_at(strlen(THREADS_COMMAND) + 1, strlen(input), "Error: Number of threads must be a positive constant\n");
+        free_tree(count_node);
+        return false;
+    }
+    free_tree(count_node);
+
+    set_num_workers((size_t)count);
+    whisper("Using %zu worker threads\n", get_num_workers());
+    return true;
+}
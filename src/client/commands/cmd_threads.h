@@ -0,0 +1,5 @@
+#pragma once
+#include <stdbool.h>
+
+int cmd_threads_check(const char *input);
+bool cmd_threads_exec(char *input, int code);
@@ -3,8 +3,11 @@
 
 #include "../../util/string_util.h"
 #include "../../util/console_util.h"
+#include "../../util/parallel.h"
+#include "../../util/governor.h"
 #include "../core/arith_context.h"
 #include "../core/history.h"
+#include "../core/plugins.h"
 #include "../simplification/simplification.h"
 #include "../simplification/propositional_context.h"
 
@@ -15,6 +18,16 @@
 #include "cmd_load.h"
 #include "cmd_definition.h"
 #include "cmd_table.h"
+#include "cmd_threads.h"
+#include "cmd_budget.h"
+#include "cmd_export.h"
+#include "cmd_memo.h"
+#include "cmd_grad.h"
+#include "cmd_series.h"
+#include "cmd_integrate.h"
+#include "cmd_solve.h"
+#include "cmd_montecarlo.h"
+#include "cmd_map.h"
 
 #define COMMENT_PREFIX         '#'
 #define QUIT_COMMAND           "quit"
@@ -38,10 +51,20 @@ struct Command
     bool (*exec_handler)(char *input, int check_code);
 };
 
-static const size_t NUM_COMMANDS = 6;
+static const size_t NUM_COMMANDS = 16;
 static const struct Command commands[] = {
     { cmd_help_check,       cmd_help_exec },
     { cmd_table_check,      cmd_table_exec },
+    { cmd_threads_check,    cmd_threads_exec },
+    { cmd_budget_check,     cmd_budget_exec },
+    { cmd_export_check,     cmd_export_exec },
+    { cmd_memo_check,       cmd_memo_exec },
+    { cmd_grad_check,       cmd_grad_exec },
+    { cmd_series_check,     cmd_series_exec },
+    { cmd_integrate_check,  cmd_integrate_exec },
+    { cmd_solve_check,      cmd_solve_exec },
+    { cmd_montecarlo_check, cmd_montecarlo_exec },
+    { cmd_map_check,        cmd_map_exec },
     { cmd_definition_check, cmd_definition_exec },
     { cmd_clear_check,      cmd_clear_exec },
     { cmd_load_check,       cmd_load_exec },
@@ -58,8 +81,11 @@ void unload_commands()
     unload_simplification();
     unload_console_util();
     unload_history();
-    unload_arith_ctx();
+    // Propositional context overlays built-in context of arith context, unload it first
     unload_propositional_ctx();
+    unload_arith_ctx();
+    // Names of operators of plugins are still referenced by context until here
+    unload_plugins();
 }
 
 /*
@@ -82,11 +108,13 @@ void init_commands()
     
     init_console_util();
     init_history();
+    init_parallel();
 }
 
 /*
 Summary: Loop to ask user or file for command, ignores comments
     You may want to call set_interactive before.
+    Stops when command that runs the loop (e.g. load) has been cancelled or its time is exhausted
 Returns: True when no command exited with an error, false otherwise
 */
 bool process_input(FILE *file)
@@ -108,6 +136,7 @@ bool process_input(FILE *file)
             }
         }
         free(input);
+        if (governor_is_stopped()) return false;
     }
     // Loop was exited because input was EOF
     whisper("\n");
@@ -116,7 +145,7 @@ bool process_input(FILE *file)
 
 /*
 Summary: Tries to apply a command to input.
-    First command whose check-function does not return 0 is executed.
+    First command whose check-function does not return 0 is executed, its resources are limited by the governor.
 */
 bool exec_command(char *input)
 {
@@ -125,7 +154,10 @@ bool exec_command(char *input)
         int check_code = commands[i].check_handler(input);
         if (check_code != 0)
         {
-            return commands[i].exec_handler(input, check_code);
+            governor_begin();
+            bool res = commands[i].exec_handler(input, check_code);
+            governor_end();
+            return res;
         }
     }
     return false; // To make compiler happy
@@ -5,24 +5,47 @@
 #include "../../engine/tree/tree_util.h"
 #include "../../util/string_util.h"
 #include "../../util/console_util.h"
+#include "../../util/governor.h"
 
 #include "../simplification/simplification.h"
 #include "arith_context.h"
 #include "arith_evaluation.h"
 #include "history.h"
+#include "jit.h"
+#include "memo.h"
+#include "random.h"
+#include "result_cache.h"
 
+#define COMPOSITE_NODES_STARTSIZE 10
+
+ParsingContext __g_builtin_ctx;
 ParsingContext __g_ctx;
 LinkedList __g_composite_functions;
 
+typedef struct {
+    ListNode *node;   // Node in g_composite_functions, NULL if id does not belong to a user-defined function
+    Program program;  // Compiled right hand side, i-th parameter is bound to i-th variable slot
+    bool is_compiled; // False if right hand side could not be compiled, calls are then always expanded
+    bool is_pure;     // True if result only depends on arguments, i.e. no history or rand is used
+    MemoCache *memo;  // Cached results of calls, NULL if not enabled
+} CompositeFunction;
+
+// Maps id of a user-defined operator (minus id of first one) to its function (payload: CompositeFunction)
+// Ids are never reused, thus lookup and removal of composite functions takes constant time
+static Vector composite_functions;
+
 void init_arith_ctx()
 {
-    __g_ctx = get_arith_ctx();
-    srand(time(NULL));
+    // Built-in operators are shared by reference, user-defined functions only live in g_ctx
+    __g_builtin_ctx = get_arith_ctx();
+    __g_ctx = ctx_create_child(g_builtin_ctx);
+    init_random((uint64_t)time(NULL));
     __g_composite_functions = list_create(sizeof(RewriteRule));
+    composite_functions = vec_create(sizeof(CompositeFunction), COMPOSITE_NODES_STARTSIZE);
 }
 
 /*
-Summary: Sets arithmetic context stored in global variable
+Summary: Builds context of built-in arithmetic operators
 */
 ParsingContext get_arith_ctx()
 {
@@ -96,19 +119,106 @@ ParsingContext get_arith_ctx()
 void unload_arith_ctx()
 {
     clear_composite_functions();
+    result_cache_clear();
     list_destroy(g_composite_functions);
+    vec_destroy(&composite_functions);
     ctx_destroy(g_ctx);
+    ctx_destroy(g_builtin_ctx);
+}
+
+// Returns slot of user-defined function by id, NULL if there is none
+static CompositeFunction *get_slot_by_id(size_t id)
+{
+    if (id < g_builtin_ctx->next_id) return NULL;
+    size_t index = id - g_builtin_ctx->next_id;
+    if (index >= vec_count(&composite_functions)) return NULL;
+    CompositeFunction *function = (CompositeFunction*)vec_get(&composite_functions, index);
+    return function->node != NULL ? function : NULL;
+}
+
+// Returns slot of user-defined function, NULL if op is built-in or belongs to another context with same id
+static CompositeFunction *get_slot(const Operator *op)
+{
+    CompositeFunction *function = get_slot_by_id(op->id);
+    if (function == NULL || get_op(((RewriteRule*)function->node->data)->pattern.pattern) != op) return NULL;
+    return function;
+}
+
+/*
+Returns: True if result of tree only depends on its variables, i.e. neither history nor rand is used
+*/
+bool is_pure_tree(const Node *tree)
+{
+    if (get_type(tree) != NTYPE_OPERATOR) return true;
+    const Operator *op = get_op(tree);
+    if (op->id == 1 || op->id == 48 || op->id == 56) return false; // @x, rand(x, y), ans
+    CompositeFunction *callee = get_slot(op);
+    if (callee != NULL && !callee->is_pure) return false;
+    for (size_t i = 0; i < get_num_children(tree); i++)
+    {
+        if (!is_pure_tree(get_child(tree, i))) return false;
+    }
+    return true;
 }
 
+static void compile_function(CompositeFunction *function)
+{
+    const RewriteRule *rule = (RewriteRule*)function->node->data;
+    const char *params[MAX_CHILDREN];
+    size_t num_params = get_num_children(rule->pattern.pattern);
+    for (size_t i = 0; i < num_params; i++)
+    {
+        params[i] = get_var_name(get_child(rule->pattern.pattern, i));
+    }
+    // Programs of functions are only run through calls, native code would cost a memory mapping per function
+    bool jit = set_jit_enabled(false);
+    function->is_compiled = compile_program(rule->after, num_params, params, &function->program);
+    set_jit_enabled(jit);
+    function->is_pure = is_pure_tree(rule->after);
+}
+
+/*
+Summary: Adds rule that eliminates a user-defined function and compiles its right hand side,
+    which is called when the function is evaluated
+*/
 void add_composite_function(RewriteRule rule)
 {
-    list_append(g_composite_functions, (void*)&rule);
+    ListNode *node = list_append(g_composite_functions, (void*)&rule);
+    size_t index = get_op(rule.pattern.pattern)->id - g_builtin_ctx->next_id;
+    while (vec_count(&composite_functions) <= index)
+    {
+        VEC_PUSH_ELEM(&composite_functions, CompositeFunction, ((CompositeFunction){ .node = NULL, .memo = NULL }));
+    }
+    CompositeFunction *function = (CompositeFunction*)vec_get(&composite_functions, index);
+    function->node = node;
+    compile_function(function);
+    result_cache_clear();
 }
 
 // Removes node from g_composite_functions
 static void remove_node(ListNode *node)
 {
     RewriteRule *rule = (RewriteRule*)node->data;
+    const Operator *op = get_op(rule->pattern.pattern);
+    CompositeFunction *function = get_slot(op);
+    if (function->is_compiled) free_program(&function->program);
+    function->is_compiled = false;
+    memo_destroy(function->memo);
+    function->memo = NULL;
+    result_cache_clear();
+
+    // Only functions defined later can call this one, they get its right hand side instead
+    for (ListNode *curr = node->next; curr != NULL; curr = curr->next)
+    {
+        RewriteRule *caller = (RewriteRule*)curr->data;
+        if (find_op((const Node**)&caller->after, op) == NULL) continue;
+        expand_composite_functions(&caller->after, false);
+        CompositeFunction *caller_function = get_slot(get_op(caller->pattern.pattern));
+        if (caller_function->is_compiled) free_program(&caller_function->program);
+        compile_function(caller_function);
+    }
+
+    function->node = NULL;
     char *temp = get_op(rule->pattern.pattern)->name;
     // Remove function operator from context
     ctx_delete_op(g_ctx, get_op(rule->pattern.pattern)->name, OP_PLACE_FUNCTION);
@@ -122,17 +232,11 @@ static void remove_node(ListNode *node)
 
 bool remove_composite_function(const Operator *function)
 {
-    // Search for node in linked list to remove
-    ListNode *curr = __g_composite_functions.first;
-    while (curr != NULL)
+    CompositeFunction *slot = get_slot(function);
+    if (slot != NULL)
     {
-        RewriteRule *rule = (RewriteRule*)curr->data;
-        if (get_op(rule->pattern.pattern) == function)
-        {
-            remove_node(curr);
-            return true;
-        }
-        curr = curr->next;
+        remove_node(slot->node);
+        return true;
     }
     // Operator is not in list of composite functions, it must be built in
     report_error("Built-in functions can not be removed\n");
@@ -141,24 +245,102 @@ bool remove_composite_function(const Operator *function)
 
 void clear_composite_functions()
 {
+    // Newest function first, since no other function can call it
     while (list_count(g_composite_functions) != 0)
     {
-        remove_node(__g_composite_functions.first);
+        remove_node(__g_composite_functions.last);
     }
 }
 
-RewriteRule *get_composite_function(Operator *op)
+/*
+Returns: Rule that eliminates user-defined function op, NULL if op is not user-defined
+*/
+RewriteRule *get_composite_function(const Operator *op)
+{
+    CompositeFunction *slot = get_slot(op);
+    if (slot == NULL) return NULL;
+    return (RewriteRule*)slot->node->data;
+}
+
+/*
+Returns: Compiled right hand side of user-defined function op, NULL if op is not user-defined or not compiled
+*/
+const Program *get_composite_program(const Operator *op)
+{
+    CompositeFunction *slot = get_slot(op);
+    if (slot == NULL || !slot->is_compiled) return NULL;
+    return &slot->program;
+}
+
+/*
+Summary: Evaluates user-defined function by running its compiled right hand side
+    Used by arith_id_evaluate, thus id must belong to an operator of g_ctx
+*/
+ListenerError composite_id_evaluate(size_t id, const double *args, double *out)
 {
-    ListNode *curr = __g_composite_functions.first;
-    while (curr != NULL)
+    CompositeFunction *slot = get_slot_by_id(id);
+    if (slot == NULL || !slot->is_compiled) return LISTENERERR_UNKNOWN_OP;
+    if (slot->memo == NULL) return run_program(&slot->program, args, out);
+
+    double result = 0;
+    ListenerError err;
+    if (!memo_lookup(slot->memo, args, &result, &err))
     {
-        RewriteRule *rule = (RewriteRule*)curr->data;
-        if (get_op(rule->pattern.pattern) == op)
-        {
-            return rule;
-        }
+        err = run_program(&slot->program, args, &result);
+        // Evaluation that has been stopped by governor would fail for these arguments in later commands
+        if (err != LISTENERERR_BUDGET_EXCEEDED) memo_insert(slot->memo, args, result, err);
+    }
+    if (err == LISTENERERR_SUCCESS) *out = result;
+    return err;
+}
+
+/*
+Summary: Enables, resizes or disables cache of results of user-defined function, cached results are dropped
+Params
+    capacity: Maximum number of cached results, 0 disables cache
+Returns: False if function is not pure, thus its results can not be cached
+*/
+bool set_composite_memo(const Operator *op, size_t capacity)
+{
+    CompositeFunction *slot = get_slot(op);
+    if (slot == NULL || !slot->is_pure) return false;
+    memo_destroy(slot->memo);
+    slot->memo = capacity > 0 ? memo_create(get_num_children(((RewriteRule*)slot->node->data)->pattern.pattern), capacity) : NULL;
+    return true;
+}
+
+/*
+Returns: Cache of results of user-defined function op, NULL if not enabled
+*/
+const MemoCache *get_composite_memo(const Operator *op)
+{
+    CompositeFunction *slot = get_slot(op);
+    if (slot == NULL) return NULL;
+    return slot->memo;
+}
+
+/*
+Summary: Replaces calls of user-defined functions by their right hand sides
+    Each call site is looked up directly, thus cost does not depend on number of defined functions
+Params
+    expand_compiled: If false, only calls of functions that are not compiled are replaced
+*/
+void expand_composite_functions(Node **tree, bool expand_compiled)
+{
+    if (get_type(*tree) != NTYPE_OPERATOR) return;
+
+    for (size_t i = 0; i < get_num_children(*tree); i++)
+    {
+        expand_composite_functions(get_child_addr(*tree, i), expand_compiled);
+    }
+
+    CompositeFunction *slot = get_slot(get_op(*tree));
+    if (slot != NULL && (expand_compiled || !slot->is_compiled))
+    {
+        apply_rule_at_root(tree, (RewriteRule*)slot->node->data, NULL);
+        // Right hand side can call other functions, arguments have already been expanded
+        expand_composite_functions(tree, expand_compiled);
     }
-    return NULL;
 }
 
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ WRAPPER FUNCTIONS FOR PARSER
@@ -197,7 +379,7 @@ static const char *perr_to_string(ParserError perr)
     }
 }
 
-static const char *listenererr_to_str(int code)
+const char *listenererr_to_str(int code)
 {
     switch (code)
     {
@@ -217,6 +399,10 @@ static const char *listenererr_to_str(int code)
             return "No evaluation of operator possible";
         case LISTENERERR_DIVISION_BY_ZERO:
             return "Division by zero";
+        case LISTENERERR_BUDGET_EXCEEDED:
+            // Part of budget that is exhausted is known while command runs
+            if (governor_get_state() != BUDGET_AVAILABLE) return governor_state_to_str(governor_get_state());
+            return "Budget of command exhausted, see 'budget'";
         default:
             return "Unknown error";
     }
@@ -237,12 +423,18 @@ static void show_error_at_token(const Vector *tokens, size_t error_token, const
     report_error_at(error_pos, error_length, "Error: %s", message);
 }
 
+static bool postprocess(ParsingResult *p_result, size_t prompt_len, bool expand_compiled, bool numeric_derivatives);
+
+/*
+Summary: Parses and simplifies input whose result is evaluated numerically,
+    derivatives are then computed in forward mode by compiled programs where possible
+*/
 bool arith_parse(char *input, size_t prompt_len, Node **out_res)
 {
     ParsingResult res;
     if (arith_parse_raw(input, prompt_len, &res))
     {
-        if (arith_postprocess(&res, prompt_len))
+        if (postprocess(&res, prompt_len, false, true))
         {
             free_result(&res, false);
             *out_res = res.tree;
@@ -270,22 +462,118 @@ bool arith_parse_raw(char *input, size_t prompt_len, ParsingResult *out_res)
 }
 
 /*
-Summary: Replaces user-defined functions and simplifies
+Summary: Like arith_parse_raw, but for input that has already been tokenized
+Params
+    tokens: Ownership is passed to out_res
 */
-bool arith_postprocess(ParsingResult *p_result, size_t prompt_len)
+bool arith_parse_tokens_raw(Vector tokens, size_t num_tokens, size_t prompt_len, ParsingResult *out_res)
 {
-    LinkedListIterator iterator = list_get_iterator(g_composite_functions);
-    apply_ruleset_by_iterator(&p_result->tree, (Iterator*)&iterator, NULL, SIZE_MAX);
+    out_res->tokens = tokens;
+    out_res->error = parse_tokens(g_ctx, num_tokens, tokens.buffer, &out_res->tree, &out_res->error_token);
+    if (out_res->error != PERR_SUCCESS)
+    {
+        show_error_at_token(&out_res->tokens, out_res->error_token, perr_to_string(out_res->error), prompt_len);
+        free_result(out_res, false);
+        return false;
+    }
+    else
+    {
+        return true;
+    }
+}
+
+// Returns true if tree contains an operator for which predicate holds
+static bool contains_op(const Node *tree, bool (*predicate)(const Operator*))
+{
+    if (get_type(tree) != NTYPE_OPERATOR) return false;
+    if (predicate(get_op(tree))) return true;
+    for (size_t i = 0; i < get_num_children(tree); i++)
+    {
+        if (contains_op(get_child(tree, i), predicate)) return true;
+    }
+    return false;
+}
+
+static bool is_derivative(const Operator *op)
+{
+    return op->id == 2 || op->id == 3; // deriv, '
+}
+
+static bool is_composite_function(const Operator *op)
+{
+    return get_slot(op) != NULL;
+}
+
+/*
+Params
+    expand_compiled:     Expand calls of compiled user-defined functions as well
+    numeric_derivatives: Tree is evaluated numerically, so derivatives can be kept (see simplify_for_evaluation)
+*/
+static bool postprocess(ParsingResult *p_result, size_t prompt_len, bool expand_compiled, bool numeric_derivatives)
+{
+    // Derivatives need right hand sides of functions, other calls are evaluated by their programs
+    bool has_derivative = contains_op(p_result->tree, is_derivative);
+    expand_composite_functions(&p_result->tree, expand_compiled || has_derivative);
     const Node *errnode = NULL;
-    ListenerError l_err = simplify(&p_result->tree, &errnode);
+    ListenerError l_err = numeric_derivatives && has_derivative
+        ? simplify_for_evaluation(&p_result->tree, &errnode)
+        : simplify(&p_result->tree, &errnode);
     if (l_err != LISTENERERR_SUCCESS)
     {
         show_error_at_token(&p_result->tokens, get_token_index(errnode), listenererr_to_str(l_err), prompt_len);
         free_result(p_result, true);
         return false;
     }
+    else if (governor_get_state() == BUDGET_CANCELLED)
+    {
+        // Partially simplified result is not used when user cancelled command
+        report_error("Error: %s\n", governor_state_to_str(BUDGET_CANCELLED));
+        free_result(p_result, true);
+        return false;
+    }
     else
     {
+        // Rewriting stopped early, result is still correct but may not be simplified completely
+        if (governor_get_state() != BUDGET_AVAILABLE)
+        {
+            whisper("%s, result is only partially simplified\n", governor_state_to_str(governor_get_state()));
+        }
         return true;
     }
 }
+
+/*
+Summary: Simplifies tree, calls of user-defined functions are kept unless a derivative needs their right hand sides
+*/
+bool arith_postprocess(ParsingResult *p_result, size_t prompt_len)
+{
+    return postprocess(p_result, prompt_len, false, false);
+}
+
+/*
+Summary: Like arith_parse, but calls of user-defined functions are expanded when the result is not constant,
+    used when the simplified expression is shown to the user
+*/
+bool arith_parse_symbolic(char *input, size_t prompt_len, Node **out_res)
+{
+    ParsingResult res;
+    if (!arith_parse_raw(input, prompt_len, &res)) return false;
+    return arith_postprocess_symbolic(&res, prompt_len, out_res);
+}
+
+/*
+Summary: Second half of arith_parse_symbolic, for trees that have already been parsed
+Params
+    p_result: Is freed
+*/
+bool arith_postprocess_symbolic(ParsingResult *p_result, size_t prompt_len, Node **out_res)
+{
+    // Trees without variables are reduced to constants without expanding calls, other trees are shown expanded
+    // Deciding up front simplifies tree only once, which also leaves the whole budget to this pass
+    bool expand = count_all_variable_nodes(p_result->tree) > 0 && contains_op(p_result->tree, is_composite_function);
+    if (!postprocess(p_result, prompt_len, expand, false)) return false;
+
+    free_result(p_result, false);
+    *out_res = p_result->tree;
+    return true;
+}
@@ -5,11 +5,15 @@
 #include "../../engine/tree/node.h"
 #include "../../engine/tree/tree_util.h"
 #include "../../engine/transformation/rewrite_rule.h"
+#include "bytecode.h"
+#include "memo.h"
 
 #define NUM_ARITH_OPS 57
+#define g_builtin_ctx (&__g_builtin_ctx)
 #define g_ctx (&__g_ctx)
 #define g_composite_functions (&__g_composite_functions)
 
+extern ParsingContext __g_builtin_ctx;
 extern ParsingContext __g_ctx;
 extern LinkedList __g_composite_functions;
 
@@ -20,8 +24,18 @@ void unload_arith_ctx();
 void add_composite_function(RewriteRule rule);
 bool remove_composite_function(const Operator *function);
 void clear_composite_functions();
-RewriteRule *get_composite_function(Operator *op);
+RewriteRule *get_composite_function(const Operator *op);
+const Program *get_composite_program(const Operator *op);
+ListenerError composite_id_evaluate(size_t id, const double *args, double *out);
+bool set_composite_memo(const Operator *op, size_t capacity);
+const MemoCache *get_composite_memo(const Operator *op);
+void expand_composite_functions(Node **tree, bool expand_compiled);
+bool is_pure_tree(const Node *tree);
 
 bool arith_parse(char *input, size_t prompt_len, Node **out_res);
+bool arith_parse_symbolic(char *input, size_t prompt_len, Node **out_res);
+bool arith_postprocess_symbolic(ParsingResult *p_result, size_t prompt_len, Node **out_res);
 bool arith_parse_raw(char *input, size_t prompt_len, ParsingResult *out_res);
+bool arith_parse_tokens_raw(Vector tokens, size_t num_tokens, size_t prompt_len, ParsingResult *out_res);
 bool arith_postprocess(ParsingResult *p_result, size_t prompt_len);
+const char *listenererr_to_str(int code);
@@ -9,80 +9,12 @@
 #include "history.h"
 #include "arith_evaluation.h"
 #include "arith_context.h"
-
-static double euclid(double a, double b)
-{
-    a = fabs(trunc(a));
-    b = fabs(trunc(b));
-
-    if (a == 0)
-    {
-        return b;
-    }
-    else
-    {
-        while (b != 0)
-        {
-            if (a > b)
-            {
-                a = a - b;
-            }
-            else
-            {
-                b = b - a;
-            }
-        }
-        return a;
-    }
-}
-
-static double binomial(double n, double k)
-{
-    n = fabs(trunc(n));
-    k = fabs(trunc(k));
-
-    if (k == 0) return 1;
-    if ((2 * k) > n) k = n - k;
-    
-    double res = 1;
-    for (double i = 1; i <= k; i++)
-    {
-        res = (res * (n - k + i)) / i;
-    }
-    
-    return res;
-}
-
-static long fib(long n)
-{
-    if (n == 0) return 0;
-    if (n == 1) return 1;
-    if (n == -1) return 1;
-    return fib(n - 1) + fib(n - 2); 
-}
-
-static double fibonacci(double n)
-{
-    long l = (long)n;
-    if (l < 0) // Generalization to negative numbers
-    {
-        if (l % 2 == 0)
-        {
-            return -fib(labs(l));
-        }
-        else
-        {
-            return fib(labs(l));
-        }
-    }
-    else
-    {
-        return fib(l);
-    }
-}
+#include "plugins.h"
+#include "integer_kernels.h"
+#include "random.h"
 
 /*
-Returns: Random natural number between min and max - 1 (i.e. max is exclusive)
+Returns: Random natural number between min and max - 1 (i.e. max is exclusive), drawn from stream of calling thread
 */
 static double random_between(double min, double max)
 {
@@ -90,12 +22,15 @@ static double random_between(double min, double max)
     max = trunc(max);
     long diff = (long)(max - min);
     if (diff < 1) return -1;
-    return rand() % diff + min;
+    return floor(random_uniform() * diff) + min;
 }
 
-ListenerError arith_op_evaluate(const Operator *op, size_t num_args, const double *args, double *out)
+/*
+Summary: Evaluates arithmetic operator given by its id, used by compiled programs that don't store operators
+*/
+ListenerError arith_id_evaluate(size_t id, size_t num_args, const double *args, double *out)
 {
-    switch (op->id)
+    switch (id)
     {
         case 0: // $x
             *out = args[0];
@@ -139,7 +74,7 @@ ListenerError arith_op_evaluate(const Operator *op, size_t num_args, const doubl
             *out = pow(args[0], args[1]);
             return LISTENERERR_SUCCESS;
         case 9: // x C y
-            *out = binomial(args[0], args[1]);
+            *out = int_binomial(args[0], args[1]);
             return LISTENERERR_SUCCESS;
         case 10: // x mod y
             *out = fmod(args[0], args[1]);
@@ -151,22 +86,8 @@ ListenerError arith_op_evaluate(const Operator *op, size_t num_args, const doubl
             *out = -args[0];
             return LISTENERERR_SUCCESS;
         case 13: // x!
-        {
-            if (isinf(args[0]))
-            {
-                *out = INFINITY;
-            }
-            else
-            {
-                double res = 1;
-                for (double i = trunc(args[0]); i > 1; i--)
-                {
-                    res *= i;
-                }
-                *out = res;
-            }
+            *out = int_factorial(args[0]);
             return LISTENERERR_SUCCESS;
-        }
         case 14: // x%
             *out = args[0] / 100;
             return LISTENERERR_SUCCESS;
@@ -297,16 +218,16 @@ ListenerError arith_op_evaluate(const Operator *op, size_t num_args, const doubl
             return LISTENERERR_SUCCESS;
         }
         case 46: // gcd(x, y)
-            *out = euclid(args[0], args[1]);
+            *out = int_gcd(args[0], args[1]);
             return LISTENERERR_SUCCESS;
         case 47: // lcm(x, y)
-            *out = fabs(trunc(args[0]) * trunc(args[1])) / euclid(args[0], args[1]);
+            *out = int_lcm(args[0], args[1]);
             return LISTENERERR_SUCCESS;
         case 48: // rand(x, y)
             *out = random_between(args[0], args[1]);
             return LISTENERERR_SUCCESS;
         case 49: // fib(x)
-            *out = fibonacci(args[0]);
+            *out = int_fib(args[0]);
             return LISTENERERR_SUCCESS;
         case 50: // gamma(x)
             *out = tgamma(args[0]);
@@ -339,7 +260,14 @@ ListenerError arith_op_evaluate(const Operator *op, size_t num_args, const doubl
             }
         }
     }
-    return LISTENERERR_UNKNOWN_OP;
+    // Remaining ids belong to plugins or user-defined functions
+    if (get_plugin_op(id) != NULL) return plugin_id_evaluate(id, num_args, args, out);
+    return composite_id_evaluate(id, args, out);
+}
+
+ListenerError arith_op_evaluate(const Operator *op, size_t num_args, const double *args, double *out)
+{
+    return arith_id_evaluate(op->id, num_args, args, out);
 }
 
 double arith_evaluate(const Node *tree)
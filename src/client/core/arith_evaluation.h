@@ -10,5 +10,6 @@
 #define LISTENERERR_UNKNOWN_OP        5
 #define LISTENERERR_DIVISION_BY_ZERO  6
 
+ListenerError arith_id_evaluate(size_t id, size_t num_args, const double *args, double *out);
 ListenerError arith_op_evaluate(const Operator *op, size_t num_args, const double *args, double *out);
 double arith_evaluate(const Node *node);
@@ -0,0 +1,808 @@
+#include <string.h>
+#include <math.h>
+
+#include "../../util/alloc_wrappers.h"
+#include "../../util/governor.h"
+#include "arith_context.h"
+#include "arith_evaluation.h"
+#include "history.h"
+#include "bytecode.h"
+#include "jit.h"
+#include "plugins.h"
+#include "vector_math.h"
+
+#define INSTRUCTIONS_STARTSIZE 16
+#define CONSTANTS_STARTSIZE     8
+#define CALL_ARGS_STARTSIZE     4
+// Programs that need more registers allocate them on the heap for each run
+#define LOCAL_REGISTERS       128
+// Number of rows that are evaluated at once by run_program_batch, each register holds a column of this size
+#define BATCH_SIZE            256
+// Upper bound of constants that forward mode adds for each node of a derivative
+#define DUAL_CONSTANTS_PER_NODE 2
+
+typedef struct {
+    size_t num_vars;
+    const char **vars;
+    size_t first_temp; // First register for temporary results
+    Program *program;
+} Compilation;
+
+// Returns true if tree is "ans" or "@c" for a constant c
+static bool is_history_lookup(const Node *tree)
+{
+    if (get_type(tree) != NTYPE_OPERATOR) return false;
+    if (get_op(tree)->id == 56) return true; // ans
+    return get_op(tree)->id == 1 && get_type(get_child(tree, 0)) == NTYPE_CONSTANT; // @x
+}
+
+static size_t count_nodes(const Node *tree)
+{
+    size_t res = 1;
+    if (get_type(tree) == NTYPE_OPERATOR)
+    {
+        for (size_t i = 0; i < get_num_children(tree); i++) res += count_nodes(get_child(tree, i));
+    }
+    return res;
+}
+
+// Returns upper bound of number of constants in pool
+static size_t count_constants(const Node *tree)
+{
+    switch (get_type(tree))
+    {
+        case NTYPE_CONSTANT:
+            return 1;
+        case NTYPE_OPERATOR:
+        {
+            size_t res = is_history_lookup(tree) ? 1 : 0;
+            // Forward mode adds tangents of leaves and constants of derivative rules
+            if (get_op(tree)->id == 3) res += DUAL_CONSTANTS_PER_NODE * count_nodes(get_child(tree, 0));
+            for (size_t i = 0; i < get_num_children(tree); i++)
+            {
+                res += count_constants(get_child(tree, i));
+            }
+            return res;
+        }
+        default:
+            return 0;
+    }
+}
+
+static unsigned int emit(Compilation *comp, Instruction instr)
+{
+    VEC_PUSH_ELEM(&comp->program->instructions, Instruction, instr);
+    if (instr.dest + 1 > comp->program->num_registers) comp->program->num_registers = instr.dest + 1;
+    return instr.dest;
+}
+
+static bool is_op(const Node *tree, size_t id)
+{
+    return get_type(tree) == NTYPE_OPERATOR && get_op(tree)->id == id;
+}
+
+static unsigned int add_constant(Compilation *comp, double value)
+{
+    VEC_PUSH_ELEM(&comp->program->constants, double, value);
+    return comp->num_vars + vec_count(&comp->program->constants) - 1;
+}
+
+static unsigned int emit_call(Compilation *comp, size_t id, unsigned int dest, unsigned int arg)
+{
+    size_t first_arg = vec_count(&comp->program->call_args);
+    VEC_PUSH_ELEM(&comp->program->call_args, unsigned int, arg);
+    return emit(comp, (Instruction){ .opcode = OPCODE_CALL, .num_args = 1, .dest = dest, .a = first_arg, .b = id });
+}
+
+static bool contains_variable(const Node *tree, const char *var)
+{
+    switch (get_type(tree))
+    {
+        case NTYPE_VARIABLE:
+            return strcmp(get_var_name(tree), var) == 0;
+        case NTYPE_OPERATOR:
+            for (size_t i = 0; i < get_num_children(tree); i++)
+            {
+                if (contains_variable(get_child(tree, i), var)) return true;
+            }
+            return false;
+        default:
+            return false;
+    }
+}
+
+// Returns true if compile_dual knows derivative of tree with respect to var
+static bool is_differentiable(const Node *tree, const char *var)
+{
+    if (get_type(tree) != NTYPE_OPERATOR || !contains_variable(tree, var)) return true;
+    switch (get_op(tree)->id)
+    {
+        case 0:  case 4:  case 5:  case 6:  case 7:  case 8:  case 11: case 12: case 15: case 17:
+        case 19: case 20: case 21: case 22: case 23: case 24: case 25: case 26: case 27: case 28:
+        case 29: case 30: case 31: case 32: case 33: case 36: case 37: case 38: case 39: case 40:
+        case 41: case 42:
+            for (size_t i = 0; i < get_num_children(tree); i++)
+            {
+                if (!is_differentiable(get_child(tree, i), var)) return false;
+            }
+            return true;
+        default:
+            return false;
+    }
+}
+
+/*
+Summary: Checks whether all derivatives in tree can be evaluated in forward mode by compiled programs
+Returns: False if a derivative is malformed or contains an operator without derivative rule in compile_dual
+*/
+bool can_compile_derivatives(const Node *tree)
+{
+    if (get_type(tree) != NTYPE_OPERATOR) return true;
+    if (get_op(tree)->id == 2) return false; // x' needs to be transformed to deriv(x, y) first
+    if (get_op(tree)->id == 3
+        && (get_type(get_child(tree, 1)) != NTYPE_VARIABLE
+            || !is_differentiable(get_child(tree, 0), get_var_name(get_child(tree, 1)))))
+    {
+        return false;
+    }
+    for (size_t i = 0; i < get_num_children(tree); i++)
+    {
+        if (!can_compile_derivatives(get_child(tree, i))) return false;
+    }
+    return true;
+}
+
+static bool compile_node(Compilation *comp, const Node *tree, size_t depth, unsigned int *out_register);
+
+/*
+Summary: Emits instructions that compute tree and its derivative with respect to var in one pass (forward mode)
+    Each subtree yields a pair of registers like a dual number, derivative rules only combine these pairs
+    Tangent is written before value, since the rules mostly need the values of the operands
+Params
+    depth:       Tangent is stored in next temporary register, value in the one after it
+    out_value:   Register that holds value of tree
+    out_tangent: Register that holds derivative of tree
+Returns: False if compile_node fails or an operator has no derivative rule (see is_differentiable)
+*/
+static bool compile_dual(Compilation *comp, const Node *tree, const char *var, size_t depth,
+    unsigned int *out_value, unsigned int *out_tangent)
+{
+    if (get_type(tree) != NTYPE_OPERATOR || !contains_variable(tree, var))
+    {
+        *out_tangent = add_constant(comp, get_type(tree) == NTYPE_VARIABLE && contains_variable(tree, var) ? 1 : 0);
+        return compile_node(comp, tree, depth + 1, out_value);
+    }
+
+    const Operator *op = get_op(tree);
+    unsigned int tangent = comp->first_temp + depth;
+    unsigned int value = tangent + 1;
+    // Registers after the operands are free for intermediate results
+    unsigned int temp = tangent + 2 * get_num_children(tree);
+    unsigned int a, da, b, db;
+
+    if (op->id == 0 || op->id == 11) return compile_dual(comp, get_child(tree, 0), var, depth, out_value, out_tangent);
+    if (!compile_dual(comp, get_child(tree, 0), var, depth, &a, &da)) return false;
+    if (get_num_children(tree) == 2
+        && !compile_dual(comp, get_child(tree, 1), var, depth + 2, &b, &db)) return false;
+
+    switch (op->id)
+    {
+        case 4: // x+y
+        case 5: // x-y
+        {
+            Opcode opcode = op->id == 4 ? OPCODE_ADD : OPCODE_SUB;
+            *out_tangent = emit(comp, (Instruction){ .opcode = opcode, .dest = tangent, .a = da, .b = db });
+            *out_value = emit(comp, (Instruction){ .opcode = opcode, .dest = value, .a = a, .b = b });
+            return true;
+        }
+
+        case 6: // (x*y)' = x'*y + x*y'
+            emit(comp, (Instruction){ .opcode = OPCODE_MUL, .dest = temp, .a = da, .b = b });
+            *out_tangent = emit(comp, (Instruction){ .opcode = OPCODE_MUL_ADD, .dest = tangent, .a = a, .b = db, .c = temp });
+            *out_value = emit(comp, (Instruction){ .opcode = OPCODE_MUL, .dest = value, .a = a, .b = b });
+            return true;
+
+        case 7: // (x/y)' = (x' - x/y*y') / y
+            *out_value = emit(comp, (Instruction){ .opcode = OPCODE_DIV, .dest = value, .a = a, .b = b });
+            emit(comp, (Instruction){ .opcode = OPCODE_SUB_MUL, .dest = tangent, .a = value, .b = db, .c = da });
+            *out_tangent = emit(comp, (Instruction){ .opcode = OPCODE_DIV, .dest = tangent, .a = tangent, .b = b });
+            return true;
+
+        case 8: // x^y
+        {
+            Opcode opcode = get_type(get_child(tree, 1)) == NTYPE_CONSTANT && get_const_value(get_child(tree, 1)) > 0
+                ? OPCODE_POW_CONST
+                : OPCODE_POW;
+            if (!contains_variable(get_child(tree, 1), var))
+            {
+                // (x^c)' = c*x^(c-1)*x', no check of x^(c-1) since it is finite or the tangent is vertical
+                emit(comp, (Instruction){ .opcode = OPCODE_SUB, .dest = temp, .a = b, .b = add_constant(comp, 1) });
+                emit(comp, (Instruction){ .opcode = OPCODE_POW_CONST, .dest = temp, .a = a, .b = temp });
+                emit(comp, (Instruction){ .opcode = OPCODE_MUL, .dest = temp, .a = temp, .b = b });
+                *out_tangent = emit(comp, (Instruction){ .opcode = OPCODE_MUL, .dest = tangent, .a = temp, .b = da });
+                *out_value = emit(comp, (Instruction){ .opcode = opcode, .dest = value, .a = a, .b = b });
+                return true;
+            }
+            // (x^y)' = x^y*(y'*ln(x) + y*x'/x), second summand vanishes for constant base
+            emit(comp, (Instruction){ .opcode = OPCODE_LN, .dest = temp, .a = a });
+            emit(comp, (Instruction){ .opcode = OPCODE_MUL, .dest = temp, .a = temp, .b = db });
+            if (contains_variable(get_child(tree, 0), var))
+            {
+                emit(comp, (Instruction){ .opcode = OPCODE_MUL, .dest = temp + 1, .a = b, .b = da });
+                emit(comp, (Instruction){ .opcode = OPCODE_DIV, .dest = temp + 1, .a = temp + 1, .b = a });
+                emit(comp, (Instruction){ .opcode = OPCODE_ADD, .dest = temp, .a = temp, .b = temp + 1 });
+            }
+            *out_value = emit(comp, (Instruction){ .opcode = opcode, .dest = value, .a = a, .b = b });
+            *out_tangent = emit(comp, (Instruction){ .opcode = OPCODE_MUL, .dest = tangent, .a = value, .b = temp });
+            return true;
+        }
+
+        case 12: // -x
+            *out_tangent = emit(comp, (Instruction){ .opcode = OPCODE_NEG, .dest = tangent, .a = da });
+            *out_value = emit(comp, (Instruction){ .opcode = OPCODE_NEG, .dest = value, .a = a });
+            return true;
+
+        case 15: // exp(x)' = exp(x)*x'
+            *out_value = emit(comp, (Instruction){ .opcode = OPCODE_EXP, .dest = value, .a = a });
+            *out_tangent = emit(comp, (Instruction){ .opcode = OPCODE_MUL, .dest = tangent, .a = value, .b = da });
+            return true;
+
+        case 17: // sqrt(x)' = x'/(2*sqrt(x))
+            *out_value = emit(comp, (Instruction){ .opcode = OPCODE_SQRT, .dest = value, .a = a });
+            emit(comp, (Instruction){ .opcode = OPCODE_ADD, .dest = temp, .a = value, .b = value });
+            *out_tangent = emit(comp, (Instruction){ .opcode = OPCODE_DIV, .dest = tangent, .a = da, .b = temp });
+            return true;
+
+        case 19: // ln(x)' = x'/x
+        case 20: // ld(x)' = x'/(x*ln(2))
+        case 21: // lg(x)' = x'/(x*ln(10))
+            if (op->id == 19)
+            {
+                *out_tangent = emit(comp, (Instruction){ .opcode = OPCODE_DIV, .dest = tangent, .a = da, .b = a });
+                *out_value = emit(comp, (Instruction){ .opcode = OPCODE_LN, .dest = value, .a = a });
+                return true;
+            }
+            emit(comp, (Instruction){ .opcode = OPCODE_MUL, .dest = temp,
+                .a = a, .b = add_constant(comp, log(op->id == 20 ? 2 : 10)) });
+            *out_tangent = emit(comp, (Instruction){ .opcode = OPCODE_DIV, .dest = tangent, .a = da, .b = temp });
+            *out_value = emit_call(comp, op->id, value, a);
+            return true;
+
+        case 22: // sin(x)' = cos(x)*x'
+        case 28: // sinh(x)' = cosh(x)*x'
+            if (op->id == 22) emit(comp, (Instruction){ .opcode = OPCODE_COS, .dest = temp, .a = a });
+            else emit_call(comp, 29, temp, a);
+            *out_tangent = emit(comp, (Instruction){ .opcode = OPCODE_MUL, .dest = tangent, .a = temp, .b = da });
+            *out_value = op->id == 22
+                ? emit(comp, (Instruction){ .opcode = OPCODE_SIN, .dest = value, .a = a })
+                : emit_call(comp, 28, value, a);
+            return true;
+
+        case 23: // cos(x)' = -sin(x)*x'
+            emit(comp, (Instruction){ .opcode = OPCODE_SIN, .dest = temp, .a = a });
+            emit(comp, (Instruction){ .opcode = OPCODE_MUL, .dest = temp, .a = temp, .b = da });
+            *out_tangent = emit(comp, (Instruction){ .opcode = OPCODE_NEG, .dest = tangent, .a = temp });
+            *out_value = emit(comp, (Instruction){ .opcode = OPCODE_COS, .dest = value, .a = a });
+            return true;
+
+        case 29: // cosh(x)' = sinh(x)*x'
+        case 36: // abs(x)' = sgn(x)*x'
+            emit_call(comp, op->id == 29 ? 28 : 42, temp, a);
+            *out_tangent = emit(comp, (Instruction){ .opcode = OPCODE_MUL, .dest = tangent, .a = temp, .b = da });
+            *out_value = emit_call(comp, op->id, value, a);
+            return true;
+
+        case 24: // tan(x)' = x'/cos(x)^2
+        case 30: // tanh(x)' = x'/cosh(x)^2
+            if (op->id == 24) emit(comp, (Instruction){ .opcode = OPCODE_COS, .dest = temp, .a = a });
+            else emit_call(comp, 29, temp, a);
+            emit(comp, (Instruction){ .opcode = OPCODE_MUL, .dest = temp, .a = temp, .b = temp });
+            *out_tangent = emit(comp, (Instruction){ .opcode = OPCODE_DIV, .dest = tangent, .a = da, .b = temp });
+            *out_value = emit_call(comp, op->id, value, a);
+            return true;
+
+        case 25: // asin(x)' = x'/sqrt(1 - x^2)
+        case 26: // acos(x)' = -x'/sqrt(1 - x^2)
+        case 27: // atan(x)' = x'/(x^2 + 1)
+        case 31: // asinh(x)' = x'/sqrt(x^2 + 1)
+        case 32: // acosh(x)' = x'/sqrt(x^2 - 1)
+        case 33: // atanh(x)' = x'/(1 - x^2)
+        {
+            Opcode opcode = OPCODE_SUB_MUL; // 1 - x^2
+            if (op->id == 27 || op->id == 31) opcode = OPCODE_MUL_ADD;
+            if (op->id == 32) opcode = OPCODE_MUL_SUB;
+            emit(comp, (Instruction){ .opcode = opcode, .dest = temp, .a = a, .b = a, .c = add_constant(comp, 1) });
+            if (op->id != 27 && op->id != 33) emit(comp, (Instruction){ .opcode = OPCODE_SQRT, .dest = temp, .a = temp });
+            *out_tangent = emit(comp, (Instruction){ .opcode = OPCODE_DIV, .dest = tangent, .a = da, .b = temp });
+            if (op->id == 26) emit(comp, (Instruction){ .opcode = OPCODE_NEG, .dest = tangent, .a = tangent });
+            *out_value = emit_call(comp, op->id, value, a);
+            return true;
+        }
+
+        case 37: // ceil(x)
+        case 38: // floor(x)
+        case 39: // round(x)
+        case 40: // trunc(x)
+        case 42: // sgn(x)
+            // Piecewise constant, derivative is zero where it exists
+            *out_tangent = add_constant(comp, 0);
+            *out_value = emit_call(comp, op->id, value, a);
+            return true;
+
+        case 41: // frac(x)' = x'
+            *out_tangent = da;
+            *out_value = emit_call(comp, op->id, value, a);
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+/*
+Summary: Emits instructions that compute tree
+Params
+    depth:        Number of temporary registers that are still needed by the parent, result is stored in the next one
+    out_register: Register that holds result of tree, leaves need no instructions
+Returns: False if tree contains an unbound variable, an operator that is not arithmetic or a derivative without rule
+*/
+static bool compile_node(Compilation *comp, const Node *tree, size_t depth, unsigned int *out_register)
+{
+    unsigned int dest = comp->first_temp + depth;
+    switch (get_type(tree))
+    {
+        case NTYPE_CONSTANT:
+            *out_register = comp->num_vars + vec_count(&comp->program->constants);
+            VEC_PUSH_ELEM(&comp->program->constants, double, get_const_value(tree));
+            return true;
+
+        case NTYPE_VARIABLE:
+            for (size_t i = 0; i < comp->num_vars; i++)
+            {
+                if (strcmp(get_var_name(tree), comp->vars[i]) == 0)
+                {
+                    *out_register = i;
+                    return true;
+                }
+            }
+            return false;
+
+        case NTYPE_OPERATOR:
+            break;
+    }
+
+    const Operator *op = get_op(tree);
+    if (op->id >= NUM_ARITH_OPS && !is_plugin_op(op) && get_composite_program(op) == NULL) return false;
+    size_t num_children = get_num_children(tree);
+    unsigned int a, b, c;
+
+    switch (op->id)
+    {
+        case 0: // $x
+        case 11: // +x
+            return compile_node(comp, get_child(tree, 0), depth, out_register);
+
+        case 4: // x+y
+        case 5: // x-y
+        {
+            // Fuse with multiplication in either operand
+            const Node *left = get_child(tree, 0);
+            const Node *right = get_child(tree, 1);
+            if (is_op(left, 6))
+            {
+                if (!compile_node(comp, get_child(left, 0), depth, &a)
+                    || !compile_node(comp, get_child(left, 1), depth + 1, &b)
+                    || !compile_node(comp, right, depth + 2, &c)) return false;
+                *out_register = emit(comp, (Instruction){
+                    .opcode = op->id == 4 ? OPCODE_MUL_ADD : OPCODE_MUL_SUB,
+                    .dest = dest, .a = a, .b = b, .c = c });
+                return true;
+            }
+            if (is_op(right, 6))
+            {
+                if (!compile_node(comp, left, depth, &c)
+                    || !compile_node(comp, get_child(right, 0), depth + 1, &a)
+                    || !compile_node(comp, get_child(right, 1), depth + 2, &b)) return false;
+                *out_register = emit(comp, (Instruction){
+                    .opcode = op->id == 4 ? OPCODE_ADD_MUL : OPCODE_SUB_MUL,
+                    .dest = dest, .a = a, .b = b, .c = c });
+                return true;
+            }
+            if (!compile_node(comp, left, depth, &a) || !compile_node(comp, right, depth + 1, &b)) return false;
+            *out_register = emit(comp, (Instruction){
+                .opcode = op->id == 4 ? OPCODE_ADD : OPCODE_SUB,
+                .dest = dest, .a = a, .b = b });
+            return true;
+        }
+
+        case 6: // x*y
+        case 7: // x/y
+        case 8: // x^y
+        {
+            if (!compile_node(comp, get_child(tree, 0), depth, &a)
+                || !compile_node(comp, get_child(tree, 1), depth + 1, &b)) return false;
+            Opcode opcode = op->id == 6 ? OPCODE_MUL : (op->id == 7 ? OPCODE_DIV : OPCODE_POW);
+            // Check for 0^y with y <= 0 can be omitted when exponent is a positive constant
+            if (op->id == 8 && get_type(get_child(tree, 1)) == NTYPE_CONSTANT
+                && get_const_value(get_child(tree, 1)) > 0)
+            {
+                opcode = OPCODE_POW_CONST;
+            }
+            *out_register = emit(comp, (Instruction){ .opcode = opcode, .dest = dest, .a = a, .b = b });
+            return true;
+        }
+
+        case 3: // deriv(x, y), evaluated in forward mode
+        {
+            const Node *var = get_child(tree, 1);
+            if (get_type(var) != NTYPE_VARIABLE) return false;
+            return compile_dual(comp, get_child(tree, 0), get_var_name(var), depth, &a, out_register);
+        }
+
+        case 12: // -x
+        case 15: // exp(x)
+        case 17: // sqrt(x)
+        case 19: // ln(x)
+        case 22: // sin(x)
+        case 23: // cos(x)
+        {
+            if (!compile_node(comp, get_child(tree, 0), depth, &a)) return false;
+            Opcode opcode;
+            switch (op->id)
+            {
+                case 12: opcode = OPCODE_NEG;  break;
+                case 15: opcode = OPCODE_EXP;  break;
+                case 17: opcode = OPCODE_SQRT; break;
+                case 19: opcode = OPCODE_LN;   break;
+                case 22: opcode = OPCODE_SIN;  break;
+                default: opcode = OPCODE_COS;
+            }
+            *out_register = emit(comp, (Instruction){ .opcode = opcode, .dest = dest, .a = a });
+            return true;
+        }
+
+        default:
+        {
+            // History does not change while a program runs, so entries are looked up once when compiling
+            // Programs are thus free of global state (except for rand) and can be run concurrently
+            double value;
+            if (is_history_lookup(tree)
+                && history_get(op->id == 56 ? 0 : (int)get_const_value(get_child(tree, 0)), &value))
+            {
+                *out_register = comp->num_vars + vec_count(&comp->program->constants);
+                VEC_PUSH_ELEM(&comp->program->constants, double, value);
+                return true;
+            }
+
+            if (op->id == 48) comp->program->has_side_effects = true; // rand(x, y)
+            const Program *callee = get_composite_program(op);
+            if (callee != NULL && callee->has_side_effects) comp->program->has_side_effects = true;
+
+            // Registers of arguments are reserved first, since nested calls append their own arguments
+            size_t first_arg = vec_count(&comp->program->call_args);
+            for (size_t i = 0; i < num_children; i++)
+            {
+                VEC_PUSH_ELEM(&comp->program->call_args, unsigned int, 0);
+            }
+            for (size_t i = 0; i < num_children; i++)
+            {
+                unsigned int arg;
+                if (!compile_node(comp, get_child(tree, i), depth + i, &arg)) return false;
+                VEC_SET_ELEM(&comp->program->call_args, unsigned int, first_arg + i, arg);
+            }
+            *out_register = emit(comp, (Instruction){
+                .opcode = OPCODE_CALL,
+                .num_args = (unsigned char)num_children,
+                .dest = dest,
+                .a = first_arg,
+                .b = op->id });
+            return true;
+        }
+    }
+}
+
+/*
+Summary: Translates tree to a program that can be run many times
+Params
+    tree:        Arithmetic tree, calls of compiled user-defined functions run their programs
+    num_vars:    Number of variable slots
+    vars:        Names of variables, i-th name is bound to i-th value when running program
+    out_program: Free with free_program when true is returned
+Returns: False if tree contains a variable that is not in vars or a non-arithmetic operator
+*/
+bool compile_program(const Node *tree, size_t num_vars, const char **vars, Program *out_program)
+{
+    out_program->instructions = vec_create(sizeof(Instruction), INSTRUCTIONS_STARTSIZE);
+    out_program->constants = vec_create(sizeof(double), CONSTANTS_STARTSIZE);
+    out_program->call_args = vec_create(sizeof(unsigned int), CALL_ARGS_STARTSIZE);
+    out_program->num_vars = num_vars;
+    out_program->has_side_effects = false;
+    out_program->native_code = NULL;
+    out_program->native_size = 0;
+
+    Compilation comp = {
+        .num_vars = num_vars,
+        .vars = vars,
+        .first_temp = num_vars + count_constants(tree),
+        .program = out_program
+    };
+    out_program->num_registers = comp.first_temp;
+
+    unsigned int result;
+    if (!compile_node(&comp, tree, 0, &result))
+    {
+        free_program(out_program);
+        return false;
+    }
+    out_program->result_register = result;
+    vec_trim(&out_program->instructions);
+    // Translate to machine code where supported, program is interpreted otherwise
+    jit_compile(out_program);
+    return true;
+}
+
+/*
+Summary: Evaluates program, equivalent to tree_reduce with arith_op_evaluate on the compiled tree
+    Fails with LISTENERERR_BUDGET_EXCEEDED when command has been cancelled or its time is exhausted
+Params
+    var_values: Values of variable slots, can be NULL if program has none
+    out:        Only written when evaluation succeeds
+*/
+ListenerError run_program(const Program *program, const double *var_values, double *out)
+{
+    if (governor_is_stopped()) return LISTENERERR_BUDGET_EXCEEDED;
+
+    double local_regs[LOCAL_REGISTERS];
+    double *regs = local_regs;
+    if (program->num_registers > LOCAL_REGISTERS)
+    {
+        regs = malloc_wrapper(program->num_registers * sizeof(double));
+    }
+
+    ListenerError err = LISTENERERR_SUCCESS;
+    if (program->native_code != NULL)
+    {
+        err = program->native_code(var_values, regs, out);
+        goto exit;
+    }
+
+    if (program->num_vars > 0) memcpy(regs, var_values, program->num_vars * sizeof(double));
+    memcpy(regs + program->num_vars, program->constants.buffer, vec_count(&program->constants) * sizeof(double));
+
+    const Instruction *instructions = (const Instruction*)program->instructions.buffer;
+    const unsigned int *call_args = (const unsigned int*)program->call_args.buffer;
+    size_t num_instructions = vec_count(&program->instructions);
+
+    for (size_t i = 0; i < num_instructions; i++)
+    {
+        const Instruction *instr = instructions + i;
+        switch ((Opcode)instr->opcode)
+        {
+            case OPCODE_ADD:
+                regs[instr->dest] = regs[instr->a] + regs[instr->b];
+                break;
+            case OPCODE_SUB:
+                regs[instr->dest] = regs[instr->a] - regs[instr->b];
+                break;
+            case OPCODE_MUL:
+                regs[instr->dest] = regs[instr->a] * regs[instr->b];
+                break;
+            case OPCODE_DIV:
+                if (regs[instr->b] == 0)
+                {
+                    err = LISTENERERR_DIVISION_BY_ZERO;
+                    goto exit;
+                }
+                regs[instr->dest] = regs[instr->a] / regs[instr->b];
+                break;
+            case OPCODE_POW:
+                if (regs[instr->a] == 0 && regs[instr->b] <= 0)
+                {
+                    err = LISTENERERR_DIVISION_BY_ZERO;
+                    goto exit;
+                }
+                regs[instr->dest] = pow(regs[instr->a], regs[instr->b]);
+                break;
+            case OPCODE_POW_CONST:
+                regs[instr->dest] = pow(regs[instr->a], regs[instr->b]);
+                break;
+            case OPCODE_NEG:
+                regs[instr->dest] = -regs[instr->a];
+                break;
+            case OPCODE_EXP:
+                regs[instr->dest] = exp(regs[instr->a]);
+                break;
+            case OPCODE_SQRT:
+                regs[instr->dest] = sqrt(regs[instr->a]);
+                break;
+            case OPCODE_LN:
+                regs[instr->dest] = log(regs[instr->a]);
+                break;
+            case OPCODE_SIN:
+                regs[instr->dest] = sin(regs[instr->a]);
+                break;
+            case OPCODE_COS:
+                regs[instr->dest] = cos(regs[instr->a]);
+                break;
+            case OPCODE_MUL_ADD:
+                regs[instr->dest] = regs[instr->a] * regs[instr->b] + regs[instr->c];
+                break;
+            case OPCODE_ADD_MUL:
+                regs[instr->dest] = regs[instr->c] + regs[instr->a] * regs[instr->b];
+                break;
+            case OPCODE_MUL_SUB:
+                regs[instr->dest] = regs[instr->a] * regs[instr->b] - regs[instr->c];
+                break;
+            case OPCODE_SUB_MUL:
+                regs[instr->dest] = regs[instr->c] - regs[instr->a] * regs[instr->b];
+                break;
+            case OPCODE_CALL:
+            {
+                double args[MAX_CHILDREN];
+                for (size_t j = 0; j < instr->num_args; j++)
+                {
+                    args[j] = regs[call_args[instr->a + j]];
+                }
+                err = arith_id_evaluate(instr->b, instr->num_args, args, regs + instr->dest);
+                if (err != LISTENERERR_SUCCESS) goto exit;
+                break;
+            }
+        }
+    }
+    *out = regs[program->result_register];
+
+    exit:
+    if (regs != local_regs) free(regs);
+    return err;
+}
+
+/*
+Summary: Evaluates program for many variable bindings at once
+    Each instruction is executed for a whole column of rows, so the inner loops are simple and vectorizable
+    Transcendental functions are computed by the SIMD kernels of vector_math.h
+    Error code of each row is the same as that of run_program, result is the same within error bounds of kernels
+    Cancellation and time of command are checked once per batch of rows
+Params
+    var_columns: i-th column holds num_rows values of i-th variable slot
+    out_results: Result of each row, undefined for rows with error
+    out_errors:  Error code of each row
+*/
+void run_program_batch(const Program *program, size_t num_rows, const double **var_columns,
+    double *out_results, ListenerError *out_errors)
+{
+    double *regs = malloc_wrapper(program->num_registers * BATCH_SIZE * sizeof(double));
+    const Instruction *instructions = (const Instruction*)program->instructions.buffer;
+    const unsigned int *call_args = (const unsigned int*)program->call_args.buffer;
+    const double *constants = (const double*)program->constants.buffer;
+    size_t num_instructions = vec_count(&program->instructions);
+
+    for (size_t start = 0; start < num_rows; start += BATCH_SIZE)
+    {
+        size_t n = num_rows - start < BATCH_SIZE ? num_rows - start : BATCH_SIZE;
+        ListenerError *errs = out_errors + start;
+
+        ListenerError initial = governor_is_stopped() ? LISTENERERR_BUDGET_EXCEEDED : LISTENERERR_SUCCESS;
+        for (size_t r = 0; r < n; r++) errs[r] = initial;
+        if (initial != LISTENERERR_SUCCESS) continue;
+        for (size_t i = 0; i < program->num_vars; i++)
+        {
+            memcpy(regs + i * BATCH_SIZE, var_columns[i] + start, n * sizeof(double));
+        }
+        for (size_t i = 0; i < vec_count(&program->constants); i++)
+        {
+            double *reg = regs + (program->num_vars + i) * BATCH_SIZE;
+            for (size_t r = 0; r < n; r++) reg[r] = constants[i];
+        }
+
+        for (size_t i = 0; i < num_instructions; i++)
+        {
+            const Instruction *instr = instructions + i;
+            double *dest = regs + instr->dest * BATCH_SIZE;
+            const double *a = regs + instr->a * BATCH_SIZE;
+            const double *b = regs + instr->b * BATCH_SIZE;
+            const double *c = regs + instr->c * BATCH_SIZE;
+
+            // Rows with error keep being computed (except for calls), their values are ignored
+            switch ((Opcode)instr->opcode)
+            {
+                case OPCODE_ADD:
+                    for (size_t r = 0; r < n; r++) dest[r] = a[r] + b[r];
+                    break;
+                case OPCODE_SUB:
+                    for (size_t r = 0; r < n; r++) dest[r] = a[r] - b[r];
+                    break;
+                case OPCODE_MUL:
+                    for (size_t r = 0; r < n; r++) dest[r] = a[r] * b[r];
+                    break;
+                case OPCODE_DIV:
+                    for (size_t r = 0; r < n; r++)
+                    {
+                        if (b[r] == 0 && errs[r] == LISTENERERR_SUCCESS) errs[r] = LISTENERERR_DIVISION_BY_ZERO;
+                    }
+                    for (size_t r = 0; r < n; r++) dest[r] = a[r] / b[r];
+                    break;
+                case OPCODE_POW:
+                    for (size_t r = 0; r < n; r++)
+                    {
+                        if (a[r] == 0 && b[r] <= 0 && errs[r] == LISTENERERR_SUCCESS) errs[r] = LISTENERERR_DIVISION_BY_ZERO;
+                    }
+                    vmath_pow(n, a, b, dest);
+                    break;
+                case OPCODE_POW_CONST:
+                    vmath_pow(n, a, b, dest);
+                    break;
+                case OPCODE_NEG:
+                    for (size_t r = 0; r < n; r++) dest[r] = -a[r];
+                    break;
+                case OPCODE_EXP:
+                    vmath_exp(n, a, dest);
+                    break;
+                case OPCODE_SQRT:
+                    for (size_t r = 0; r < n; r++) dest[r] = sqrt(a[r]);
+                    break;
+                case OPCODE_LN:
+                    vmath_ln(n, a, dest);
+                    break;
+                case OPCODE_SIN:
+                    vmath_sin(n, a, dest);
+                    break;
+                case OPCODE_COS:
+                    vmath_cos(n, a, dest);
+                    break;
+                case OPCODE_MUL_ADD:
+                    for (size_t r = 0; r < n; r++) dest[r] = a[r] * b[r] + c[r];
+                    break;
+                case OPCODE_ADD_MUL:
+                    for (size_t r = 0; r < n; r++) dest[r] = c[r] + a[r] * b[r];
+                    break;
+                case OPCODE_MUL_SUB:
+                    for (size_t r = 0; r < n; r++) dest[r] = a[r] * b[r] - c[r];
+                    break;
+                case OPCODE_SUB_MUL:
+                    for (size_t r = 0; r < n; r++) dest[r] = c[r] - a[r] * b[r];
+                    break;
+                case OPCODE_CALL:
+                    if (instr->b == 27) // atan(x)
+                    {
+                        vmath_atan(n, regs + call_args[instr->a] * BATCH_SIZE, dest);
+                        break;
+                    }
+                    if (get_plugin_op(instr->b) != NULL)
+                    {
+                        // Operators of plugins can evaluate whole columns at once
+                        const double *args[MAX_CHILDREN];
+                        for (size_t j = 0; j < instr->num_args; j++)
+                        {
+                            args[j] = regs + call_args[instr->a + j] * BATCH_SIZE;
+                        }
+                        plugin_id_evaluate_batch(instr->b, n, instr->num_args, args, dest, errs);
+                        break;
+                    }
+                    // Operators like fib can take very long on garbage values, thus skip rows with error
+                    for (size_t r = 0; r < n; r++)
+                    {
+                        if (errs[r] != LISTENERERR_SUCCESS) continue;
+                        double args[MAX_CHILDREN];
+                        for (size_t j = 0; j < instr->num_args; j++)
+                        {
+                            args[j] = regs[call_args[instr->a + j] * BATCH_SIZE + r];
+                        }
+                        errs[r] = arith_id_evaluate(instr->b, instr->num_args, args, dest + r);
+                    }
+                    break;
+            }
+        }
+
+        memcpy(out_results + start, regs + program->result_register * BATCH_SIZE, n * sizeof(double));
+    }
+
+    free(regs);
+}
+
+void free_program(Program *program)
+{
+    vec_destroy(&program->instructions);
+    vec_destroy(&program->constants);
+    vec_destroy(&program->call_args);
+    jit_free(program);
+}
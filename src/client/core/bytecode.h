@@ -0,0 +1,78 @@
+#pragma once
+#include <stdbool.h>
+#include "../../engine/tree/node.h"
+#include "../../engine/tree/tree_util.h"
+#include "../../util/vector.h"
+
+/*
+An arithmetic expression can be compiled once and then evaluated many times with different variable bindings.
+A program is executed by a register machine. Registers are laid out as follows:
+    [0, num_vars)                         Variables, bound when running the program
+    [num_vars, num_vars + num_constants)  Constants pool
+    [num_vars + num_constants, ...)       Temporary results of operators
+Operands of instructions are registers, thus variables and constants are never loaded explicitly.
+*/
+/*
+Superinstructions are selected from the shape of the tree when compiling.
+All instructions compute exactly what tree_reduce computes, in the same order.
+Only run_program_batch computes transcendental functions by SIMD kernels, within error bounds of vector_math.h.
+Derivatives, which tree_reduce can not evaluate, are compiled to instructions that compute
+value and derivative of their operand side by side (forward mode automatic differentiation).
+*/
+typedef enum {
+    OPCODE_ADD,       // dest = a + b
+    OPCODE_SUB,       // dest = a - b
+    OPCODE_MUL,       // dest = a * b
+    OPCODE_DIV,       // dest = a / b
+    OPCODE_POW,       // dest = a ^ b
+    OPCODE_POW_CONST, // dest = a ^ b, where b is a positive constant that needs no check
+    OPCODE_NEG,       // dest = -a
+    OPCODE_EXP,       // dest = exp(a)
+    OPCODE_SQRT,      // dest = sqrt(a)
+    OPCODE_LN,        // dest = ln(a)
+    OPCODE_SIN,       // dest = sin(a)
+    OPCODE_COS,       // dest = cos(a)
+    OPCODE_MUL_ADD,   // dest = a * b + c
+    OPCODE_ADD_MUL,   // dest = c + a * b
+    OPCODE_MUL_SUB,   // dest = a * b - c
+    OPCODE_SUB_MUL,   // dest = c - a * b
+    OPCODE_CALL,      // dest = op(call_args[a], ..., call_args[a + num_args - 1]), op is arithmetic operator with id b
+} Opcode;
+
+typedef struct {
+    unsigned char opcode;
+    unsigned char num_args; // Only used by OPCODE_CALL
+    unsigned int dest;
+    unsigned int a;
+    unsigned int b;
+    unsigned int c;
+} Instruction;
+
+/*
+Summary: Native code of a program, reads variables and constants in place and only uses temporary registers
+Params
+    vars: Values of variable slots
+    regs: Register file of program
+    out:  Only written when evaluation succeeds
+Returns: Error code of first failing instruction, LISTENERERR_SUCCESS otherwise
+*/
+typedef int (*NativeFunction)(const double *vars, double *regs, double *out);
+
+typedef struct {
+    Vector instructions;    // Payload: Instruction
+    Vector constants;       // Constants pool (payload: double)
+    Vector call_args;       // Argument registers of operators without own instruction (payload: unsigned int)
+    size_t num_vars;        // Number of variable slots that need to be bound when running the program
+    size_t num_registers;   // Total number of registers needed
+    size_t result_register; // Register that holds result after execution
+    bool has_side_effects;  // True if program calls rand, its rows must then be evaluated in order
+    NativeFunction native_code; // Machine code translated from instructions, NULL when interpreted (see jit.h)
+    size_t native_size;     // Size of mapping of native_code in bytes
+} Program;
+
+bool can_compile_derivatives(const Node *tree);
+bool compile_program(const Node *tree, size_t num_vars, const char **vars, Program *out_program);
+ListenerError run_program(const Program *program, const double *var_values, double *out);
+void run_program_batch(const Program *program, size_t num_rows, const double **var_columns,
+    double *out_results, ListenerError *out_errors);
+void free_program(Program *program);
@@ -0,0 +1,540 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "../../util/console_util.h"
+#include "../../engine/tree/tree_util.h"
+#include "../../engine/tree/tree_to_string.h"
+#include "../version.h"
+#include "arith_context.h"
+#include "integer_kernels.h"
+#include "c_export.h"
+
+/*
+Generates a C99 module with one function per user-defined function or constant.
+Right hand sides are simplified when they are defined, calls of other user-defined functions remain calls.
+Functions are generated in order of definition, thus every callee is defined before its callers.
+Each operator is translated to a statement that computes exactly what arith_op_evaluate computes,
+in the order of tree_reduce, such that results and errors are the same as in ccalc.
+*/
+
+#define BUILDER_STARTSIZE 256
+#define OPERAND_STARTSIZE 16
+
+// Error codes in generated module, same values as ListenerError
+#define SUCCESS_NAME           "CCALC_SUCCESS"
+#define DIVISION_BY_ZERO_NAME  "CCALC_DIVISION_BY_ZERO"
+
+typedef enum {
+    HELPER_GCD_U64,
+    HELPER_GCD,
+    HELPER_LCM,
+    HELPER_BINOMIAL,
+    HELPER_FACTORIAL,
+    HELPER_RANDOM,
+    HELPER_FIBONACCI,
+    NUM_HELPERS
+} Helper;
+
+// Implementations of operators that are not in math.h, equivalent to integer_kernels.c and arith_evaluation.c
+// Only helpers that are used are emitted, each helper only calls helpers that precede it
+static const char *HELPER_SOURCES[NUM_HELPERS] = {
+    "static uint64_t ccalc_gcd_u64(uint64_t a, uint64_t b)\n"
+    "{\n"
+    "    while (b != 0)\n"
+    "    {\n"
+    "        uint64_t rem = a % b;\n"
+    "        a = b;\n"
+    "        b = rem;\n"
+    "    }\n"
+    "    return a;\n"
+    "}\n",
+
+    "static double ccalc_gcd(double a, double b)\n"
+    "{\n"
+    "    a = fabs(trunc(a));\n"
+    "    b = fabs(trunc(b));\n"
+    "    if (!isfinite(a) || !isfinite(b)) return NAN;\n"
+    "    if (a < 18446744073709551616.0 && b < 18446744073709551616.0) return (double)ccalc_gcd_u64((uint64_t)a, (uint64_t)b);\n"
+    "    while (b != 0)\n"
+    "    {\n"
+    "        double rem = fmod(a, b);\n"
+    "        a = b;\n"
+    "        b = rem;\n"
+    "    }\n"
+    "    return a;\n"
+    "}\n",
+
+    "static double ccalc_lcm(double a, double b)\n"
+    "{\n"
+    "    double gcd = ccalc_gcd(a, b);\n"
+    "    if (gcd == 0) return 0;\n"
+    "    return fabs(trunc(a)) / gcd * fabs(trunc(b));\n"
+    "}\n",
+
+    "static double ccalc_binomial(double n, double k)\n"
+    "{\n"
+    "    n = fabs(trunc(n));\n"
+    "    k = fabs(trunc(k));\n"
+    "    if (isnan(n) || isnan(k)) return NAN;\n"
+    "    if (k > n) return 0;\n"
+    "    if (2 * k > n) k = n - k;\n"
+    "    if (n < 18446744073709551616.0)\n"
+    "    {\n"
+    "        uint64_t res = 1;\n"
+    "        uint64_t i = 1;\n"
+    "        for (; i <= (uint64_t)k; i++)\n"
+    "        {\n"
+    "            uint64_t gcd = ccalc_gcd_u64(res, i);\n"
+    "            uint64_t factor = ((uint64_t)n - (uint64_t)k + i) / (i / gcd);\n"
+    "            res /= gcd;\n"
+    "            if (res > UINT64_MAX / factor) break;\n"
+    "            res *= factor;\n"
+    "        }\n"
+    "        if (i > (uint64_t)k) return (double)res;\n"
+    "    }\n"
+    "    if (k <= 256)\n"
+    "    {\n"
+    "        double res = 1;\n"
+    "        for (double i = 1; i <= k; i++)\n"
+    "        {\n"
+    "            res = (res * (n - k + i)) / i;\n"
+    "        }\n"
+    "        return res;\n"
+    "    }\n"
+    "    return round(exp(lgamma(n + 1) - lgamma(k + 1) - lgamma(n - k + 1)));\n"
+    "}\n",
+
+    "static double ccalc_factorial(double n)\n"
+    "{\n"
+    "    if (isnan(n)) return NAN;\n"
+    "    n = trunc(n);\n"
+    "    if (n < 0) return 1;\n"
+    "    if (n >= sizeof(ccalc_factorial_table) / sizeof(double)) return INFINITY;\n"
+    "    return ccalc_factorial_table[(size_t)n];\n"
+    "}\n",
+
+    "static double ccalc_random_between(double min, double max)\n"
+    "{\n"
+    "    min = trunc(min);\n"
+    "    max = trunc(max);\n"
+    "    long diff = (long)(max - min);\n"
+    "    if (diff < 1) return -1;\n"
+    "    return rand() % diff + min;\n"
+    "}\n",
+
+    "static void ccalc_fib_pair(uint64_t n, double *out_fn, double *out_fn1)\n"
+    "{\n"
+    "    if (n < sizeof(ccalc_fib_table) / sizeof(double) - 1)\n"
+    "    {\n"
+    "        *out_fn = ccalc_fib_table[n];\n"
+    "        *out_fn1 = ccalc_fib_table[n + 1];\n"
+    "        return;\n"
+    "    }\n"
+    "    double a, b;\n"
+    "    ccalc_fib_pair(n / 2, &a, &b);\n"
+    "    double even = a * (2 * b - a);\n"
+    "    double odd = a * a + b * b;\n"
+    "    *out_fn = n % 2 == 0 ? even : odd;\n"
+    "    *out_fn1 = n % 2 == 0 ? odd : even + odd;\n"
+    "}\n"
+    "\n"
+    "static double ccalc_fibonacci(double n)\n"
+    "{\n"
+    "    if (isnan(n)) return NAN;\n"
+    "    n = trunc(n);\n"
+    "    double abs_n = fabs(n);\n"
+    "    int negate = n < 0 && fmod(abs_n, 2) == 0;\n"
+    "    double res = INFINITY;\n"
+    "    double next;\n"
+    "    if (abs_n <= 1476) ccalc_fib_pair((uint64_t)abs_n, &res, &next);\n"
+    "    return negate ? -res : res;\n"
+    "}\n"
+};
+
+// Tables that precede sources of helpers, i-th entry is function of i
+static const struct {
+    const char *name;
+    size_t size;
+    double (*function)(double);
+} HELPER_TABLES[NUM_HELPERS] = {
+    [HELPER_FACTORIAL] = { "ccalc_factorial_table", FACTORIAL_TABLE_SIZE, int_factorial },
+    [HELPER_FIBONACCI] = { "ccalc_fib_table", FIB_TABLE_SIZE, int_fib }
+};
+
+// Names that parameters must not shadow: keywords and functions called by generated code
+static const char *RESERVED_NAMES[] = {
+    "auto", "break", "case", "char", "const", "continue", "default", "do", "double", "else", "enum",
+    "extern", "float", "for", "goto", "if", "inline", "int", "long", "register", "restrict", "return",
+    "short", "signed", "sizeof", "static", "struct", "switch", "typedef", "union", "unsigned", "void",
+    "volatile", "while", "out", "pow", "fmod", "exp", "sqrt", "log", "log2", "log10", "sin", "cos", "tan",
+    "asin", "acos", "atan", "sinh", "cosh", "tanh", "asinh", "acosh", "atanh", "fabs", "ceil", "floor",
+    "round", "trunc", "tgamma", "lgamma", "isinf", "isnan", "isfinite", "rand", "INFINITY", "NAN",
+    "uint64_t", "UINT64_MAX", "size_t"
+};
+
+typedef struct {
+    StringBuilder *body;            // Statements of function that is generated
+    size_t num_temps;               // Number of temporary variables declared in body
+    bool *used_helpers;             // Helpers that need to be emitted before functions
+    const char *function_name;      // Name of function that is generated, for error messages
+} Generator;
+
+static bool is_reserved(const char *name)
+{
+    for (size_t i = 0; i < sizeof(RESERVED_NAMES) / sizeof(RESERVED_NAMES[0]); i++)
+    {
+        if (strcmp(name, RESERVED_NAMES[i]) == 0) return true;
+    }
+    return false;
+}
+
+// Appends name of parameter, reserved names get a trailing underscore
+static void append_param(StringBuilder *builder, const char *name)
+{
+    strbuilder_append(builder, is_reserved(name) ? "%s_" : "%s", name);
+}
+
+static void append_constant(StringBuilder *builder, double value)
+{
+    if (isnan(value))
+    {
+        strbuilder_append(builder, "NAN");
+    }
+    else if (isinf(value))
+    {
+        strbuilder_append(builder, value > 0 ? "INFINITY" : "(-INFINITY)");
+    }
+    else
+    {
+        // 17 significant digits are always read back to the same double
+        char literal[32];
+        snprintf(literal, sizeof(literal), "%.17g", value);
+        // Literal must be floating, otherwise C would divide integers
+        const char *suffix = strpbrk(literal, ".e") == NULL ? ".0" : "";
+        strbuilder_append(builder, value < 0 ? "(%s%s)" : "%s%s", literal, suffix);
+    }
+}
+
+// Returns true if node is a constant for which predicate holds
+static bool is_constant_where(const Node *node, bool (*predicate)(double))
+{
+    return get_type(node) == NTYPE_CONSTANT && predicate(get_const_value(node));
+}
+
+static bool is_positive(double value)
+{
+    return value > 0;
+}
+
+static bool is_nonzero(double value)
+{
+    return value != 0;
+}
+
+/*
+Summary: Appends "double t<n> = " to body
+Returns: Index of new temporary
+*/
+static size_t begin_temp(Generator *gen)
+{
+    strbuilder_append(gen->body, "    double t%zu = ", gen->num_temps);
+    return gen->num_temps++;
+}
+
+/*
+Summary: Appends C expression of variadic operator to body, e.g. "(0.0 + a + b)" for sum
+*/
+static void append_fold(Generator *gen, const char *init, const char *op, size_t num_args, StringBuilder *args)
+{
+    strbuilder_append(gen->body, "(%s", init);
+    for (size_t i = 0; i < num_args; i++) strbuilder_append(gen->body, " %s %s", op, args[i].buffer);
+    strbuilder_append(gen->body, ")");
+}
+
+/*
+Summary: Appends statements that compute value of node to body
+Params
+    out_operand: C expression of value of node is appended to it (constant, parameter or temporary)
+Returns: False if node contains an operator that can not be exported
+*/
+static bool generate_node(Generator *gen, const Node *node, StringBuilder *out_operand)
+{
+    switch (get_type(node))
+    {
+        case NTYPE_CONSTANT:
+            append_constant(out_operand, get_const_value(node));
+            return true;
+        case NTYPE_VARIABLE:
+            append_param(out_operand, get_var_name(node));
+            return true;
+        case NTYPE_OPERATOR:
+            break;
+    }
+
+    size_t id = get_op(node)->id;
+    size_t num_args = get_num_children(node);
+    if (id == 1 || id == 56)
+    {
+        report_error("Error: '%s' depends on history and can not be exported\n", gen->function_name);
+        return false;
+    }
+    bool is_call = get_composite_function(get_op(node)) != NULL;
+    if (id == 2 || id == 3 || (id >= NUM_ARITH_OPS && !is_call))
+    {
+        report_error("Error: '%s' contains '%s' which can not be exported\n", gen->function_name, get_op(node)->name);
+        return false;
+    }
+
+    // Children are computed first and from left to right, like in tree_reduce
+    StringBuilder args[MAX_CHILDREN];
+    bool success = true;
+    size_t num_generated = 0;
+    for (; num_generated < num_args && success; num_generated++)
+    {
+        args[num_generated] = strbuilder_create(OPERAND_STARTSIZE);
+        success = generate_node(gen, get_child(node, num_generated), &args[num_generated]);
+    }
+    if (!success) goto exit;
+
+    // Identities do not need a temporary
+    if (id == 0 || id == 11)
+    {
+        strbuilder_append(out_operand, "%s", args[0].buffer);
+        goto exit;
+    }
+
+    if (is_call)
+    {
+        // Error of callee is passed on
+        size_t temp = gen->num_temps++;
+        strbuilder_append(gen->body, "    double t%zu;\n    int e%zu = " C_EXPORT_PREFIX "%s(", temp, temp, get_op(node)->name);
+        for (size_t i = 0; i < num_args; i++) strbuilder_append(gen->body, "%s, ", args[i].buffer);
+        strbuilder_append(gen->body, "&t%zu);\n    if (e%zu != " SUCCESS_NAME ") return e%zu;\n", temp, temp, temp);
+        strbuilder_append(out_operand, "t%zu", temp);
+        goto exit;
+    }
+
+    const char *a = num_args > 0 ? args[0].buffer : NULL;
+    const char *b = num_args > 1 ? args[1].buffer : NULL;
+
+    // Checks that may fail, skipped when constant operands can not trigger them
+    if (id == 7 && !is_constant_where(get_child(node, 1), is_nonzero))
+    {
+        strbuilder_append(gen->body, "    if (%s == 0) return " DIVISION_BY_ZERO_NAME ";\n", b);
+    }
+    if (id == 8 && !is_constant_where(get_child(node, 0), is_nonzero)
+        && !is_constant_where(get_child(node, 1), is_positive))
+    {
+        strbuilder_append(gen->body, "    if (%s == 0 && %s <= 0) return " DIVISION_BY_ZERO_NAME ";\n", a, b);
+    }
+
+    size_t temp = begin_temp(gen);
+    switch (id)
+    {
+        case 4:  strbuilder_append(gen->body, "%s + %s", a, b); break;
+        case 5:  strbuilder_append(gen->body, "%s - %s", a, b); break;
+        case 6:  strbuilder_append(gen->body, "%s * %s", a, b); break;
+        case 7:  strbuilder_append(gen->body, "%s / %s", a, b); break;
+        case 8:  strbuilder_append(gen->body, "pow(%s, %s)", a, b); break;
+        case 9:
+            strbuilder_append(gen->body, "ccalc_binomial(%s, %s)", a, b);
+            gen->used_helpers[HELPER_GCD_U64] = true;
+            gen->used_helpers[HELPER_BINOMIAL] = true;
+            break;
+        case 10: strbuilder_append(gen->body, "fmod(%s, %s)", a, b); break;
+        case 12: strbuilder_append(gen->body, "-%s", a); break;
+        case 13:
+            strbuilder_append(gen->body, "ccalc_factorial(%s)", a);
+            gen->used_helpers[HELPER_FACTORIAL] = true;
+            break;
+        case 14: strbuilder_append(gen->body, "%s / 100", a); break;
+        case 15: strbuilder_append(gen->body, "exp(%s)", a); break;
+        case 16: strbuilder_append(gen->body, "pow(%s, 1 / %s)", a, b); break;
+        case 17: strbuilder_append(gen->body, "sqrt(%s)", a); break;
+        case 18: strbuilder_append(gen->body, "log(%s) / log(%s)", a, b); break;
+        case 19: strbuilder_append(gen->body, "log(%s)", a); break;
+        case 20: strbuilder_append(gen->body, "log2(%s)", a); break;
+        case 21: strbuilder_append(gen->body, "log10(%s)", a); break;
+        case 22: strbuilder_append(gen->body, "sin(%s)", a); break;
+        case 23: strbuilder_append(gen->body, "cos(%s)", a); break;
+        case 24: strbuilder_append(gen->body, "tan(%s)", a); break;
+        case 25: strbuilder_append(gen->body, "asin(%s)", a); break;
+        case 26: strbuilder_append(gen->body, "acos(%s)", a); break;
+        case 27: strbuilder_append(gen->body, "atan(%s)", a); break;
+        case 28: strbuilder_append(gen->body, "sinh(%s)", a); break;
+        case 29: strbuilder_append(gen->body, "cosh(%s)", a); break;
+        case 30: strbuilder_append(gen->body, "tanh(%s)", a); break;
+        case 31: strbuilder_append(gen->body, "asinh(%s)", a); break;
+        case 32: strbuilder_append(gen->body, "acosh(%s)", a); break;
+        case 33: strbuilder_append(gen->body, "atanh(%s)", a); break;
+        case 34: // max
+        case 35: // min
+            strbuilder_append(gen->body, id == 34 ? "-INFINITY;\n" : "INFINITY;\n");
+            for (size_t i = 0; i < num_args; i++)
+            {
+                strbuilder_append(gen->body, "    if (%s %c t%zu) t%zu = %s;\n",
+                    args[i].buffer, id == 34 ? '>' : '<', temp, temp, args[i].buffer);
+            }
+            strbuilder_append(out_operand, "t%zu", temp);
+            goto exit;
+        case 36: strbuilder_append(gen->body, "fabs(%s)", a); break;
+        case 37: strbuilder_append(gen->body, "ceil(%s)", a); break;
+        case 38: strbuilder_append(gen->body, "floor(%s)", a); break;
+        case 39: strbuilder_append(gen->body, "round(%s)", a); break;
+        case 40: strbuilder_append(gen->body, "trunc(%s)", a); break;
+        case 41: strbuilder_append(gen->body, "%s - floor(%s)", a, a); break;
+        case 42: strbuilder_append(gen->body, "%s < 0 ? -1 : (%s > 0 ? 1 : 0)", a, a); break;
+        case 43: append_fold(gen, "0.0", "+", num_args, args); break;
+        case 44: append_fold(gen, "1.0", "*", num_args, args); break;
+        case 45:
+            if (num_args == 0)
+            {
+                strbuilder_append(gen->body, "0");
+            }
+            else
+            {
+                append_fold(gen, "0.0", "+", num_args, args);
+                strbuilder_append(gen->body, " / %zu", num_args);
+            }
+            break;
+        case 46:
+            strbuilder_append(gen->body, "ccalc_gcd(%s, %s)", a, b);
+            gen->used_helpers[HELPER_GCD_U64] = true;
+            gen->used_helpers[HELPER_GCD] = true;
+            break;
+        case 47:
+            strbuilder_append(gen->body, "ccalc_lcm(%s, %s)", a, b);
+            gen->used_helpers[HELPER_GCD_U64] = true;
+            gen->used_helpers[HELPER_GCD] = true;
+            gen->used_helpers[HELPER_LCM] = true;
+            break;
+        case 48:
+            strbuilder_append(gen->body, "ccalc_random_between(%s, %s)", a, b);
+            gen->used_helpers[HELPER_RANDOM] = true;
+            break;
+        case 49:
+            strbuilder_append(gen->body, "ccalc_fibonacci(%s)", a);
+            gen->used_helpers[HELPER_FIBONACCI] = true;
+            break;
+        case 50: strbuilder_append(gen->body, "tgamma(%s)", a); break;
+        // Constants have the same (rounded) values as in ccalc
+        case 51: strbuilder_append(gen->body, "3.14159265359"); break;
+        case 52: strbuilder_append(gen->body, "2.71828182846"); break;
+        case 53: strbuilder_append(gen->body, "1.61803398874"); break;
+        case 54: strbuilder_append(gen->body, "299792458"); break;
+        case 55: strbuilder_append(gen->body, "343.2"); break;
+    }
+    strbuilder_append(gen->body, ";\n");
+    strbuilder_append(out_operand, "t%zu", temp);
+
+    exit:
+    for (size_t i = 0; i < num_generated; i++) vec_destroy(&args[i]);
+    return success;
+}
+
+/*
+Summary: Appends definition of function that evaluates rule's right hand side
+*/
+static bool generate_function(StringBuilder *builder, const RewriteRule *rule, bool *used_helpers)
+{
+    const Node *pattern = rule->pattern.pattern;
+    const char *name = get_op(pattern)->name;
+
+    // Definition in ccalc's syntax as comment
+    strbuilder_append(builder, "// ");
+    tree_to_strbuilder(builder, pattern, false);
+    strbuilder_append(builder, " = ");
+    tree_to_strbuilder(builder, rule->after, false);
+    strbuilder_append(builder, "\nint " C_EXPORT_PREFIX "%s(", name);
+    for (size_t i = 0; i < get_num_children(pattern); i++)
+    {
+        strbuilder_append(builder, "double ");
+        append_param(builder, get_var_name(get_child(pattern, i)));
+        strbuilder_append(builder, ", ");
+    }
+    strbuilder_append(builder, "double *out)\n{\n");
+
+    // Parameters that do not occur would trigger warnings of -Wextra
+    for (size_t i = 0; i < get_num_children(pattern); i++)
+    {
+        const char *param = get_var_name(get_child(pattern, i));
+        if (get_variable_nodes((const Node**)&rule->after, param, 0, NULL) == 0)
+        {
+            strbuilder_append(builder, "    (void)");
+            append_param(builder, param);
+            strbuilder_append(builder, ";\n");
+        }
+    }
+
+    StringBuilder result = strbuilder_create(OPERAND_STARTSIZE);
+    Generator gen = {
+        .body = builder,
+        .num_temps = 0,
+        .used_helpers = used_helpers,
+        .function_name = name
+    };
+    bool success = generate_node(&gen, rule->after, &result);
+    if (success)
+    {
+        strbuilder_append(builder, "    *out = %s;\n    return " SUCCESS_NAME ";\n}\n", result.buffer);
+    }
+    vec_destroy(&result);
+    return success;
+}
+
+/*
+Summary: Generates self-contained C99 source of all user-defined functions and constants
+    Function "f" is exported as "int ccalc_f(double x, ..., double *out)"
+    that returns 0 on success and an error code like in ccalc otherwise
+Params
+    builder: Source code is appended to it
+Returns: False if a function can not be exported (error is reported)
+*/
+bool export_c_module(StringBuilder *builder)
+{
+    bool used_helpers[NUM_HELPERS] = { false };
+    StringBuilder functions = strbuilder_create(BUILDER_STARTSIZE);
+
+    for (ListNode *curr = g_composite_functions->first; curr != NULL; curr = curr->next)
+    {
+        strbuilder_append(&functions, "\n");
+        if (!generate_function(&functions, (RewriteRule*)curr->data, used_helpers))
+        {
+            vec_destroy(&functions);
+            return false;
+        }
+    }
+
+    strbuilder_append(builder,
+        "/*\n"
+        "Generated by ccalc " CCALC_VERSION ".\n"
+        "Each function returns " SUCCESS_NAME " and writes its value to out on success,\n"
+        "or returns an error code without writing to out.\n"
+        "Built-in operators behave like in ccalc.\n"
+        "*/\n"
+        "#include <stdlib.h>\n"
+        "#include <stdint.h>\n"
+        "#include <math.h>\n"
+        "\n"
+        "#define " SUCCESS_NAME "          0\n"
+        "#define " DIVISION_BY_ZERO_NAME " 6\n");
+    for (size_t i = 0; i < NUM_HELPERS; i++)
+    {
+        if (!used_helpers[i]) continue;
+        if (HELPER_TABLES[i].name != NULL)
+        {
+            strbuilder_append(builder, "\nstatic const double %s[] = {", HELPER_TABLES[i].name);
+            for (size_t j = 0; j < HELPER_TABLES[i].size; j++)
+            {
+                strbuilder_append(builder, "%s%a", j % 4 == 0 ? "\n    " : " ", HELPER_TABLES[i].function(j));
+                if (j + 1 < HELPER_TABLES[i].size) strbuilder_append(builder, ",");
+            }
+            strbuilder_append(builder, "\n};\n");
+        }
+        strbuilder_append(builder, "\n%s", HELPER_SOURCES[i]);
+    }
+    strbuilder_append(builder, "%s", functions.buffer);
+    vec_destroy(&functions);
+    return true;
+}
@@ -0,0 +1,7 @@
+#pragma once
+#include <stdbool.h>
+#include "../../util/string_builder.h"
+
+#define C_EXPORT_PREFIX "ccalc_"
+
+bool export_c_module(StringBuilder *builder);
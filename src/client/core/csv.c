@@ -0,0 +1,268 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../util/alloc_wrappers.h"
+#include "../../util/string_util.h"
+#include "../../util/vector.h"
+#include "../../util/governor.h"
+#include "csv.h"
+
+// Initial size of read buffer, grows when a line does not fit
+#define READ_BUFFER_SIZE 65536
+// Number of rows that are evaluated column-at-a-time
+#define BATCH_SIZE        1024
+#define LINES_STARTSIZE  65536
+// Enough for any double printed by "%.17g"
+#define NUMBER_SIZE         32
+
+CsvReader csv_create_reader(FILE *file)
+{
+    return (CsvReader){
+        .file = file,
+        .buffer = malloc_wrapper(READ_BUFFER_SIZE),
+        .size = READ_BUFFER_SIZE,
+        .start = 0,
+        .end = 0,
+        .eof = false
+    };
+}
+
+/*
+Summary: Reads next line, line breaks (\n or \r\n) are removed
+Returns: Line that is valid until next call and can be modified, NULL at end of file
+*/
+char *csv_read_line(CsvReader *reader)
+{
+    while (true)
+    {
+        char *line = reader->buffer + reader->start;
+        char *newline = memchr(line, '\n', reader->end - reader->start);
+        if (newline != NULL || (reader->eof && reader->start < reader->end))
+        {
+            size_t length = newline != NULL ? (size_t)(newline - line) : reader->end - reader->start;
+            reader->start += newline != NULL ? length + 1 : length;
+            if (length > 0 && line[length - 1] == '\r') length--;
+            // A byte is always kept free after data, thus last line can be terminated too
+            line[length] = '\0';
+            return line;
+        }
+        if (reader->eof) return NULL;
+
+        // Move incomplete line to front of buffer and grow buffer when line fills it
+        memmove(reader->buffer, line, reader->end - reader->start);
+        reader->end -= reader->start;
+        reader->start = 0;
+        if (reader->end + 1 == reader->size)
+        {
+            reader->size *= 2;
+            reader->buffer = realloc_wrapper(reader->buffer, reader->size);
+        }
+        size_t num_read = fread(reader->buffer + reader->end, 1, reader->size - reader->end - 1, reader->file);
+        reader->end += num_read;
+        if (num_read == 0) reader->eof = true;
+    }
+}
+
+void csv_free_reader(CsvReader *reader)
+{
+    free(reader->buffer);
+}
+
+/*
+Returns: Tab if header contains tabs (TSV), comma otherwise
+*/
+char csv_detect_delimiter(const char *header)
+{
+    return strchr(header, '\t') != NULL ? '\t' : ',';
+}
+
+/*
+Summary: Splits line into fields in place, quotes of quoted fields are removed and "" is replaced by "
+Params
+    out_fields: Receives at most max_fields fields
+Returns: Number of fields of line, can be larger than max_fields
+*/
+size_t csv_split(char *line, char delimiter, size_t max_fields, char **out_fields)
+{
+    size_t num_fields = 0;
+    char *c = line;
+    while (true)
+    {
+        char *field = c;
+        char *end = c;
+        if (*c == '"')
+        {
+            for (c++; *c != '\0'; c++)
+            {
+                if (*c == '"')
+                {
+                    if (c[1] != '"')
+                    {
+                        c++;
+                        break;
+                    }
+                    c++;
+                }
+                *end++ = *c;
+            }
+        }
+        while (*c != '\0' && *c != delimiter)
+        {
+            *end++ = *c++;
+        }
+
+        bool is_last = *c == '\0';
+        *end = '\0';
+        if (num_fields < max_fields) out_fields[num_fields] = field;
+        num_fields++;
+        if (is_last) return num_fields;
+        c++;
+    }
+}
+
+/*
+Summary: Writes field, quoted when it contains delimiter, quotes or line breaks
+*/
+void csv_write_field(FILE *out, const char *field, char delimiter)
+{
+    if (strchr(field, delimiter) == NULL && strpbrk(field, "\"\r\n") == NULL)
+    {
+        fputs(field, out);
+        return;
+    }
+
+    fputc('"', out);
+    for (const char *c = field; *c != '\0'; c++)
+    {
+        if (*c == '"') fputc('"', out);
+        fputc(*c, out);
+    }
+    fputc('"', out);
+}
+
+static bool parse_number(const char *field, double *out)
+{
+    char *end;
+    *out = strtod(field, &end);
+    if (end == field) return false;
+    while (is_space(*end)) end++;
+    return *end == '\0';
+}
+
+/*
+Summary: Prints shortest of 15 and 17 significant digits that reads back as the same double
+*/
+static void write_number(FILE *out, double value)
+{
+    char buffer[NUMBER_SIZE];
+    snprintf(buffer, NUMBER_SIZE, "%.15g", value);
+    if (strtod(buffer, NULL) != value) snprintf(buffer, NUMBER_SIZE, "%.17g", value);
+    fputs(buffer, out);
+}
+
+/*
+Summary: Reads remaining rows of reader and writes each of them with result of program appended as last field
+    Rows are read and evaluated in batches, thus memory does not grow with size of input
+    Empty lines are skipped, rows whose bound fields are no numbers or that can not be evaluated get "Error"
+    Stops before next batch is written when command is cancelled or its time is exhausted
+Params
+    program: Variable slots are bound to fields of row
+    columns: Index of field for each variable slot of program
+Returns: False if output could not be written
+*/
+bool csv_map(CsvReader *reader, FILE *out, char delimiter, const Program *program, const size_t *columns,
+    CsvMapResult *out_result)
+{
+    size_t num_vars = program->num_vars;
+    size_t num_needed_fields = 0;
+    for (size_t i = 0; i < num_vars; i++)
+    {
+        if (columns[i] + 1 > num_needed_fields) num_needed_fields = columns[i] + 1;
+    }
+
+    double *values = malloc_wrapper((num_vars * BATCH_SIZE + 1) * sizeof(double));
+    const double **var_columns = malloc_wrapper((num_vars + 1) * sizeof(double*));
+    double *row_values = malloc_wrapper((num_vars + 1) * sizeof(double));
+    char **fields = malloc_wrapper((num_needed_fields + 1) * sizeof(char*));
+    double results[BATCH_SIZE];
+    ListenerError errors[BATCH_SIZE];
+    bool parsed[BATCH_SIZE];
+    size_t line_starts[BATCH_SIZE];
+    Vector lines = vec_create(sizeof(char), LINES_STARTSIZE);
+    for (size_t i = 0; i < num_vars; i++)
+    {
+        var_columns[i] = values + i * BATCH_SIZE;
+    }
+
+    out_result->num_rows = 0;
+    out_result->num_errors = 0;
+    while (!governor_is_stopped())
+    {
+        // Copy lines of batch to write them back later, fields are then parsed in place
+        size_t num_rows = 0;
+        char *line;
+        vec_clear(&lines);
+        while (num_rows < BATCH_SIZE && (line = csv_read_line(reader)) != NULL)
+        {
+            if (*line == '\0') continue;
+            line_starts[num_rows] = vec_count(&lines);
+            vec_push_many(&lines, strlen(line) + 1, line);
+
+            parsed[num_rows] = csv_split(line, delimiter, num_needed_fields, fields) >= num_needed_fields;
+            for (size_t i = 0; i < num_vars; i++)
+            {
+                double *value = &values[i * BATCH_SIZE + num_rows];
+                if (!parsed[num_rows] || !parse_number(fields[columns[i]], value))
+                {
+                    parsed[num_rows] = false;
+                    *value = 0;
+                }
+            }
+            num_rows++;
+        }
+        if (num_rows == 0) break;
+
+        // Rows that call rand are evaluated in order
+        if (program->has_side_effects)
+        {
+            for (size_t i = 0; i < num_rows; i++)
+            {
+                if (!parsed[i]) continue;
+                for (size_t j = 0; j < num_vars; j++)
+                {
+                    row_values[j] = values[j * BATCH_SIZE + i];
+                }
+                errors[i] = run_program(program, row_values, &results[i]);
+            }
+        }
+        else
+        {
+            run_program_batch(program, num_rows, var_columns, results, errors);
+        }
+
+        if (governor_is_stopped()) break;
+        for (size_t i = 0; i < num_rows; i++)
+        {
+            fputs((char*)vec_get(&lines, line_starts[i]), out);
+            fputc(delimiter, out);
+            if (parsed[i] && errors[i] == LISTENERERR_SUCCESS)
+            {
+                write_number(out, results[i]);
+            }
+            else
+            {
+                fputs("Error", out);
+                out_result->num_errors++;
+            }
+            fputc('\n', out);
+        }
+        out_result->num_rows += num_rows;
+    }
+
+    vec_destroy(&lines);
+    free(values);
+    free(var_columns);
+    free(row_values);
+    free(fields);
+    return ferror(out) == 0;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "bytecode.h"
+
+// Upper limit for number of columns that can be bound to variables
+#define CSV_MAX_COLUMNS 1024
+
+/*
+Reads lines of a file in large blocks, memory is bounded by size of longest line.
+*/
+typedef struct {
+    FILE *file;
+    char *buffer;
+    size_t size;  // Capacity of buffer
+    size_t start; // Start of first line that has not been read
+    size_t end;   // End of data read from file
+    bool eof;
+} CsvReader;
+
+typedef struct {
+    size_t num_rows;
+    size_t num_errors; // Rows that could not be parsed or evaluated
+} CsvMapResult;
+
+CsvReader csv_create_reader(FILE *file);
+char *csv_read_line(CsvReader *reader);
+void csv_free_reader(CsvReader *reader);
+char csv_detect_delimiter(const char *header);
+size_t csv_split(char *line, char delimiter, size_t max_fields, char **out_fields);
+void csv_write_field(FILE *out, const char *field, char delimiter);
+bool csv_map(CsvReader *reader, FILE *out, char delimiter, const Program *program, const size_t *columns,
+    CsvMapResult *out_result);
@@ -0,0 +1,355 @@
+#include <string.h>
+#include <math.h>
+
+#include "../../util/alloc_wrappers.h"
+#include "../../util/vector.h"
+#include "arith_context.h"
+#include "arith_evaluation.h"
+#include "gradient.h"
+
+#define TAPE_STARTSIZE 64
+#define ARGS_STARTSIZE 64
+// Marks entries of inputs and constants, which have no operator
+#define TAPE_LEAF SIZE_MAX
+
+/*
+The tape records every operator of the tree in evaluation order, together with the entries of its arguments.
+Calls of user-defined functions are not recorded themselves, their right hand sides are recorded instead.
+Running the tape evaluates its entries from the first to the last one,
+then the adjoints (partial derivatives of the result) are propagated from the last entry to the first one.
+*/
+typedef struct {
+    size_t id;        // Id of operator, TAPE_LEAF for inputs and constants
+    size_t num_args;
+    size_t first_arg; // Entries of arguments are args[first_arg], ..., args[first_arg + num_args - 1]
+    bool active;      // True if value depends on an input
+} TapeEntry;
+
+// Variables of tree that is recorded and their entries
+typedef struct {
+    size_t num_vars;
+    const char **vars;
+    const size_t *entries;
+} Frame;
+
+static size_t push_entry(Gradient *tape, TapeEntry entry, double value)
+{
+    VEC_PUSH_ELEM(&tape->entries, TapeEntry, entry);
+    VEC_PUSH_ELEM(&tape->values, double, value);
+    return vec_count(&tape->entries) - 1;
+}
+
+static TapeEntry *get_entry(const Gradient *tape, size_t index)
+{
+    return (TapeEntry*)vec_get(&tape->entries, index);
+}
+
+/*
+Summary: Records every operator of tree on tape, variables are looked up only here
+Params
+    out_entry: Entry that holds value of tree
+*/
+static ListenerError record(Gradient *tape, const Node *tree, const Frame *frame, size_t *out_entry)
+{
+    switch (get_type(tree))
+    {
+        case NTYPE_CONSTANT:
+            *out_entry = push_entry(tape, (TapeEntry){ .id = TAPE_LEAF }, get_const_value(tree));
+            return LISTENERERR_SUCCESS;
+
+        case NTYPE_VARIABLE:
+            for (size_t i = 0; i < frame->num_vars; i++)
+            {
+                if (strcmp(get_var_name(tree), frame->vars[i]) == 0)
+                {
+                    *out_entry = frame->entries[i];
+                    return LISTENERERR_SUCCESS;
+                }
+            }
+            return LISTENERERR_VARIABLE_ENCOUNTERED;
+
+        case NTYPE_OPERATOR:
+            break;
+    }
+
+    const Operator *op = get_op(tree);
+    size_t num_args = get_num_children(tree);
+    size_t arg_entries[MAX_CHILDREN];
+    bool active = false;
+    for (size_t i = 0; i < num_args; i++)
+    {
+        ListenerError err = record(tape, get_child(tree, i), frame, &arg_entries[i]);
+        if (err != LISTENERERR_SUCCESS) return err;
+        active |= get_entry(tape, arg_entries[i])->active;
+    }
+
+    // Parameters of user-defined function are bound to entries of arguments
+    RewriteRule *function = get_composite_function(op);
+    if (function != NULL)
+    {
+        const char *params[MAX_CHILDREN];
+        for (size_t i = 0; i < num_args; i++)
+        {
+            params[i] = get_var_name(get_child(function->pattern.pattern, i));
+        }
+        Frame callee = { num_args, params, arg_entries };
+        return record(tape, function->after, &callee, out_entry);
+    }
+
+    TapeEntry entry = {
+        .id = op->id,
+        .num_args = num_args,
+        .first_arg = vec_count(&tape->args),
+        .active = active
+    };
+    for (size_t i = 0; i < num_args; i++) VEC_PUSH_ELEM(&tape->args, size_t, arg_entries[i]);
+    *out_entry = push_entry(tape, entry, 0);
+    return LISTENERERR_SUCCESS;
+}
+
+/*
+Summary: Computes partial derivative of operator with respect to one of its arguments
+Params
+    value: Result of operator for args
+    index: Index of argument
+Returns: False if operator has no derivative rule
+*/
+static bool get_partial(size_t id, size_t num_args, const double *args, double value, size_t index, double *out)
+{
+    double x = args[0];
+    switch (id)
+    {
+        case 0: // $x
+        case 4: // x+y
+        case 11: // +x
+        case 41: // frac(x)
+        case 43: // sum(x, y, ...)
+            *out = 1;
+            return true;
+        case 5: // x-y
+            *out = index == 0 ? 1 : -1;
+            return true;
+        case 6: // x*y
+            *out = args[1 - index];
+            return true;
+        case 7: // x/y
+            *out = index == 0 ? 1 / args[1] : -value / args[1];
+            return true;
+        case 8: // x^y
+            *out = index == 0 ? args[1] * pow(x, args[1] - 1) : value * log(x);
+            return true;
+        case 10: // x mod y
+            *out = index == 0 ? 1 : -trunc(x / args[1]);
+            return true;
+        case 12: // -x
+            *out = -1;
+            return true;
+        case 14: // x%
+            *out = 0.01;
+            return true;
+        case 15: // exp(x)
+            *out = value;
+            return true;
+        case 16: // root(x, n)
+            *out = index == 0 ? value / (args[1] * x) : -value * log(x) / (args[1] * args[1]);
+            return true;
+        case 17: // sqrt(x)
+            *out = 0.5 / value;
+            return true;
+        case 18: // log(x, n)
+            *out = index == 0 ? 1 / (x * log(args[1])) : -value / (args[1] * log(args[1]));
+            return true;
+        case 19: // ln(x)
+            *out = 1 / x;
+            return true;
+        case 20: // ld(x)
+            *out = 1 / (x * log(2));
+            return true;
+        case 21: // lg(x)
+            *out = 1 / (x * log(10));
+            return true;
+        case 22: // sin(x)
+            *out = cos(x);
+            return true;
+        case 23: // cos(x)
+            *out = -sin(x);
+            return true;
+        case 24: // tan(x)
+            *out = 1 / (cos(x) * cos(x));
+            return true;
+        case 25: // asin(x)
+            *out = 1 / sqrt(1 - x * x);
+            return true;
+        case 26: // acos(x)
+            *out = -1 / sqrt(1 - x * x);
+            return true;
+        case 27: // atan(x)
+            *out = 1 / (1 + x * x);
+            return true;
+        case 28: // sinh(x)
+            *out = cosh(x);
+            return true;
+        case 29: // cosh(x)
+            *out = sinh(x);
+            return true;
+        case 30: // tanh(x)
+            *out = 1 / (cosh(x) * cosh(x));
+            return true;
+        case 31: // asinh(x)
+            *out = 1 / sqrt(x * x + 1);
+            return true;
+        case 32: // acosh(x)
+            *out = 1 / sqrt(x * x - 1);
+            return true;
+        case 33: // atanh(x)
+            *out = 1 / (1 - x * x);
+            return true;
+        case 34: // max(x, y, ...)
+        case 35: // min(x, y, ...)
+        {
+            // Only the first argument that is selected contributes
+            size_t selected = 0;
+            while (selected < num_args && args[selected] != value) selected++;
+            *out = selected == index ? 1 : 0;
+            return true;
+        }
+        case 36: // abs(x)
+            *out = (x > 0) - (x < 0);
+            return true;
+        case 37: // ceil(x)
+        case 38: // floor(x)
+        case 39: // round(x)
+        case 40: // trunc(x)
+        case 42: // sgn(x)
+            // Piecewise constant, derivative is zero where it exists
+            *out = 0;
+            return true;
+        case 44: // prod(x, y, ...)
+        {
+            // Product of other factors, dividing value would fail for zero
+            double res = 1;
+            for (size_t i = 0; i < num_args; i++)
+            {
+                if (i != index) res *= args[i];
+            }
+            *out = res;
+            return true;
+        }
+        case 45: // avg(x, y, ...)
+            *out = 1.0 / num_args;
+            return true;
+        default:
+            return false;
+    }
+}
+
+/*
+Summary: Records tape of tree, which can then be run for any values of its variables
+    Calls of user-defined functions are followed, later changes of these functions are not reflected by tape
+Params
+    vars:         Names of variables, i-th name is bound to i-th input
+    out_gradient: Free with free_gradient when LISTENERERR_SUCCESS is returned
+Returns: LISTENERERR_VARIABLE_ENCOUNTERED if tree contains a variable that is not in vars
+*/
+ListenerError compile_gradient(const Node *tree, size_t num_vars, const char **vars, Gradient *out_gradient)
+{
+    out_gradient->entries = vec_create(sizeof(TapeEntry), TAPE_STARTSIZE);
+    out_gradient->args = vec_create(sizeof(size_t), ARGS_STARTSIZE);
+    out_gradient->values = vec_create(sizeof(double), TAPE_STARTSIZE);
+    out_gradient->adjoints = NULL;
+    out_gradient->num_vars = num_vars;
+
+    size_t *input_entries = malloc_wrapper((num_vars + 1) * sizeof(size_t));
+    for (size_t i = 0; i < num_vars; i++)
+    {
+        input_entries[i] = push_entry(out_gradient, (TapeEntry){ .id = TAPE_LEAF, .active = true }, 0);
+    }
+    Frame frame = { num_vars, vars, input_entries };
+    ListenerError err = record(out_gradient, tree, &frame, &out_gradient->result);
+    free(input_entries);
+    if (err != LISTENERERR_SUCCESS)
+    {
+        free_gradient(out_gradient);
+        return err;
+    }
+    out_gradient->adjoints = malloc_wrapper(vec_count(&out_gradient->entries) * sizeof(double));
+    return LISTENERERR_SUCCESS;
+}
+
+/*
+Summary: Computes value and all partial derivatives of recorded tree by reverse mode automatic differentiation,
+    tape is evaluated once and the derivatives are found in a single backward sweep
+    Semantics and errors of operators are those of arith_id_evaluate
+Params
+    var_values:   i-th value is bound to i-th variable of compile_gradient
+    out_gradient: Partial derivative with respect to i-th variable is written to out_gradient[i]
+Returns: LISTENERERR_IMPOSSIBLE_DERIV if result depends on variable through operator without derivative rule,
+    error of evaluation otherwise
+*/
+ListenerError run_gradient(const Gradient *gradient, const double *var_values, double *out_value, double *out_gradient)
+{
+    const TapeEntry *entries = (const TapeEntry*)gradient->entries.buffer;
+    const size_t *args = (const size_t*)gradient->args.buffer;
+    double *values = (double*)gradient->values.buffer;
+    double *adjoints = gradient->adjoints;
+    size_t result = gradient->result;
+
+    memcpy(values, var_values, gradient->num_vars * sizeof(double));
+    double arg_values[MAX_CHILDREN];
+    for (size_t i = gradient->num_vars; i <= result; i++)
+    {
+        const TapeEntry *entry = &entries[i];
+        if (entry->id == TAPE_LEAF) continue;
+        for (size_t j = 0; j < entry->num_args; j++) arg_values[j] = values[args[entry->first_arg + j]];
+        ListenerError err = arith_id_evaluate(entry->id, entry->num_args, arg_values, &values[i]);
+        if (err != LISTENERERR_SUCCESS) return err;
+    }
+    *out_value = values[result];
+
+    // Adjoint of an entry is the partial derivative of the result with respect to its value
+    memset(adjoints, 0, (result + 1) * sizeof(double));
+    adjoints[result] = 1;
+    for (size_t i = result + 1; i-- > gradient->num_vars;)
+    {
+        const TapeEntry *entry = &entries[i];
+        if (entry->id == TAPE_LEAF || !entry->active || adjoints[i] == 0) continue;
+
+        const size_t *arg_entries = args + entry->first_arg;
+        for (size_t j = 0; j < entry->num_args; j++) arg_values[j] = values[arg_entries[j]];
+        for (size_t j = 0; j < entry->num_args; j++)
+        {
+            if (!entries[arg_entries[j]].active) continue;
+            double partial;
+            if (!get_partial(entry->id, entry->num_args, arg_values, values[i], j, &partial))
+            {
+                return LISTENERERR_IMPOSSIBLE_DERIV;
+            }
+            adjoints[arg_entries[j]] += adjoints[i] * partial;
+        }
+    }
+
+    memcpy(out_gradient, adjoints, gradient->num_vars * sizeof(double));
+    return LISTENERERR_SUCCESS;
+}
+
+void free_gradient(Gradient *gradient)
+{
+    vec_destroy(&gradient->entries);
+    vec_destroy(&gradient->args);
+    vec_destroy(&gradient->values);
+    free(gradient->adjoints);
+}
+
+/*
+Summary: Records tape of tree and runs it once, see compile_gradient and run_gradient
+*/
+ListenerError tree_gradient(const Node *tree, size_t num_vars, const char **vars, const double *values,
+    double *out_value, double *out_gradient)
+{
+    Gradient gradient;
+    ListenerError err = compile_gradient(tree, num_vars, vars, &gradient);
+    if (err != LISTENERERR_SUCCESS) return err;
+    err = run_gradient(&gradient, values, out_value, out_gradient);
+    free_gradient(&gradient);
+    return err;
+}
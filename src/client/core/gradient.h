@@ -0,0 +1,23 @@
+#pragma once
+#include "../../engine/tree/node.h"
+#include "../../engine/tree/tree_util.h"
+#include "../../util/vector.h"
+
+/*
+Tape of a tree for reverse mode automatic differentiation, recorded once and run for many points
+Its buffers are reused by every run, thus a tape must not be run by several threads at once
+*/
+typedef struct {
+    Vector entries;    // Operators in evaluation order, inputs come first (payload: TapeEntry, see gradient.c)
+    Vector args;       // Entries of arguments of operators (payload: size_t)
+    Vector values;     // Value of each entry, constants are written when recording (payload: double)
+    double *adjoints;  // Partial derivative of result with respect to value of each entry
+    size_t num_vars;   // Number of inputs, i.e. of variables that need to be bound when running the tape
+    size_t result;     // Entry that holds value of tree
+} Gradient;
+
+ListenerError compile_gradient(const Node *tree, size_t num_vars, const char **vars, Gradient *out_gradient);
+ListenerError run_gradient(const Gradient *gradient, const double *var_values, double *out_value, double *out_gradient);
+void free_gradient(Gradient *gradient);
+ListenerError tree_gradient(const Node *tree, size_t num_vars, const char **vars, const double *values,
+    double *out_value, double *out_gradient);
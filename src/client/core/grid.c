@@ -0,0 +1,309 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include "../../util/alloc_wrappers.h"
+#include "../../util/parallel.h"
+#include "../../util/governor.h"
+#include "grid.h"
+
+// Number of cells that are evaluated by a worker at once
+#define CHUNK_SIZE 4096
+// Number of chunks whose results are buffered before they are consumed, bounds memory of large grids
+#define WAVE_SIZE    64
+// Number of cells that are evaluated column-at-a-time
+#define BLOCK_SIZE  256
+
+// Names of variable slots that hold hoisted values, can not clash with names of variables
+static const char *HOISTED_NAMES[GRID_MAX_HOISTED] = {
+    "#0", "#1", "#2", "#3", "#4", "#5", "#6", "#7",
+    "#8", "#9", "#10", "#11", "#12", "#13", "#14", "#15"
+};
+
+// State of evaluation that is shared by workers and consumer of chunks
+typedef struct {
+    const Grid *grid;
+    size_t first_chunk; // Index of first chunk of current wave
+    double *results;    // Per cell of current wave
+    ListenerError *errors;
+    GridConsumer consume;
+    void *context;
+    bool stopped;       // Set when a chunk has not been consumed because command has been stopped
+} GridJob;
+
+/*
+Returns: Number of values from, from + step, ... up to to (step direction is adjusted to reach to),
+    may exceed size_t
+*/
+double grid_axis_count(double from, double to, double step)
+{
+    if (to < from) return grid_axis_count(to, from, step);
+    // Tolerance to not lose last value to rounding, e.g. when step is 0.1
+    return floor((to - from) / fabs(step) * (1 + 1e-12)) + 1;
+}
+
+double grid_axis_value(const GridAxis *axis, size_t index)
+{
+    return axis->from + (double)index * axis->step;
+}
+
+/*
+Summary: Computes values of first count axes for index of a line, i.e. all values but the one of the last axis
+*/
+static void get_line_values(const Grid *grid, size_t line, double *out_values)
+{
+    for (size_t i = grid->num_axes - 1; i > 0; i--)
+    {
+        const GridAxis *axis = &grid->axes[i - 1];
+        out_values[i - 1] = grid_axis_value(axis, line % axis->count);
+        line /= axis->count;
+    }
+}
+
+/*
+Summary: Computes values of all axes at cell, in order of axes
+*/
+void grid_cell_values(const Grid *grid, size_t cell, double *out_values)
+{
+    const GridAxis *last = &grid->axes[grid->num_axes - 1];
+    get_line_values(grid, cell / last->count, out_values);
+    out_values[grid->num_axes - 1] = grid_axis_value(last, cell % last->count);
+}
+
+/*
+Summary: Replaces maximal subtrees that depend on other axes but not on the last one by variable slots
+    Derivatives are only hoisted as a whole, since their operands are not independent of the variable of derivation
+*/
+static void hoist(Node **tree, const char *last_var, size_t num_outer, const char **outer_vars, Grid *grid)
+{
+    if (get_type(*tree) != NTYPE_OPERATOR || grid->num_hoisted == GRID_MAX_HOISTED) return;
+
+    if (get_variable_nodes((const Node**)tree, last_var, 0, NULL) == 0)
+    {
+        if (count_all_variable_nodes(*tree) > 0
+            && compile_program(*tree, num_outer, outer_vars, &grid->hoisted_programs[grid->num_hoisted]))
+        {
+            Node *slot = malloc_variable_node(HOISTED_NAMES[grid->num_hoisted], 0, 0);
+            tree_replace(tree, slot);
+            grid->num_hoisted++;
+        }
+        return;
+    }
+
+    size_t id = get_op(*tree)->id;
+    if (id == 2 || id == 3) return;
+    for (size_t i = 0; i < get_num_children(*tree); i++)
+    {
+        hoist(get_child_addr(*tree, i), last_var, num_outer, outer_vars, grid);
+    }
+}
+
+/*
+Summary: Compiles expression for evaluation on grid, hoists subtrees that are invariant along the last axis
+Params
+    tree: Must not contain variables other than those of axes
+    axes: At least one and at most GRID_MAX_AXES, must outlive grid
+Returns: False if expression could not be compiled, grid does not need to be freed then
+*/
+bool grid_compile(const Node *tree, size_t num_axes, const GridAxis *axes, Grid *out_grid)
+{
+    out_grid->num_axes = num_axes;
+    out_grid->axes = axes;
+    out_grid->num_cells = 1;
+    out_grid->num_hoisted = 0;
+    for (size_t i = 0; i < num_axes; i++)
+    {
+        out_grid->num_cells *= axes[i].count;
+    }
+
+    // Inner program reads last axis first, then other axes and finally hoisted values
+    const char *vars[GRID_MAX_AXES + GRID_MAX_HOISTED];
+    vars[0] = axes[num_axes - 1].var;
+    for (size_t i = 0; i + 1 < num_axes; i++)
+    {
+        vars[i + 1] = axes[i].var;
+    }
+
+    if (!compile_program(tree, num_axes, vars, &out_grid->inner_program)) return false;
+    // Calls of rand must be evaluated once per cell and in order
+    if (num_axes == 1 || out_grid->inner_program.has_side_effects) return true;
+
+    Node *copy = tree_copy(tree);
+    hoist(&copy, vars[0], num_axes - 1, vars + 1, out_grid);
+    if (out_grid->num_hoisted > 0)
+    {
+        for (size_t i = 0; i < out_grid->num_hoisted; i++)
+        {
+            vars[num_axes + i] = HOISTED_NAMES[i];
+        }
+        Program hoisted_program;
+        if (compile_program(copy, num_axes + out_grid->num_hoisted, vars, &hoisted_program))
+        {
+            free_program(&out_grid->inner_program);
+            out_grid->inner_program = hoisted_program;
+        }
+        else
+        {
+            // Keep evaluating whole expression per cell
+            for (size_t i = 0; i < out_grid->num_hoisted; i++)
+            {
+                free_program(&out_grid->hoisted_programs[i]);
+            }
+            out_grid->num_hoisted = 0;
+        }
+    }
+    free_tree(copy);
+    return true;
+}
+
+/*
+Summary: Evaluates cells of segment of a line, hoisted values are evaluated once for whole segment
+*/
+static void evaluate_segment(const Grid *grid, size_t line, size_t from, size_t to,
+    double *columns, double *out_results, ListenerError *out_errors)
+{
+    size_t num_vars = grid->num_axes + grid->num_hoisted;
+    double consts[GRID_MAX_AXES + GRID_MAX_HOISTED];
+    get_line_values(grid, line, consts + 1);
+    for (size_t i = 0; i < grid->num_hoisted; i++)
+    {
+        ListenerError error = run_program(&grid->hoisted_programs[i], consts + 1, consts + grid->num_axes + i);
+        if (error != LISTENERERR_SUCCESS)
+        {
+            for (size_t j = from; j < to; j++)
+            {
+                out_errors[j - from] = error;
+            }
+            return;
+        }
+    }
+
+    const GridAxis *last = &grid->axes[grid->num_axes - 1];
+    const double *var_columns[GRID_MAX_AXES + GRID_MAX_HOISTED];
+    for (size_t i = 0; i < num_vars; i++)
+    {
+        var_columns[i] = columns + i * BLOCK_SIZE;
+    }
+
+    for (size_t i = from; i < to; i += BLOCK_SIZE)
+    {
+        size_t num_rows = to - i < BLOCK_SIZE ? to - i : BLOCK_SIZE;
+        for (size_t j = 0; j < num_rows; j++)
+        {
+            columns[j] = grid_axis_value(last, i + j);
+        }
+        for (size_t k = 1; k < num_vars; k++)
+        {
+            for (size_t j = 0; j < num_rows; j++)
+            {
+                columns[k * BLOCK_SIZE + j] = consts[k];
+            }
+        }
+        run_program_batch(&grid->inner_program, num_rows, var_columns, out_results + i - from, out_errors + i - from);
+    }
+}
+
+static void get_chunk_range(const Grid *grid, size_t chunk_index, size_t *out_start, size_t *out_end)
+{
+    *out_start = chunk_index * CHUNK_SIZE;
+    *out_end = *out_start + CHUNK_SIZE < grid->num_cells ? *out_start + CHUNK_SIZE : grid->num_cells;
+}
+
+/*
+Summary: Evaluates cells of chunk line by line, runs on worker thread
+*/
+static void grid_work(size_t chunk_index, void *context)
+{
+    GridJob *job = (GridJob*)context;
+    const Grid *grid = job->grid;
+    size_t start, end;
+    get_chunk_range(grid, job->first_chunk + chunk_index, &start, &end);
+    size_t offset = chunk_index * CHUNK_SIZE;
+
+    if (grid->inner_program.has_side_effects)
+    {
+        double values[GRID_MAX_AXES];
+        for (size_t i = start; i < end; i++)
+        {
+            grid_cell_values(grid, i, values);
+            // Last axis is first variable of inner program
+            double last = values[grid->num_axes - 1];
+            for (size_t j = grid->num_axes - 1; j > 0; j--)
+            {
+                values[j] = values[j - 1];
+            }
+            values[0] = last;
+            job->errors[offset + i - start] = run_program(&grid->inner_program, values, job->results + offset + i - start);
+        }
+        return;
+    }
+
+    size_t line_length = grid->axes[grid->num_axes - 1].count;
+    double *columns = malloc_wrapper((grid->num_axes + grid->num_hoisted) * BLOCK_SIZE * sizeof(double));
+    for (size_t i = start; i < end;)
+    {
+        size_t line = i / line_length;
+        size_t segment_end = (line + 1) * line_length < end ? (line + 1) * line_length : end;
+        evaluate_segment(grid, line, i - line * line_length, segment_end - line * line_length,
+            columns, job->results + offset + i - start, job->errors + offset + i - start);
+        i = segment_end;
+    }
+    free(columns);
+}
+
+/*
+Summary: Passes results of chunk to consumer, runs on calling thread in order of chunks
+*/
+static void grid_consume(size_t chunk_index, void *context)
+{
+    GridJob *job = (GridJob*)context;
+    if (job->stopped || governor_is_stopped())
+    {
+        job->stopped = true;
+        return;
+    }
+    size_t start, end;
+    get_chunk_range(job->grid, job->first_chunk + chunk_index, &start, &end);
+    size_t offset = chunk_index * CHUNK_SIZE;
+    job->consume(start, end - start, job->results + offset, job->errors + offset, job->context);
+}
+
+/*
+Summary: Evaluates all cells on all workers and passes results to consumer in order of cells
+    Only a bounded number of results is buffered at a time, thus memory does not grow with size of grid
+    Cells are evaluated on a single thread when program calls rand
+Returns: False if command has been cancelled or its time is exhausted, not all cells have been passed to consumer then
+*/
+bool grid_evaluate(const Grid *grid, GridConsumer consume, void *context)
+{
+    size_t num_chunks = (grid->num_cells + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    size_t wave_size = num_chunks < WAVE_SIZE ? num_chunks : WAVE_SIZE;
+    GridJob job = {
+        .grid = grid,
+        .first_chunk = 0,
+        .results = malloc_wrapper((wave_size * CHUNK_SIZE + 1) * sizeof(double)),
+        .errors = malloc_wrapper((wave_size * CHUNK_SIZE + 1) * sizeof(ListenerError)),
+        .consume = consume,
+        .context = context,
+        .stopped = false
+    };
+
+    size_t num_threads = grid->inner_program.has_side_effects ? 1 : get_num_workers();
+    for (; job.first_chunk < num_chunks && !job.stopped; job.first_chunk += WAVE_SIZE)
+    {
+        size_t num_wave_chunks = num_chunks - job.first_chunk < WAVE_SIZE ? num_chunks - job.first_chunk : WAVE_SIZE;
+        run_chunks_ordered(num_wave_chunks, num_threads, grid_work, grid_consume, &job);
+    }
+
+    free(job.results);
+    free(job.errors);
+    return !job.stopped;
+}
+
+void grid_free(Grid *grid)
+{
+    free_program(&grid->inner_program);
+    for (size_t i = 0; i < grid->num_hoisted; i++)
+    {
+        free_program(&grid->hoisted_programs[i]);
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include "bytecode.h"
+
+#define GRID_MAX_AXES     8
+// Upper limit for number of subtrees that are hoisted out of the innermost loop
+#define GRID_MAX_HOISTED 16
+
+typedef struct {
+    const char *var;
+    double from;
+    double step;
+    size_t count; // Number of values, i-th value is from + i * step
+} GridAxis;
+
+/*
+An expression evaluated for every combination of values of its axes, the last axis varies fastest.
+Cells of a line (all values of the last axis) are evaluated column-at-a-time,
+subtrees that do not depend on the last axis are hoisted and only evaluated once per line.
+*/
+typedef struct {
+    size_t num_axes;
+    const GridAxis *axes;
+    size_t num_cells;
+    Program inner_program;    // Variables: last axis, other axes, hoisted values
+    size_t num_hoisted;
+    Program hoisted_programs[GRID_MAX_HOISTED]; // Variables: all axes but last
+} Grid;
+
+/*
+Summary: Receives results of consecutive cells in order on calling thread
+Params
+    first_cell: Index of first cell, in order of iteration
+*/
+typedef void (*GridConsumer)(size_t first_cell, size_t num_cells, const double *results,
+    const ListenerError *errors, void *context);
+
+double grid_axis_count(double from, double to, double step);
+double grid_axis_value(const GridAxis *axis, size_t index);
+void grid_cell_values(const Grid *grid, size_t cell, double *out_values);
+bool grid_compile(const Node *tree, size_t num_axes, const GridAxis *axes, Grid *out_grid);
+bool grid_evaluate(const Grid *grid, GridConsumer consume, void *context);
+void grid_free(Grid *grid);
@@ -0,0 +1,17 @@
+#pragma once
+#include <stdbool.h>
+
+// F(n) is tabulated for n < FIB_TABLE_SIZE, F(93) is the largest Fibonacci number that fits in 64 bits
+#define FIB_TABLE_SIZE 94
+// n! is tabulated (correctly rounded) for n < FACTORIAL_TABLE_SIZE, 171! is not finite anymore
+#define FACTORIAL_TABLE_SIZE 171
+
+/*
+Integer functions of built-in operators, arguments are truncated towards zero.
+Results are exact whenever they are representable as double.
+*/
+double int_fib(double n);
+double int_gcd(double a, double b);
+double int_lcm(double a, double b);
+double int_factorial(double n);
+double int_binomial(double n, double k);
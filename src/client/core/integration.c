@@ -0,0 +1,263 @@
+#include <math.h>
+#include <float.h>
+#include <stdlib.h>
+
+#include "../../util/alloc_wrappers.h"
+#include "../../util/parallel.h"
+#include "../../util/vector.h"
+#include "integration.h"
+
+// Number of points of Gauss-Kronrod rule
+#define NUM_POINTS         15
+// Number of subintervals that are evaluated by a worker at once
+#define CHUNK_SIZE         64
+#define INTERVALS_STARTSIZE 16
+// Intervals whose errors are smaller than this fraction of the largest error are not bisected in the same round
+#define SPLIT_FRACTION     0.01
+
+// Abscissae of 15-point Kronrod rule on [-1, 1], odd ones are those of 7-point Gauss rule (from QUADPACK)
+static const double xgk[8] = {
+    0.991455371120812639206854697526329,
+    0.949107912342758524526189684047851,
+    0.864864423359769072789712788640926,
+    0.741531185599394439863864773280788,
+    0.586087235467691130294144845693013,
+    0.405845151377397166906606412076961,
+    0.207784955007898467600689403773245,
+    0.000000000000000000000000000000000
+};
+static const double wgk[8] = {
+    0.022935322010529224963732008058970,
+    0.063092092629978553290700663189204,
+    0.104790010322250183839876322541518,
+    0.140653259715525918745189590510238,
+    0.169004726639267902826583426598550,
+    0.190350578064785409913256402421014,
+    0.204432940075298892414161999234649,
+    0.209482141084727828012999174891714
+};
+static const double wg[4] = {
+    0.129484966168869693270611432679082,
+    0.279705391489276667901467771423780,
+    0.381830050505118944950369775488975,
+    0.417959183673469387755102040816327
+};
+
+typedef struct {
+    double a;
+    double b;
+    double integral;
+    double error;
+    bool at_rounding_limit; // Error is dominated by rounding errors, bisection would not decrease it
+} Interval;
+
+// State of a round that is shared by workers
+typedef struct {
+    const Program *program;
+    size_t num_intervals;
+    Interval *intervals;   // Bounds are set, integral and error are computed by workers
+    ListenerError *errors; // Per interval: error of first point that could not be evaluated
+    double *error_points;  // Per interval: that point
+} RoundJob;
+
+/*
+Summary: Computes integral and error estimate of interval from values of integrand like QUADPACK's qk15
+Params
+    values: Value at center, then values at center - h * xgk[j] and center + h * xgk[j] for j = 0, ..., 6
+*/
+static void apply_rule(Interval *interval, const double *values)
+{
+    double half_len = 0.5 * (interval->b - interval->a);
+    double center = values[0];
+    double res_kronrod = center * wgk[7];
+    double res_gauss = center * wg[3];
+    double res_abs = fabs(res_kronrod);
+    for (size_t j = 0; j < 7; j++)
+    {
+        double sum = values[1 + 2 * j] + values[2 + 2 * j];
+        res_kronrod += wgk[j] * sum;
+        res_abs += wgk[j] * (fabs(values[1 + 2 * j]) + fabs(values[2 + 2 * j]));
+        if (j % 2 == 1) res_gauss += wg[j / 2] * sum;
+    }
+
+    // Deviation of integrand from its mean, used to scale error estimate
+    double mean = 0.5 * res_kronrod;
+    double res_asc = wgk[7] * fabs(center - mean);
+    for (size_t j = 0; j < 7; j++)
+    {
+        res_asc += wgk[j] * (fabs(values[1 + 2 * j] - mean) + fabs(values[2 + 2 * j] - mean));
+    }
+
+    res_abs *= fabs(half_len);
+    res_asc *= fabs(half_len);
+    double error = fabs((res_kronrod - res_gauss) * half_len);
+    if (res_asc != 0 && error != 0)
+    {
+        double scale = pow(200 * error / res_asc, 1.5);
+        error = res_asc * (scale < 1 ? scale : 1);
+    }
+    // Error can not be smaller than rounding errors of sum
+    interval->at_rounding_limit = res_abs > DBL_MIN / (50 * DBL_EPSILON) && error <= 50 * DBL_EPSILON * res_abs;
+    if (interval->at_rounding_limit) error = 50 * DBL_EPSILON * res_abs;
+
+    interval->integral = res_kronrod * half_len;
+    interval->error = error;
+}
+
+/*
+Summary: Evaluates integrand at all points of intervals of chunk and applies rule to them, runs on worker thread
+*/
+static void round_work(size_t chunk_index, void *context)
+{
+    RoundJob *job = (RoundJob*)context;
+    size_t start = chunk_index * CHUNK_SIZE;
+    size_t end = start + CHUNK_SIZE < job->num_intervals ? start + CHUNK_SIZE : job->num_intervals;
+    size_t num_rows = (end - start) * NUM_POINTS;
+
+    double points[CHUNK_SIZE * NUM_POINTS];
+    double values[CHUNK_SIZE * NUM_POINTS];
+    ListenerError errors[CHUNK_SIZE * NUM_POINTS];
+    for (size_t i = start; i < end; i++)
+    {
+        double *interval_points = points + (i - start) * NUM_POINTS;
+        double half_len = 0.5 * (job->intervals[i].b - job->intervals[i].a);
+        double center = job->intervals[i].a + half_len;
+        interval_points[0] = center;
+        for (size_t j = 0; j < 7; j++)
+        {
+            interval_points[1 + 2 * j] = center - half_len * xgk[j];
+            interval_points[2 + 2 * j] = center + half_len * xgk[j];
+        }
+    }
+
+    if (job->program->has_side_effects)
+    {
+        for (size_t i = 0; i < num_rows; i++)
+        {
+            errors[i] = run_program(job->program, points + i, values + i);
+        }
+    }
+    else
+    {
+        const double *columns[] = { points };
+        run_program_batch(job->program, num_rows, columns, values, errors);
+    }
+
+    for (size_t i = start; i < end; i++)
+    {
+        job->errors[i] = LISTENERERR_SUCCESS;
+        for (size_t j = 0; j < NUM_POINTS; j++)
+        {
+            size_t row = (i - start) * NUM_POINTS + j;
+            if (errors[row] != LISTENERERR_SUCCESS)
+            {
+                job->errors[i] = errors[row];
+                job->error_points[i] = points[row];
+                break;
+            }
+        }
+        if (job->errors[i] == LISTENERERR_SUCCESS) apply_rule(&job->intervals[i], values + (i - start) * NUM_POINTS);
+    }
+}
+
+// Sorts intervals by descending error
+static int compare_errors(const void *a, const void *b)
+{
+    double error_a = ((const Interval*)a)->error;
+    double error_b = ((const Interval*)b)->error;
+    return (error_a < error_b) - (error_a > error_b);
+}
+
+/*
+Summary: Computes integral of program over [a, b] with respect to its only variable
+    Integrand is evaluated like rows of a table, i.e. column-at-a-time unless program has side effects
+    Result does not depend on number of workers
+Params
+    program: Program with one variable slot
+    a, b:    Finite bounds, b can be smaller than a
+    tol:     Positive tolerance, absolute for integrals smaller than 1 and relative otherwise
+*/
+IntegrationResult integrate_program(const Program *program, double a, double b, double tol)
+{
+    IntegrationResult result = { .eval_error = LISTENERERR_SUCCESS, .converged = true };
+    if (a == b) return result;
+
+    Vector intervals = vec_create(sizeof(Interval), INTERVALS_STARTSIZE);
+    Vector pending = vec_create(sizeof(Interval), INTERVALS_STARTSIZE);
+    VEC_PUSH_ELEM(&pending, Interval, ((Interval){ .a = a, .b = b }));
+
+    while (true)
+    {
+        size_t num_pending = vec_count(&pending);
+        RoundJob job = {
+            .program = program,
+            .num_intervals = num_pending,
+            .intervals = (Interval*)pending.buffer,
+            .errors = malloc_wrapper(num_pending * sizeof(ListenerError)),
+            .error_points = malloc_wrapper(num_pending * sizeof(double))
+        };
+        run_chunks_ordered((num_pending + CHUNK_SIZE - 1) / CHUNK_SIZE,
+            program->has_side_effects ? 1 : get_num_workers(), round_work, NULL, &job);
+        result.num_evaluations += num_pending * NUM_POINTS;
+
+        for (size_t i = 0; i < num_pending; i++)
+        {
+            if (job.errors[i] != LISTENERERR_SUCCESS)
+            {
+                result.eval_error = job.errors[i];
+                result.error_point = job.error_points[i];
+                break;
+            }
+            VEC_PUSH_ELEM(&intervals, Interval, job.intervals[i]);
+        }
+        free(job.errors);
+        free(job.error_points);
+        if (result.eval_error != LISTENERERR_SUCCESS) break;
+
+        result.integral = 0;
+        result.error = 0;
+        for (size_t i = 0; i < vec_count(&intervals); i++)
+        {
+            result.integral += ((Interval*)vec_get(&intervals, i))->integral;
+            result.error += ((Interval*)vec_get(&intervals, i))->error;
+        }
+        double abs_tol = fabs(result.integral) > 1 ? tol * fabs(result.integral) : tol;
+        if (result.error <= abs_tol) break;
+
+        // Bisect intervals with largest errors until errors of remaining intervals are within tolerance
+        // Much smaller errors are left for later rounds, so that refinement stays local when tolerance is not reachable
+        qsort(intervals.buffer, vec_count(&intervals), sizeof(Interval), compare_errors);
+        double min_split_error = ((Interval*)vec_get(&intervals, 0))->error * SPLIT_FRACTION;
+        Vector kept = vec_create(sizeof(Interval), vec_count(&intervals) + 1);
+        vec_clear(&pending);
+        double excess = result.error - abs_tol;
+        for (size_t i = 0; i < vec_count(&intervals); i++)
+        {
+            Interval interval = *(Interval*)vec_get(&intervals, i);
+            double mid = 0.5 * (interval.a + interval.b);
+            if (excess > 0 && interval.error >= min_split_error && !interval.at_rounding_limit
+                && mid != interval.a && mid != interval.b)
+            {
+                VEC_PUSH_ELEM(&pending, Interval, ((Interval){ .a = interval.a, .b = mid }));
+                VEC_PUSH_ELEM(&pending, Interval, ((Interval){ .a = mid, .b = interval.b }));
+                excess -= interval.error;
+            }
+            else
+            {
+                VEC_PUSH_ELEM(&kept, Interval, interval);
+            }
+        }
+        vec_destroy(&intervals);
+        intervals = kept;
+
+        if (vec_count(&pending) == 0 || vec_count(&intervals) + vec_count(&pending) > INTEGRATION_MAX_INTERVALS)
+        {
+            result.converged = false;
+            break;
+        }
+    }
+
+    vec_destroy(&intervals);
+    vec_destroy(&pending);
+    return result;
+}
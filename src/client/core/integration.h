@@ -0,0 +1,24 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include "bytecode.h"
+
+// Upper limit for number of subintervals, integration stops with best estimate when it is reached
+#define INTEGRATION_MAX_INTERVALS 50000
+
+/*
+Definite integral computed by adaptive 15-point Gauss-Kronrod quadrature.
+Every round bisects the subintervals with largest errors until the errors of the others sum up to tolerance,
+thus smooth integrands are refined everywhere at once and singularities only locally.
+The new subintervals are evaluated on all workers.
+*/
+typedef struct {
+    double integral;
+    double error;          // Estimated absolute error
+    size_t num_evaluations;
+    bool converged;        // False if error could not be brought below tolerance
+    ListenerError eval_error; // Error of first point that could not be evaluated
+    double error_point;       // That point, only set when eval_error is not LISTENERERR_SUCCESS
+} IntegrationResult;
+
+IntegrationResult integrate_program(const Program *program, double a, double b, double tol);
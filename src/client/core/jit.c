@@ -0,0 +1,399 @@
+#define _GNU_SOURCE
+#include <string.h>
+#include <math.h>
+
+#include "../../engine/tree/tree_util.h"
+#include "arith_evaluation.h"
+#include "jit.h"
+
+/*
+Translates programs to x86-64 machine code (System V ABI, SSE2 only).
+Operands are read where they live: variables from the caller's array (rbp), constants from a pool
+behind the code (rip-relative) and temporary results from the register file (rbx).
+Thus, running native code neither copies variables nor constants.
+Instructions compute inline or call libm, operators without own instruction call arith_id_evaluate.
+On other architectures (or when compiled with NO_JIT), programs are always interpreted.
+*/
+
+#if defined(__x86_64__) && !defined(NO_JIT)
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define CODE_STARTSIZE   256
+#define FIXUPS_STARTSIZE 16
+// Stack frame holds arguments of calls and pointer to result, keeps stack aligned to 16 bytes
+#define FRAME_ARGS       0
+#define FRAME_OUT        (MAX_CHILDREN * sizeof(double))
+#define FRAME_SIZE       (FRAME_OUT + sizeof(double*) + (MAX_CHILDREN % 2 == 0 ? 0 : 8))
+// Emits the given bytes, their number is counted by the compiler
+#define EMIT(as, ...) emit_bytes(as, sizeof((unsigned char[]){ __VA_ARGS__ }), (unsigned char[]){ __VA_ARGS__ })
+// Function pointers can not be converted to object pointers in ISO C, thus take detour via integer
+#define ADDRESS(ptr) ((unsigned long long)(size_t)(ptr))
+
+static bool jit_enabled = true;
+
+typedef struct {
+    size_t offset; // Offset of rel32 in code
+    size_t target; // Index of constant, unused for jumps to error exit
+} Fixup;
+
+typedef struct {
+    const Program *program;
+    Vector code;            // Payload: unsigned char
+    Vector exit_fixups;     // Jumps to error exit (payload: Fixup)
+    Vector constant_fixups; // Rip-relative loads of constants (payload: Fixup)
+} Assembler;
+
+static void emit_bytes(Assembler *as, size_t count, const unsigned char *bytes)
+{
+    vec_push_many(&as->code, count, (void*)bytes);
+}
+
+static void emit_u32(Assembler *as, unsigned int value)
+{
+    unsigned char bytes[4];
+    for (size_t i = 0; i < 4; i++) bytes[i] = (value >> (8 * i)) & 0xFF;
+    emit_bytes(as, 4, bytes);
+}
+
+static void emit_u64(Assembler *as, unsigned long long value)
+{
+    unsigned char bytes[8];
+    for (size_t i = 0; i < 8; i++) bytes[i] = (value >> (8 * i)) & 0xFF;
+    emit_bytes(as, 8, bytes);
+}
+
+static void patch_u32(Assembler *as, size_t offset, unsigned int value)
+{
+    unsigned char *code = (unsigned char*)as->code.buffer;
+    for (size_t i = 0; i < 4; i++) code[offset + i] = (value >> (8 * i)) & 0xFF;
+}
+
+/*
+Summary: Emits ModRM byte (and displacement) that addresses register of program
+Params
+    reg_field: Register encoded in reg-field of ModRM (xmm or general purpose)
+    reg:       Register of program
+*/
+static void emit_operand(Assembler *as, unsigned char reg_field, unsigned int reg)
+{
+    size_t num_vars = as->program->num_vars;
+    size_t num_constants = vec_count(&as->program->constants);
+    if (reg < num_vars)
+    {
+        EMIT(as, 0x85 | (reg_field << 3)); // [rbp + disp32]
+        emit_u32(as, reg * sizeof(double));
+    }
+    else if (reg < num_vars + num_constants)
+    {
+        EMIT(as, 0x05 | (reg_field << 3)); // [rip + disp32]
+        VEC_PUSH_ELEM(&as->constant_fixups, Fixup, ((Fixup){ vec_count(&as->code), reg - num_vars }));
+        emit_u32(as, 0);
+    }
+    else
+    {
+        EMIT(as, 0x83 | (reg_field << 3)); // [rbx + disp32]
+        emit_u32(as, reg * sizeof(double));
+    }
+}
+
+/*
+Summary: Emits SSE2 instruction with xmm register and register of program as operands
+Params
+    prefix: 0x66 or 0xF2
+    opcode: Second opcode byte after 0x0F
+*/
+static void emit_sse(Assembler *as, unsigned char prefix, unsigned char opcode, unsigned char xmm, unsigned int reg)
+{
+    EMIT(as, prefix, 0x0F, opcode);
+    emit_operand(as, xmm, reg);
+}
+
+static void emit_load(Assembler *as, unsigned char xmm, unsigned int reg)
+{
+    emit_sse(as, 0xF2, 0x10, xmm, reg); // movsd xmm, reg
+}
+
+static void emit_store(Assembler *as, unsigned char xmm, unsigned int reg)
+{
+    emit_sse(as, 0xF2, 0x11, xmm, reg); // movsd reg, xmm (reg is always temporary)
+}
+
+static void emit_call(Assembler *as, unsigned long long function)
+{
+    EMIT(as, 0x48, 0xB8); // mov rax, imm64
+    emit_u64(as, function);
+    EMIT(as, 0xFF, 0xD0); // call rax
+}
+
+static void emit_jump_to_exit(Assembler *as)
+{
+    VEC_PUSH_ELEM(&as->exit_fixups, Fixup, ((Fixup){ vec_count(&as->code), 0 }));
+    emit_u32(as, 0);
+}
+
+// Emits jump to error exit with error code unless condition of jcc_skip holds
+static void emit_fail_if(Assembler *as, unsigned char jcc_skip, ListenerError error)
+{
+    EMIT(as, jcc_skip, 10);
+    EMIT(as, 0xB8); // mov eax, imm32
+    emit_u32(as, (unsigned int)error);
+    EMIT(as, 0xE9); // jmp rel32
+    emit_jump_to_exit(as);
+}
+
+// Wrappers of libm, their addresses are taken independently of how libm is linked
+static double native_sin(double x) { return sin(x); }
+static double native_cos(double x) { return cos(x); }
+static double native_exp(double x) { return exp(x); }
+static double native_log(double x) { return log(x); }
+static double native_pow(double x, double y) { return pow(x, y); }
+
+static void emit_unary_call(Assembler *as, const Instruction *instr, double (*function)(double))
+{
+    emit_load(as, 0, instr->a);
+    emit_call(as, ADDRESS(function));
+    emit_store(as, 0, instr->dest);
+}
+
+static void emit_instruction(Assembler *as, const Instruction *instr)
+{
+    switch ((Opcode)instr->opcode)
+    {
+        case OPCODE_ADD:
+        case OPCODE_SUB:
+        case OPCODE_MUL:
+            emit_load(as, 0, instr->a);
+            emit_sse(as, 0xF2,
+                instr->opcode == OPCODE_ADD ? 0x58 : (instr->opcode == OPCODE_SUB ? 0x5C : 0x59),
+                0, instr->b);
+            emit_store(as, 0, instr->dest);
+            break;
+        case OPCODE_DIV:
+            emit_load(as, 1, instr->b);
+            EMIT(as, 0x66, 0x0F, 0x57, 0xD2);                     // xorpd xmm2, xmm2
+            EMIT(as, 0x66, 0x0F, 0x2E, 0xCA);                     // ucomisd xmm1, xmm2
+            EMIT(as, 0x7A, 12);                                   // jp: NaN is not zero
+            emit_fail_if(as, 0x75, LISTENERERR_DIVISION_BY_ZERO); // jne: b is not zero
+            emit_load(as, 0, instr->a);
+            EMIT(as, 0xF2, 0x0F, 0x5E, 0xC1); // divsd xmm0, xmm1
+            emit_store(as, 0, instr->dest);
+            break;
+        case OPCODE_POW:
+            // Fail if a == 0 and b <= 0
+            emit_load(as, 0, instr->a);
+            emit_load(as, 1, instr->b);
+            EMIT(as, 0x66, 0x0F, 0x57, 0xD2);                     // xorpd xmm2, xmm2
+            EMIT(as, 0x66, 0x0F, 0x2E, 0xC2);                     // ucomisd xmm0, xmm2
+            EMIT(as, 0x7A, 20);                                   // jp: a is NaN
+            EMIT(as, 0x75, 18);                                   // jne: a is not zero
+            EMIT(as, 0x66, 0x0F, 0x2E, 0xCA);                     // ucomisd xmm1, xmm2
+            EMIT(as, 0x7A, 12);                                   // jp: b is NaN
+            emit_fail_if(as, 0x77, LISTENERERR_DIVISION_BY_ZERO); // ja: b > 0
+            emit_call(as, ADDRESS(native_pow));
+            emit_store(as, 0, instr->dest);
+            break;
+        case OPCODE_POW_CONST:
+            emit_load(as, 0, instr->a);
+            emit_load(as, 1, instr->b);
+            emit_call(as, ADDRESS(native_pow));
+            emit_store(as, 0, instr->dest);
+            break;
+        case OPCODE_NEG:
+            // Flip sign bit, 0 - a would differ for zeros
+            EMIT(as, 0x48, 0x8B); // mov rax, a
+            emit_operand(as, 0, instr->a);
+            EMIT(as, 0x48, 0x0F, 0xBA, 0xF8, 63); // btc rax, 63
+            EMIT(as, 0x48, 0x89);                 // mov dest, rax
+            emit_operand(as, 0, instr->dest);
+            break;
+        case OPCODE_SQRT:
+            emit_sse(as, 0xF2, 0x51, 0, instr->a); // sqrtsd xmm0, a
+            emit_store(as, 0, instr->dest);
+            break;
+        case OPCODE_EXP:
+            emit_unary_call(as, instr, native_exp);
+            break;
+        case OPCODE_LN:
+            emit_unary_call(as, instr, native_log);
+            break;
+        case OPCODE_SIN:
+            emit_unary_call(as, instr, native_sin);
+            break;
+        case OPCODE_COS:
+            emit_unary_call(as, instr, native_cos);
+            break;
+        case OPCODE_MUL_ADD:
+        case OPCODE_ADD_MUL:
+        case OPCODE_MUL_SUB:
+        case OPCODE_SUB_MUL:
+            emit_load(as, 0, instr->a);
+            emit_sse(as, 0xF2, 0x59, 0, instr->b); // mulsd xmm0, b
+            if (instr->opcode == OPCODE_SUB_MUL)
+            {
+                emit_load(as, 1, instr->c);
+                EMIT(as, 0xF2, 0x0F, 0x5C, 0xC8); // subsd xmm1, xmm0
+                emit_store(as, 1, instr->dest);
+            }
+            else
+            {
+                // Addition is commutative in IEEE 754, thus a * b + c equals c + a * b
+                emit_sse(as, 0xF2, instr->opcode == OPCODE_MUL_SUB ? 0x5C : 0x58, 0, instr->c);
+                emit_store(as, 0, instr->dest);
+            }
+            break;
+        case OPCODE_CALL:
+        {
+            const unsigned int *call_args = (const unsigned int*)as->program->call_args.buffer;
+            for (size_t j = 0; j < instr->num_args; j++)
+            {
+                emit_load(as, 0, call_args[instr->a + j]);
+                EMIT(as, 0xF2, 0x0F, 0x11, 0x84, 0x24); // movsd [rsp + disp32], xmm0
+                emit_u32(as, FRAME_ARGS + j * sizeof(double));
+            }
+            EMIT(as, 0xBF); // mov edi, id
+            emit_u32(as, instr->b);
+            EMIT(as, 0xBE); // mov esi, num_args
+            emit_u32(as, instr->num_args);
+            EMIT(as, 0x48, 0x89, 0xE2); // mov rdx, rsp
+            EMIT(as, 0x48, 0x8D, 0x8B); // lea rcx, [rbx + disp32]
+            emit_u32(as, instr->dest * sizeof(double));
+            emit_call(as, ADDRESS(arith_id_evaluate));
+            EMIT(as,
+                0x85, 0xC0,  // test eax, eax
+                0x0F, 0x85   // jnz rel32
+            );
+            emit_jump_to_exit(as);
+            break;
+        }
+    }
+}
+
+/*
+Summary: Enables or disables translation of programs that are compiled from now on
+Returns: Previous value
+*/
+bool set_jit_enabled(bool value)
+{
+    bool res = jit_enabled;
+    jit_enabled = value;
+    return res;
+}
+
+/*
+Summary: Translates instructions of program to machine code, program keeps being interpreted on failure
+Returns: True if native code has been generated
+*/
+bool jit_compile(Program *program)
+{
+    if (!jit_enabled) return false;
+
+    Assembler as = {
+        .program = program,
+        .code = vec_create(sizeof(unsigned char), CODE_STARTSIZE),
+        .exit_fixups = vec_create(sizeof(Fixup), FIXUPS_STARTSIZE),
+        .constant_fixups = vec_create(sizeof(Fixup), FIXUPS_STARTSIZE)
+    };
+
+    // Prologue: rdi = variables, rsi = register file, rdx = pointer to result
+    EMIT(&as,
+        0x53,                   // push rbx
+        0x55,                   // push rbp
+        0x48, 0x81, 0xEC        // sub rsp, imm32
+    );
+    emit_u32(&as, FRAME_SIZE);
+    EMIT(&as,
+        0x48, 0x89, 0xFD,       // mov rbp, rdi
+        0x48, 0x89, 0xF3,       // mov rbx, rsi
+        0x48, 0x89, 0x94, 0x24  // mov [rsp + disp32], rdx
+    );
+    emit_u32(&as, FRAME_OUT);
+
+    const Instruction *instructions = (const Instruction*)program->instructions.buffer;
+    for (size_t i = 0; i < vec_count(&program->instructions); i++)
+    {
+        emit_instruction(&as, instructions + i);
+    }
+
+    // Store result and succeed, errors jump to exit with eax already set
+    emit_load(&as, 0, program->result_register);
+    EMIT(&as, 0x48, 0x8B, 0x84, 0x24); // mov rax, [rsp + disp32]
+    emit_u32(&as, FRAME_OUT);
+    EMIT(&as,
+        0xF2, 0x0F, 0x11, 0x00, // movsd [rax], xmm0
+        0x31, 0xC0              // xor eax, eax
+    );
+    size_t exit_offset = vec_count(&as.code);
+    EMIT(&as, 0x48, 0x81, 0xC4); // add rsp, imm32
+    emit_u32(&as, FRAME_SIZE);
+    EMIT(&as,
+        0x5D,                   // pop rbp
+        0x5B,                   // pop rbx
+        0xC3                    // ret
+    );
+
+    // Constants pool follows code, aligned to 8 bytes
+    while (vec_count(&as.code) % sizeof(double) != 0) EMIT(&as, 0xCC);
+    size_t pool_offset = vec_count(&as.code);
+    vec_push_many(&as.code, vec_count(&program->constants) * sizeof(double), program->constants.buffer);
+
+    for (size_t i = 0; i < vec_count(&as.exit_fixups); i++)
+    {
+        Fixup *fixup = (Fixup*)vec_get(&as.exit_fixups, i);
+        patch_u32(&as, fixup->offset, (unsigned int)(exit_offset - (fixup->offset + 4)));
+    }
+    // Displacement of rip-relative operand ends each SSE instruction
+    for (size_t i = 0; i < vec_count(&as.constant_fixups); i++)
+    {
+        Fixup *fixup = (Fixup*)vec_get(&as.constant_fixups, i);
+        patch_u32(&as, fixup->offset,
+            (unsigned int)(pool_offset + fixup->target * sizeof(double) - (fixup->offset + 4)));
+    }
+
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    size_t size = (vec_count(&as.code) + page_size - 1) / page_size * page_size;
+    void *mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping != MAP_FAILED)
+    {
+        memcpy(mapping, as.code.buffer, vec_count(&as.code));
+        if (mprotect(mapping, size, PROT_READ | PROT_EXEC) == 0)
+        {
+            program->native_code = (NativeFunction)(size_t)mapping;
+            program->native_size = size;
+        }
+        else
+        {
+            munmap(mapping, size);
+        }
+    }
+
+    vec_destroy(&as.code);
+    vec_destroy(&as.exit_fixups);
+    vec_destroy(&as.constant_fixups);
+    return program->native_code != NULL;
+}
+
+void jit_free(Program *program)
+{
+    if (program->native_code != NULL)
+    {
+        munmap((void*)(size_t)program->native_code, program->native_size);
+        program->native_code = NULL;
+    }
+}
+
+#else
+
+bool set_jit_enabled(__attribute__((unused)) bool value)
+{
+    return false;
+}
+
+bool jit_compile(__attribute__((unused)) Program *program)
+{
+    return false;
+}
+
+void jit_free(__attribute__((unused)) Program *program) { }
+
+#endif
@@ -0,0 +1,7 @@
+#pragma once
+#include <stdbool.h>
+#include "bytecode.h"
+
+bool set_jit_enabled(bool value);
+bool jit_compile(Program *program);
+void jit_free(Program *program);
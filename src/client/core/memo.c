@@ -0,0 +1,168 @@
+#include <string.h>
+
+#include "../../util/alloc_wrappers.h"
+#include "memo.h"
+
+// Marks end of bucket or LRU list
+#define MEMO_NONE SIZE_MAX
+
+static uint64_t get_bits(double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static uint64_t hash_args(size_t num_args, const double *args)
+{
+    uint64_t hash = 0xcbf29ce484222325;
+    for (size_t i = 0; i < num_args; i++)
+    {
+        hash = (hash ^ get_bits(args[i])) * 0x9e3779b97f4a7c15;
+        hash ^= hash >> 29;
+    }
+    return hash;
+}
+
+/*
+Params
+    capacity: Maximum number of cached results, at least 1
+*/
+MemoCache *memo_create(size_t num_args, size_t capacity)
+{
+    MemoCache *memo = malloc_wrapper(sizeof(MemoCache));
+    memo->num_args = num_args;
+    memo->capacity = capacity;
+    memo->count = 0;
+    memo->hits = 0;
+    memo->misses = 0;
+    // Keys of functions without parameters would be an allocation of zero bytes
+    memo->keys = malloc_wrapper(capacity * (num_args + 1) * sizeof(uint64_t));
+    memo->entries = malloc_wrapper(capacity * sizeof(MemoEntry));
+    // At most half of the buckets are used
+    memo->num_buckets = 1;
+    while (memo->num_buckets < 2 * capacity) memo->num_buckets *= 2;
+    memo->buckets = malloc_wrapper(memo->num_buckets * sizeof(size_t));
+    for (size_t i = 0; i < memo->num_buckets; i++) memo->buckets[i] = MEMO_NONE;
+    memo->lru_first = MEMO_NONE;
+    memo->lru_last = MEMO_NONE;
+    pthread_mutex_init(&memo->mutex, NULL);
+    return memo;
+}
+
+void memo_destroy(MemoCache *memo)
+{
+    if (memo == NULL) return;
+    pthread_mutex_destroy(&memo->mutex);
+    free(memo->keys);
+    free(memo->entries);
+    free(memo->buckets);
+    free(memo);
+}
+
+static void lru_unlink(MemoCache *memo, size_t index)
+{
+    MemoEntry *entry = &memo->entries[index];
+    if (entry->lru_prev != MEMO_NONE) memo->entries[entry->lru_prev].lru_next = entry->lru_next;
+    else memo->lru_first = entry->lru_next;
+    if (entry->lru_next != MEMO_NONE) memo->entries[entry->lru_next].lru_prev = entry->lru_prev;
+    else memo->lru_last = entry->lru_prev;
+}
+
+static void lru_push_front(MemoCache *memo, size_t index)
+{
+    MemoEntry *entry = &memo->entries[index];
+    entry->lru_prev = MEMO_NONE;
+    entry->lru_next = memo->lru_first;
+    if (memo->lru_first != MEMO_NONE) memo->entries[memo->lru_first].lru_prev = index;
+    memo->lru_first = index;
+    if (memo->lru_last == MEMO_NONE) memo->lru_last = index;
+}
+
+// Returns index of entry with given arguments, MEMO_NONE if there is none
+static size_t find_entry(const MemoCache *memo, const double *args, uint64_t hash)
+{
+    size_t index = memo->buckets[hash & (memo->num_buckets - 1)];
+    while (index != MEMO_NONE)
+    {
+        const uint64_t *keys = memo->keys + index * memo->num_args;
+        if (memo->entries[index].hash == hash)
+        {
+            size_t i = 0;
+            while (i < memo->num_args && keys[i] == get_bits(args[i])) i++;
+            if (i == memo->num_args) return index;
+        }
+        index = memo->entries[index].bucket_next;
+    }
+    return MEMO_NONE;
+}
+
+static void bucket_unlink(MemoCache *memo, size_t index)
+{
+    size_t *link = &memo->buckets[memo->entries[index].hash & (memo->num_buckets - 1)];
+    while (*link != index) link = &memo->entries[*link].bucket_next;
+    *link = memo->entries[index].bucket_next;
+}
+
+/*
+Summary: Looks up result of call with given arguments, counts hit or miss
+Returns: True if result is cached, out and out_error are only written then
+*/
+bool memo_lookup(MemoCache *memo, const double *args, double *out, ListenerError *out_error)
+{
+    uint64_t hash = hash_args(memo->num_args, args);
+    pthread_mutex_lock(&memo->mutex);
+    size_t index = find_entry(memo, args, hash);
+    if (index == MEMO_NONE)
+    {
+        memo->misses++;
+        pthread_mutex_unlock(&memo->mutex);
+        return false;
+    }
+
+    memo->hits++;
+    lru_unlink(memo, index);
+    lru_push_front(memo, index);
+    *out = memo->entries[index].result;
+    *out_error = memo->entries[index].error;
+    pthread_mutex_unlock(&memo->mutex);
+    return true;
+}
+
+/*
+Summary: Adds result of call, replaces least recently used result when cache is full
+    Other threads may have inserted the same arguments in the meantime, then nothing is added
+*/
+void memo_insert(MemoCache *memo, const double *args, double result, ListenerError error)
+{
+    uint64_t hash = hash_args(memo->num_args, args);
+    pthread_mutex_lock(&memo->mutex);
+    if (find_entry(memo, args, hash) != MEMO_NONE)
+    {
+        pthread_mutex_unlock(&memo->mutex);
+        return;
+    }
+
+    size_t index;
+    if (memo->count < memo->capacity)
+    {
+        index = memo->count++;
+    }
+    else
+    {
+        index = memo->lru_last;
+        lru_unlink(memo, index);
+        bucket_unlink(memo, index);
+    }
+
+    for (size_t i = 0; i < memo->num_args; i++) memo->keys[index * memo->num_args + i] = get_bits(args[i]);
+    MemoEntry *entry = &memo->entries[index];
+    entry->hash = hash;
+    entry->result = result;
+    entry->error = error;
+    size_t *bucket = &memo->buckets[hash & (memo->num_buckets - 1)];
+    entry->bucket_next = *bucket;
+    *bucket = index;
+    lru_push_front(memo, index);
+    pthread_mutex_unlock(&memo->mutex);
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "../../engine/tree/tree_util.h"
+
+#define MEMO_DEFAULT_CAPACITY 1024
+
+typedef struct {
+    size_t bucket_next; // Next entry in same bucket
+    size_t lru_prev;    // More recently used entry
+    size_t lru_next;    // Less recently used entry
+    uint64_t hash;
+    double result;
+    ListenerError error;
+} MemoEntry;
+
+/*
+Bounded cache of results of a pure function, keyed by the bits of its arguments.
+When it is full, the least recently used entry is replaced.
+Caches are shared by worker threads, each operation locks its mutex.
+*/
+typedef struct {
+    size_t num_args;
+    size_t capacity;
+    size_t count;
+    size_t hits;
+    size_t misses;
+    uint64_t *keys;      // Arguments of i-th entry are keys[i * num_args], ..., keys[(i + 1) * num_args - 1]
+    MemoEntry *entries;
+    size_t *buckets;     // First entry of each bucket
+    size_t num_buckets;  // Power of two
+    size_t lru_first;    // Most recently used entry
+    size_t lru_last;     // Least recently used entry
+    pthread_mutex_t mutex;
+} MemoCache;
+
+MemoCache *memo_create(size_t num_args, size_t capacity);
+void memo_destroy(MemoCache *memo);
+bool memo_lookup(MemoCache *memo, const double *args, double *out, ListenerError *out_error);
+void memo_insert(MemoCache *memo, const double *args, double result, ListenerError error);
@@ -0,0 +1,123 @@
+#include <stdlib.h>
+
+#include "../../util/alloc_wrappers.h"
+#include "../../util/parallel.h"
+#include "random.h"
+#include "montecarlo.h"
+
+// Minimum number of samples that are evaluated by a worker at once
+#define CHUNK_SIZE 4096
+// Upper limit for number of chunks, chunks of many samples are larger
+#define MAX_CHUNKS 4096
+
+// Running statistics of samples (Welford's algorithm)
+typedef struct {
+    double count;
+    double mean;
+    double m2; // Sum of squared deviations from mean
+} Moments;
+
+// State of simulation that is shared by workers
+typedef struct {
+    const Program *program;
+    uint64_t seed;
+    size_t num_samples;
+    size_t chunk_size;
+    Moments *partial_moments; // Per chunk
+    size_t *first_errors;     // Per chunk: index of first erroneous sample, num_samples if there is none
+    ListenerError *errors;    // Per chunk: error of that sample
+} MonteCarloJob;
+
+static void add_sample(Moments *moments, double x)
+{
+    moments->count++;
+    double delta = x - moments->mean;
+    moments->mean += delta / moments->count;
+    moments->m2 += delta * (x - moments->mean);
+}
+
+/*
+Summary: Combines moments of two disjoint sets of samples (Chan et al.)
+*/
+static void merge_moments(Moments *moments, const Moments *other)
+{
+    if (other->count == 0) return;
+    double count = moments->count + other->count;
+    double delta = other->mean - moments->mean;
+    moments->mean += delta * other->count / count;
+    moments->m2 += other->m2 + delta * delta * moments->count * other->count / count;
+    moments->count = count;
+}
+
+/*
+Summary: Evaluates samples of chunk, runs on worker thread
+*/
+static void montecarlo_work(size_t chunk_index, void *context)
+{
+    MonteCarloJob *job = (MonteCarloJob*)context;
+    size_t start = chunk_index * job->chunk_size;
+    size_t end = start + job->chunk_size < job->num_samples ? start + job->chunk_size : job->num_samples;
+
+    Moments moments = { 0, 0, 0 };
+    job->first_errors[chunk_index] = job->num_samples;
+    for (size_t i = start; i < end; i++)
+    {
+        double value;
+        random_set_stream(job->seed, i);
+        ListenerError err = run_program(job->program, NULL, &value);
+        if (err != LISTENERERR_SUCCESS)
+        {
+            job->first_errors[chunk_index] = i;
+            job->errors[chunk_index] = err;
+            break;
+        }
+        add_sample(&moments, value);
+    }
+    random_reset_stream();
+    job->partial_moments[chunk_index] = moments;
+}
+
+/*
+Summary: Evaluates program num_samples times on all workers and computes mean and variance of results
+Params
+    program:     Program without variable slots
+    num_samples: At least 1 and at most MONTECARLO_MAX_SAMPLES
+*/
+MonteCarloResult monte_carlo(const Program *program, size_t num_samples, uint64_t seed)
+{
+    size_t chunk_size = num_samples / MAX_CHUNKS >= CHUNK_SIZE ? num_samples / MAX_CHUNKS + 1 : CHUNK_SIZE;
+    size_t num_chunks = (num_samples + chunk_size - 1) / chunk_size;
+
+    MonteCarloJob job = {
+        .program = program,
+        .seed = seed,
+        .num_samples = num_samples,
+        .chunk_size = chunk_size,
+        .partial_moments = malloc_wrapper((num_chunks + 1) * sizeof(Moments)),
+        .first_errors = malloc_wrapper((num_chunks + 1) * sizeof(size_t)),
+        .errors = malloc_wrapper((num_chunks + 1) * sizeof(ListenerError))
+    };
+    // Every sample has its own stream, thus samples that call rand can be evaluated in parallel
+    run_chunks_ordered(num_chunks, get_num_workers(), montecarlo_work, NULL, &job);
+
+    // Moments are combined in order of chunks, so the result is reproducible
+    MonteCarloResult result = { .error = LISTENERERR_SUCCESS };
+    Moments total = { 0, 0, 0 };
+    for (size_t i = 0; i < num_chunks; i++)
+    {
+        if (job.first_errors[i] != num_samples)
+        {
+            result.error = job.errors[i];
+            result.error_sample = job.first_errors[i];
+            break;
+        }
+        merge_moments(&total, &job.partial_moments[i]);
+    }
+    result.mean = total.mean;
+    result.variance = total.count > 1 ? total.m2 / (total.count - 1) : 0;
+
+    free(job.partial_moments);
+    free(job.first_errors);
+    free(job.errors);
+    return result;
+}
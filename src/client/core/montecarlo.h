@@ -0,0 +1,21 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "bytecode.h"
+
+// Largest number of samples, sample indices beyond are not exactly representable anymore
+#define MONTECARLO_MAX_SAMPLES 9007199254740992.0 // 2^53
+
+/*
+Mean and variance of samples of a program that calls rand.
+Sample i draws its random numbers from stream i of the seed (see random.h), and samples are split into chunks
+that only depend on the number of samples, thus results only depend on the seed and not on the number of workers.
+*/
+typedef struct {
+    double mean;
+    double variance;      // Unbiased sample variance
+    ListenerError error;  // Error of first sample that could not be evaluated
+    size_t error_sample;  // Index of that sample, only set when error is not LISTENERERR_SUCCESS
+} MonteCarloResult;
+
+MonteCarloResult monte_carlo(const Program *program, size_t num_samples, uint64_t seed);
@@ -0,0 +1,77 @@
+#pragma once
+#include <stddef.h>
+
+/*
+Interface of plugins that are loaded at runtime with "load plugin <path>".
+A plugin is a shared object that exports a PluginDescription named ccalc_plugin, for example:
+
+    static int eval_hypot(size_t num_args, const double *args, double *out)
+    {
+        *out = sqrt(args[0] * args[0] + args[1] * args[1]);
+        return PLUGIN_SUCCESS;
+    }
+
+    static const PluginOperator ops[] = {
+        { "hypot", PLUGIN_PLACE_FUNCTION, 2, 0, PLUGIN_ASSOC_LEFT, eval_hypot, NULL }
+    };
+
+    const PluginDescription ccalc_plugin = { PLUGIN_API_VERSION, 1, ops };
+
+This header does not include any other header of ccalc, so that it can be copied to sources of plugins.
+Evaluation functions are called concurrently by worker threads, thus they must be thread-safe.
+They must be pure, results of calls with constant arguments are folded by the simplification.
+*/
+
+#define PLUGIN_API_VERSION    1
+#define PLUGIN_SYMBOL         "ccalc_plugin"
+#define PLUGIN_DYNAMIC_ARITY  ((size_t)-1)
+
+// Error codes returned by evaluation functions, other codes are reported as unknown operator
+#define PLUGIN_SUCCESS           0
+#define PLUGIN_DIVISION_BY_ZERO  6
+
+typedef enum {
+    PLUGIN_PLACE_PREFIX,
+    PLUGIN_PLACE_INFIX,
+    PLUGIN_PLACE_POSTFIX,
+    PLUGIN_PLACE_FUNCTION,
+} PluginPlacement;
+
+typedef enum {
+    PLUGIN_ASSOC_RIGHT,
+    PLUGIN_ASSOC_LEFT,
+} PluginAssociativity;
+
+/*
+Summary: Evaluates operator for one set of arguments
+Returns: PLUGIN_SUCCESS or an error code, out is ignored on error
+*/
+typedef int (*PluginScalarFunction)(size_t num_args, const double *args, double *out);
+
+/*
+Summary: Evaluates operator for many sets of arguments at once, used by tables and folds
+Params
+    num_rows:    Number of rows
+    num_args:    Number of arguments of each row
+    arg_columns: i-th argument of row r is arg_columns[i][r]
+    out_results: Result of row r is written to out_results[r]
+    out_errors:  Error code of row r must be written to out_errors[r]
+*/
+typedef void (*PluginBatchFunction)(size_t num_rows, size_t num_args, const double **arg_columns,
+    double *out_results, int *out_errors);
+
+typedef struct {
+    const char *name;
+    PluginPlacement placement;
+    size_t arity;                   // Only used by functions, can be PLUGIN_DYNAMIC_ARITY
+    unsigned char precedence;       // Only used by prefix, infix and postfix operators
+    PluginAssociativity assoc;      // Only used by infix operators
+    PluginScalarFunction eval;      // Must not be NULL
+    PluginBatchFunction eval_batch; // Can be NULL, then eval is called for each row
+} PluginOperator;
+
+typedef struct {
+    unsigned int api_version; // Must be PLUGIN_API_VERSION
+    size_t num_ops;
+    const PluginOperator *ops;
+} PluginDescription;
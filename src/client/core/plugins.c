@@ -0,0 +1,239 @@
+#define _GNU_SOURCE
+#include <string.h>
+#include <dlfcn.h>
+
+#include "../../util/alloc_wrappers.h"
+#include "../../util/console_util.h"
+#include "../../util/vector.h"
+#include "arith_context.h"
+#include "arith_evaluation.h"
+#include "plugins.h"
+
+#define OPS_STARTSIZE     16
+#define HANDLES_STARTSIZE  4
+
+typedef struct {
+    const Operator *op;           // Operator in g_ctx, NULL if id does not belong to a plugin
+    const PluginOperator *plugin; // Description in memory of shared object
+} PluginEntry;
+
+static bool initialized = false;
+// Dispatch table, indexed by id of operator minus NUM_ARITH_OPS (payload: PluginEntry)
+static Vector entries;
+// Handles of loaded shared objects (payload: void*)
+static Vector handles;
+// Names of operators in g_ctx, the context does not copy them (payload: char*)
+static Vector names;
+
+static void init_plugins()
+{
+    if (initialized) return;
+    entries = vec_create(sizeof(PluginEntry), OPS_STARTSIZE);
+    handles = vec_create(sizeof(void*), HANDLES_STARTSIZE);
+    names = vec_create(sizeof(char*), OPS_STARTSIZE);
+    initialized = true;
+}
+
+static Operator get_operator(const PluginOperator *plugin_op, char *name)
+{
+    switch (plugin_op->placement)
+    {
+        case PLUGIN_PLACE_PREFIX:
+            return op_get_prefix(name, plugin_op->precedence);
+        case PLUGIN_PLACE_INFIX:
+            return op_get_infix(name, plugin_op->precedence,
+                plugin_op->assoc == PLUGIN_ASSOC_LEFT ? OP_ASSOC_LEFT : OP_ASSOC_RIGHT);
+        case PLUGIN_PLACE_POSTFIX:
+            return op_get_postfix(name, plugin_op->precedence);
+        default:
+            return op_get_function(name,
+                plugin_op->arity == PLUGIN_DYNAMIC_ARITY ? OP_DYNAMIC_ARITY : plugin_op->arity);
+    }
+}
+
+static bool is_valid(const PluginOperator *plugin_op)
+{
+    return plugin_op->name != NULL
+        && plugin_op->name[0] != '\0'
+        && plugin_op->eval != NULL
+        && plugin_op->placement <= PLUGIN_PLACE_FUNCTION
+        && (plugin_op->placement != PLUGIN_PLACE_FUNCTION
+            || plugin_op->arity == PLUGIN_DYNAMIC_ARITY
+            || plugin_op->arity <= MAX_CHILDREN);
+}
+
+/*
+Summary: Removes operators that have been added by a failed load
+*/
+static void roll_back(size_t num_names)
+{
+    while (vec_count(&names) > num_names)
+    {
+        char *name = *(char**)vec_pop(&names);
+        for (size_t i = 0; i < OP_NUM_PLACEMENTS; i++)
+        {
+            const Operator *op = ctx_lookup_op(g_ctx, name, i);
+            if (op != NULL && is_plugin_op(op))
+            {
+                VEC_SET_ELEM(&entries, PluginEntry, op->id - NUM_ARITH_OPS, ((PluginEntry){ NULL, NULL }));
+                ctx_delete_op(g_ctx, name, i);
+            }
+        }
+        free(name);
+    }
+}
+
+/*
+Summary: Loads shared object and adds its operators to g_ctx, either all or none of them
+Returns: Number of added operators, -1 on error (which is reported)
+*/
+ssize_t load_plugin(const char *path)
+{
+    init_plugins();
+
+    void *handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (handle == NULL)
+    {
+        report_error("Error loading plugin: %s\n", dlerror());
+        return -1;
+    }
+
+    const PluginDescription *desc = dlsym(handle, PLUGIN_SYMBOL);
+    if (desc == NULL)
+    {
+        report_error("Error loading plugin: Symbol " PLUGIN_SYMBOL " not found\n");
+        goto error;
+    }
+    if (desc->api_version != PLUGIN_API_VERSION)
+    {
+        report_error("Error loading plugin: Version %u of interface is not supported\n", desc->api_version);
+        goto error;
+    }
+
+    size_t num_names = vec_count(&names);
+    for (size_t i = 0; i < desc->num_ops; i++)
+    {
+        const PluginOperator *plugin_op = &desc->ops[i];
+        if (!is_valid(plugin_op))
+        {
+            report_error("Error loading plugin: Operator %zu is invalid\n", i);
+            roll_back(num_names);
+            goto error;
+        }
+
+        char *name = malloc_wrapper(strlen(plugin_op->name) + 1);
+        strcpy(name, plugin_op->name);
+        const Operator *op = ctx_add_op(g_ctx, get_operator(plugin_op, name));
+        if (op == NULL)
+        {
+            report_error("Error loading plugin: Operator %s clashes with existing operator\n", name);
+            free(name);
+            roll_back(num_names);
+            goto error;
+        }
+        VEC_PUSH_ELEM(&names, char*, name);
+
+        while (vec_count(&entries) <= op->id - NUM_ARITH_OPS)
+        {
+            VEC_PUSH_ELEM(&entries, PluginEntry, ((PluginEntry){ NULL, NULL }));
+        }
+        VEC_SET_ELEM(&entries, PluginEntry, op->id - NUM_ARITH_OPS, ((PluginEntry){ op, plugin_op }));
+    }
+
+    VEC_PUSH_ELEM(&handles, void*, handle);
+    return (ssize_t)desc->num_ops;
+
+    error:
+    dlclose(handle);
+    return -1;
+}
+
+/*
+Summary: Looks up operator of plugin by its id in g_ctx
+Returns: NULL if id does not belong to a plugin
+*/
+const PluginOperator *get_plugin_op(size_t id)
+{
+    if (!initialized || id < NUM_ARITH_OPS || id - NUM_ARITH_OPS >= vec_count(&entries)) return NULL;
+    return ((PluginEntry*)vec_get(&entries, id - NUM_ARITH_OPS))->plugin;
+}
+
+/*
+Summary: Ids of other contexts overlap with those of g_ctx, so the operator itself is compared
+*/
+bool is_plugin_op(const Operator *op)
+{
+    if (!initialized || op->id < NUM_ARITH_OPS || op->id - NUM_ARITH_OPS >= vec_count(&entries)) return false;
+    return ((PluginEntry*)vec_get(&entries, op->id - NUM_ARITH_OPS))->op == op;
+}
+
+static ListenerError to_listener_error(int plugin_error)
+{
+    switch (plugin_error)
+    {
+        case PLUGIN_SUCCESS:
+            return LISTENERERR_SUCCESS;
+        case PLUGIN_DIVISION_BY_ZERO:
+            return LISTENERERR_DIVISION_BY_ZERO;
+        default:
+            return LISTENERERR_UNKNOWN_OP;
+    }
+}
+
+ListenerError plugin_id_evaluate(size_t id, size_t num_args, const double *args, double *out)
+{
+    const PluginOperator *plugin_op = get_plugin_op(id);
+    if (plugin_op == NULL) return LISTENERERR_UNKNOWN_OP;
+    return to_listener_error(plugin_op->eval(num_args, args, out));
+}
+
+/*
+Summary: Evaluates operator of plugin for many rows, with batch function of plugin if available
+Params
+    out_errors: Rows that already have an error keep it
+*/
+void plugin_id_evaluate_batch(size_t id, size_t num_rows, size_t num_args, const double **arg_columns,
+    double *out_results, ListenerError *out_errors)
+{
+    const PluginOperator *plugin_op = get_plugin_op(id);
+    if (plugin_op == NULL)
+    {
+        for (size_t r = 0; r < num_rows; r++) out_errors[r] = LISTENERERR_UNKNOWN_OP;
+        return;
+    }
+
+    if (plugin_op->eval_batch != NULL)
+    {
+        int *errors = malloc_wrapper(num_rows * sizeof(int));
+        plugin_op->eval_batch(num_rows, num_args, arg_columns, out_results, errors);
+        for (size_t r = 0; r < num_rows; r++)
+        {
+            if (out_errors[r] == LISTENERERR_SUCCESS) out_errors[r] = to_listener_error(errors[r]);
+        }
+        free(errors);
+    }
+    else
+    {
+        for (size_t r = 0; r < num_rows; r++)
+        {
+            if (out_errors[r] != LISTENERERR_SUCCESS) continue;
+            double args[MAX_CHILDREN];
+            for (size_t i = 0; i < num_args; i++) args[i] = arg_columns[i][r];
+            out_errors[r] = to_listener_error(plugin_op->eval(num_args, args, out_results + r));
+        }
+    }
+}
+
+/*
+Summary: Frees names and closes shared objects, must be called after g_ctx has been destroyed
+*/
+void unload_plugins()
+{
+    if (!initialized) return;
+    for (size_t i = 0; i < vec_count(&names); i++) free(*(char**)vec_get(&names, i));
+    for (size_t i = 0; i < vec_count(&handles); i++) dlclose(*(void**)vec_get(&handles, i));
+    vec_destroy(&entries);
+    vec_destroy(&handles);
+    vec_destroy(&names);
+    initialized = false;
+}
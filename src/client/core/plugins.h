@@ -0,0 +1,14 @@
+#pragma once
+#include <stdbool.h>
+#include <sys/types.h>
+#include "../../engine/tree/operator.h"
+#include "../../engine/tree/tree_util.h"
+#include "plugin_api.h"
+
+ssize_t load_plugin(const char *path);
+const PluginOperator *get_plugin_op(size_t id);
+bool is_plugin_op(const Operator *op);
+ListenerError plugin_id_evaluate(size_t id, size_t num_args, const double *args, double *out);
+void plugin_id_evaluate_batch(size_t id, size_t num_rows, size_t num_args, const double **arg_columns,
+    double *out_results, ListenerError *out_errors);
+void unload_plugins();
@@ -0,0 +1,77 @@
+#include <stdbool.h>
+
+#include "random.h"
+
+#define GOLDEN_GAMMA 0x9e3779b97f4a7c15ULL
+
+typedef struct {
+    uint64_t key;     // Derived from seed and stream
+    uint64_t counter; // Index of next number of stream
+    bool is_set;
+} Stream;
+
+static uint64_t global_seed = 0;
+// Stream 0 of global seed, continues where it stopped when a selected stream is reset
+static __thread Stream default_stream = { 0, 0, false };
+static __thread Stream selected_stream = { 0, 0, false };
+
+// Finalizer of SplitMix64, a bijection that mixes all bits
+static uint64_t mix(uint64_t z)
+{
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static Stream make_stream(uint64_t seed, uint64_t stream)
+{
+    return (Stream){ .key = mix(seed ^ mix(stream + GOLDEN_GAMMA)), .counter = 0, .is_set = true };
+}
+
+void init_random(uint64_t seed)
+{
+    global_seed = seed;
+}
+
+uint64_t random_get_seed()
+{
+    return global_seed;
+}
+
+/*
+Summary: Selects stream of calling thread and starts it at its first number
+*/
+void random_set_stream(uint64_t seed, uint64_t stream)
+{
+    selected_stream = make_stream(seed, stream);
+}
+
+/*
+Summary: Calling thread draws from default stream again
+*/
+void random_reset_stream()
+{
+    selected_stream.is_set = false;
+}
+
+/*
+Returns: Next number of current stream of calling thread, all 64 bits are random
+*/
+uint64_t random_next()
+{
+    Stream *stream = &selected_stream;
+    if (!stream->is_set)
+    {
+        stream = &default_stream;
+        if (!stream->is_set) *stream = make_stream(global_seed, 0);
+    }
+    return mix(stream->key + ++stream->counter * GOLDEN_GAMMA);
+}
+
+/*
+Returns: Next number of current stream of calling thread, uniformly distributed in [0, 1)
+*/
+double random_uniform()
+{
+    return (double)(random_next() >> 11) * 0x1.0p-53;
+}
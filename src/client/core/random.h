@@ -0,0 +1,14 @@
+#pragma once
+#include <stdint.h>
+
+/*
+Counter-based random numbers: the i-th number of a stream is a hash of seed, stream and i (SplitMix64),
+so streams can be generated on any thread in any order and are reproducible.
+Every thread draws from its own current stream, which is stream 0 of the global seed unless another one is selected.
+*/
+void init_random(uint64_t seed);
+uint64_t random_get_seed();
+void random_set_stream(uint64_t seed, uint64_t stream);
+void random_reset_stream();
+uint64_t random_next();
+double random_uniform();
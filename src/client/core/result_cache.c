@@ -0,0 +1,246 @@
+#include <string.h>
+#include <stdint.h>
+
+#include "../../util/alloc_wrappers.h"
+#include "../../engine/tree/tree_util.h"
+#include "result_cache.h"
+
+// Marks end of bucket or LRU list
+#define CACHE_NONE SIZE_MAX
+// At most half of the buckets are used
+#define NUM_BUCKETS (2 * RESULT_CACHE_CAPACITY)
+
+typedef struct {
+    size_t bucket_next; // Next entry in same bucket
+    size_t lru_prev;    // More recently used entry
+    size_t lru_next;    // Less recently used entry
+    uint64_t hash;
+    Node *tree;
+    double result;
+} CacheEntry;
+
+/*
+Bounded cache of results of expressions without variables, keyed by their trees.
+When it is full, the least recently used entry is replaced.
+Operands of addition and multiplication are unordered, thus a+b and b+a share an entry.
+*/
+static CacheEntry entries[RESULT_CACHE_CAPACITY];
+static size_t buckets[NUM_BUCKETS];
+static size_t count = 0;
+static size_t hits = 0;
+static size_t misses = 0;
+static size_t lru_first = CACHE_NONE;
+static size_t lru_last = CACHE_NONE;
+static bool buckets_initialized = false;
+
+static uint64_t mix(uint64_t hash, uint64_t value)
+{
+    hash = (hash ^ value) * 0x9e3779b97f4a7c15;
+    return hash ^ (hash >> 29);
+}
+
+static bool is_commutative(const Operator *op)
+{
+    return op->id == 4 || op->id == 6; // +, *
+}
+
+/*
+Summary: Structural hash that does not depend on order of operands of commutative operators
+*/
+static uint64_t hash_tree(const Node *tree)
+{
+    uint64_t hash = 0xcbf29ce484222325;
+    switch (get_type(tree))
+    {
+        case NTYPE_CONSTANT:
+        {
+            double value = get_const_value(tree);
+            uint64_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            return mix(hash, bits);
+        }
+        case NTYPE_VARIABLE:
+            for (const char *c = get_var_name(tree); *c != '\0'; c++) hash = mix(hash, (uint64_t)*c);
+            return mix(hash, 1);
+        case NTYPE_OPERATOR:
+        {
+            hash = mix(hash, (uint64_t)(uintptr_t)get_op(tree));
+            size_t num_children = get_num_children(tree);
+            if (num_children == 2 && is_commutative(get_op(tree)))
+            {
+                uint64_t a = hash_tree(get_child(tree, 0));
+                uint64_t b = hash_tree(get_child(tree, 1));
+                return mix(mix(hash, a < b ? a : b), a < b ? b : a);
+            }
+            for (size_t i = 0; i < num_children; i++)
+            {
+                hash = mix(hash, hash_tree(get_child(tree, i)));
+            }
+            return hash;
+        }
+    }
+    return hash;
+}
+
+/*
+Returns: True if trees are equal up to order of operands of commutative operators
+*/
+static bool canonical_equals(const Node *a, const Node *b)
+{
+    if (get_type(a) != get_type(b)) return false;
+    switch (get_type(a))
+    {
+        case NTYPE_CONSTANT:
+        {
+            double x = get_const_value(a);
+            double y = get_const_value(b);
+            return memcmp(&x, &y, sizeof(double)) == 0;
+        }
+        case NTYPE_VARIABLE:
+            return strcmp(get_var_name(a), get_var_name(b)) == 0;
+        case NTYPE_OPERATOR:
+        {
+            if (get_op(a) != get_op(b) || get_num_children(a) != get_num_children(b)) return false;
+            size_t num_children = get_num_children(a);
+            if (num_children == 2 && is_commutative(get_op(a))
+                && canonical_equals(get_child(a, 0), get_child(b, 1))
+                && canonical_equals(get_child(a, 1), get_child(b, 0)))
+            {
+                return true;
+            }
+            for (size_t i = 0; i < num_children; i++)
+            {
+                if (!canonical_equals(get_child(a, i), get_child(b, i))) return false;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+static void init_buckets()
+{
+    for (size_t i = 0; i < NUM_BUCKETS; i++) buckets[i] = CACHE_NONE;
+    buckets_initialized = true;
+}
+
+static void lru_unlink(size_t index)
+{
+    CacheEntry *entry = &entries[index];
+    if (entry->lru_prev != CACHE_NONE) entries[entry->lru_prev].lru_next = entry->lru_next;
+    else lru_first = entry->lru_next;
+    if (entry->lru_next != CACHE_NONE) entries[entry->lru_next].lru_prev = entry->lru_prev;
+    else lru_last = entry->lru_prev;
+}
+
+static void lru_push_front(size_t index)
+{
+    CacheEntry *entry = &entries[index];
+    entry->lru_prev = CACHE_NONE;
+    entry->lru_next = lru_first;
+    if (lru_first != CACHE_NONE) entries[lru_first].lru_prev = index;
+    lru_first = index;
+    if (lru_last == CACHE_NONE) lru_last = index;
+}
+
+static void bucket_unlink(size_t index)
+{
+    size_t *link = &buckets[entries[index].hash % NUM_BUCKETS];
+    while (*link != index) link = &entries[*link].bucket_next;
+    *link = entries[index].bucket_next;
+}
+
+// Returns index of entry of tree, CACHE_NONE if there is none
+static size_t find_entry(const Node *tree, uint64_t hash)
+{
+    if (!buckets_initialized) init_buckets();
+    size_t index = buckets[hash % NUM_BUCKETS];
+    while (index != CACHE_NONE)
+    {
+        if (entries[index].hash == hash && canonical_equals(entries[index].tree, tree)) return index;
+        index = entries[index].bucket_next;
+    }
+    return CACHE_NONE;
+}
+
+/*
+Summary: Looks up result of expression, counts hit or miss
+Returns: True if result is cached, out is only written then
+*/
+bool result_cache_lookup(const Node *tree, double *out)
+{
+    size_t index = find_entry(tree, hash_tree(tree));
+    if (index == CACHE_NONE)
+    {
+        misses++;
+        return false;
+    }
+
+    hits++;
+    lru_unlink(index);
+    lru_push_front(index);
+    *out = entries[index].result;
+    return true;
+}
+
+/*
+Summary: Adds result of expression, replaces least recently used result when cache is full
+Params
+    tree: Ownership is passed to cache, is freed when it is already cached
+*/
+void result_cache_insert(Node *tree, double result)
+{
+    uint64_t hash = hash_tree(tree);
+    if (find_entry(tree, hash) != CACHE_NONE)
+    {
+        free_tree(tree);
+        return;
+    }
+
+    size_t index;
+    if (count < RESULT_CACHE_CAPACITY)
+    {
+        index = count++;
+    }
+    else
+    {
+        index = lru_last;
+        lru_unlink(index);
+        bucket_unlink(index);
+        free_tree(entries[index].tree);
+    }
+
+    CacheEntry *entry = &entries[index];
+    entry->hash = hash;
+    entry->tree = tree;
+    entry->result = result;
+    entry->bucket_next = buckets[hash % NUM_BUCKETS];
+    buckets[hash % NUM_BUCKETS] = index;
+    lru_push_front(index);
+}
+
+/*
+Summary: Drops all cached results, needs to be called whenever results may change (e.g. a function is redefined)
+    Statistics are kept
+*/
+void result_cache_clear()
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        free_tree(entries[i].tree);
+    }
+    count = 0;
+    lru_first = CACHE_NONE;
+    lru_last = CACHE_NONE;
+    init_buckets();
+}
+
+ResultCacheStats result_cache_get_stats()
+{
+    return (ResultCacheStats){
+        .capacity = RESULT_CACHE_CAPACITY,
+        .count = count,
+        .hits = hits,
+        .misses = misses
+    };
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include "../../engine/tree/node.h"
+
+#define RESULT_CACHE_CAPACITY 256
+
+typedef struct {
+    size_t capacity;
+    size_t count;
+    size_t hits;
+    size_t misses;
+} ResultCacheStats;
+
+bool result_cache_lookup(const Node *tree, double *out);
+void result_cache_insert(Node *tree, double result);
+void result_cache_clear();
+ResultCacheStats result_cache_get_stats();
@@ -0,0 +1,328 @@
+#include <math.h>
+#include <float.h>
+
+#include "roots.h"
+
+// Newton steps from guess before searching for a sign change
+#define MAX_NEWTON_STEPS    50
+// Doublings of distance from guess when searching for a sign change
+#define MAX_BRACKET_STEPS   64
+// Enough to bisect any bracket down to adjacent doubles
+#define MAX_BRACKETED_STEPS 2100
+// Initial distance from guess when searching for a sign change, relative to magnitude of guess
+#define BRACKET_START       0.01
+
+typedef struct {
+    const Program *function;
+    const Program *derivative; // NULL if not available
+    RootResult *result;
+} Solver;
+
+/*
+Returns: False if program could not be evaluated at x or result is NaN
+*/
+static bool eval(Solver *solver, const Program *program, double x, double *out)
+{
+    solver->result->num_evaluations++;
+    return run_program(program, &x, out) == LISTENERERR_SUCCESS && !isnan(*out);
+}
+
+// Root is accepted when it is known up to this distance
+static double tolerance(double x)
+{
+    return 2 * DBL_EPSILON * fabs(x) + DBL_MIN;
+}
+
+static bool differ_in_sign(double a, double b)
+{
+    return (a > 0 && b < 0) || (a < 0 && b > 0);
+}
+
+static void accept(Solver *solver, double root, double value)
+{
+    solver->result->root = root;
+    solver->result->value = value;
+    solver->result->converged = true;
+}
+
+/*
+Summary: Newton's method within bracket, takes bisection step whenever Newton step leaves bracket
+    or does not shrink fast enough (like rtsafe of Numerical Recipes)
+Params
+    fa, fb: Values at bounds, differ in sign
+*/
+static void solve_bracketed(Solver *solver, double a, double fa, double b, double fb)
+{
+    // Function is negative at lo and positive at hi
+    double lo = fa < 0 ? a : b;
+    double hi = fa < 0 ? b : a;
+    double x = fabs(fa) < fabs(fb) ? a : b;
+    double fx = fabs(fa) < fabs(fb) ? fa : fb;
+    double dx = fabs(b - a);
+    double dx_old = dx;
+
+    for (size_t i = 0; i < MAX_BRACKETED_STEPS; i++)
+    {
+        if (fx == 0)
+        {
+            accept(solver, x, fx);
+            return;
+        }
+        if (fx < 0)
+        {
+            lo = x;
+        }
+        else
+        {
+            hi = x;
+        }
+
+        double next = lo + 0.5 * (hi - lo);
+        double dfx;
+        if (solver->derivative != NULL && eval(solver, solver->derivative, x, &dfx) && dfx != 0)
+        {
+            double newton = x - fx / dfx;
+            if ((newton - lo) * (newton - hi) < 0 && fabs(newton - x) < 0.5 * dx_old) next = newton;
+        }
+        dx_old = dx;
+        dx = fabs(next - x);
+
+        double f_next;
+        if (!eval(solver, solver->function, next, &f_next)) return;
+        if (dx <= tolerance(next) || fabs(hi - lo) <= tolerance(next))
+        {
+            // Keep the better one of the last two iterates
+            if (fabs(f_next) <= fabs(fx))
+            {
+                accept(solver, next, f_next);
+            }
+            else
+            {
+                accept(solver, x, fx);
+            }
+            return;
+        }
+        x = next;
+        fx = f_next;
+    }
+}
+
+/*
+Summary: Brent's method (zeroin), combines bisection, secant steps and inverse quadratic interpolation
+    and needs no derivative
+Params
+    fa, fb: Values at bounds, differ in sign
+*/
+static void solve_brent(Solver *solver, double a, double fa, double b, double fb)
+{
+    double c = a;
+    double fc = fa;
+    double d = b - a;
+    double e = d;
+
+    for (size_t i = 0; i < MAX_BRACKETED_STEPS; i++)
+    {
+        // Root is between b and c, b is the best estimate
+        if (!differ_in_sign(fb, fc))
+        {
+            c = a;
+            fc = fa;
+            d = e = b - a;
+        }
+        if (fabs(fc) < fabs(fb))
+        {
+            a = b;
+            b = c;
+            c = a;
+            fa = fb;
+            fb = fc;
+            fc = fa;
+        }
+
+        double tol = tolerance(b);
+        double m = 0.5 * (c - b);
+        if (fabs(m) <= tol || fb == 0)
+        {
+            accept(solver, b, fb);
+            return;
+        }
+
+        if (fabs(e) < tol || fabs(fa) <= fabs(fb))
+        {
+            // Bisection
+            d = e = m;
+        }
+        else
+        {
+            double s = fb / fa;
+            double p, q;
+            if (a == c)
+            {
+                // Secant step
+                p = 2 * m * s;
+                q = 1 - s;
+            }
+            else
+            {
+                // Inverse quadratic interpolation
+                double r = fb / fc;
+                q = fa / fc;
+                p = s * (2 * m * q * (q - r) - (b - a) * (r - 1));
+                q = (q - 1) * (r - 1) * (s - 1);
+            }
+            if (p > 0)
+            {
+                q = -q;
+            }
+            else
+            {
+                p = -p;
+            }
+
+            // Interpolation is only accepted when it falls within bracket and converges fast enough
+            if (2 * p < 3 * m * q - fabs(tol * q) && p < fabs(0.5 * e * q))
+            {
+                e = d;
+                d = p / q;
+            }
+            else
+            {
+                d = e = m;
+            }
+        }
+
+        a = b;
+        fa = fb;
+        b += fabs(d) > tol ? d : (m > 0 ? tol : -tol);
+        if (!eval(solver, solver->function, b, &fb)) return;
+    }
+}
+
+/*
+Summary: Refines bracket by solve_bracketed or solve_brent
+    A sign change at a pole converges too, its "root" is rejected since function does not get smaller there
+*/
+static void solve_in_bracket(Solver *solver, double a, double fa, double b, double fb)
+{
+    if (solver->derivative != NULL)
+    {
+        solve_bracketed(solver, a, fa, b, fb);
+    }
+    else
+    {
+        solve_brent(solver, a, fa, b, fb);
+    }
+    if (fabs(solver->result->value) > fmax(fabs(fa), fabs(fb))) solver->result->converged = false;
+}
+
+/*
+Summary: Searches sign change by evaluating function at increasing distances on both sides of x0
+Params
+    out_a, out_b: Bracket, values at its bounds differ in sign (or value at out_b is zero)
+*/
+static bool find_bracket(Solver *solver, double x0, double *out_a, double *out_fa, double *out_b, double *out_fb)
+{
+    // Closest points that could be evaluated on each side
+    double prev[2] = { x0, x0 };
+    double f_prev[2];
+    bool has_prev[2];
+    has_prev[0] = has_prev[1] = eval(solver, solver->function, x0, &f_prev[0]);
+    f_prev[1] = f_prev[0];
+
+    double h = BRACKET_START * (fabs(x0) > 1 ? fabs(x0) : 1);
+    for (size_t i = 0; i < MAX_BRACKET_STEPS; i++, h *= 2)
+    {
+        for (size_t side = 0; side < 2; side++)
+        {
+            double x = side == 0 ? x0 + h : x0 - h;
+            double fx;
+            if (!isfinite(x) || !eval(solver, solver->function, x, &fx)) continue;
+            if (fx == 0 || (has_prev[side] && differ_in_sign(fx, f_prev[side])))
+            {
+                *out_a = prev[side];
+                *out_fa = f_prev[side];
+                *out_b = x;
+                *out_fb = fx;
+                return true;
+            }
+            prev[side] = x;
+            f_prev[side] = fx;
+            has_prev[side] = true;
+        }
+    }
+    return false;
+}
+
+/*
+Summary: Searches root of function near x0, by Newton's method when derivative is given and by Brent's method otherwise
+    Newton steps are taken from x0 until they converge or the function changes its sign,
+    a bracket of the root is then refined by bisection-safeguarded Newton steps
+    When Newton steps do not lead to a sign change, one is searched around x0
+Params
+    function:   Program with one variable slot
+    derivative: Program that computes derivative of function, can be NULL
+Returns: Root when converged is set, best estimate otherwise
+*/
+RootResult find_root(const Program *function, const Program *derivative, double x0)
+{
+    RootResult result = { .root = x0, .value = NAN, .num_evaluations = 0, .converged = false };
+    Solver solver = { function, derivative, &result };
+
+    double fx;
+    bool valid = eval(&solver, function, x0, &fx);
+    if (valid)
+    {
+        result.value = fx;
+        if (fx == 0)
+        {
+            accept(&solver, x0, fx);
+            return result;
+        }
+    }
+
+    if (valid && derivative != NULL)
+    {
+        double x = x0;
+        for (size_t i = 0; i < MAX_NEWTON_STEPS; i++)
+        {
+            double dfx;
+            double next;
+            double f_next;
+            if (!eval(&solver, derivative, x, &dfx) || dfx == 0) break;
+            next = x - fx / dfx;
+            if (!isfinite(next) || !eval(&solver, function, next, &f_next)) break;
+
+            if (fabs(f_next) < fabs(result.value))
+            {
+                result.root = next;
+                result.value = f_next;
+            }
+            if (differ_in_sign(fx, f_next))
+            {
+                solve_in_bracket(&solver, x, fx, next, f_next);
+                return result;
+            }
+            if (f_next == 0 || fabs(next - x) <= tolerance(next))
+            {
+                accept(&solver, next, f_next);
+                return result;
+            }
+            x = next;
+            fx = f_next;
+        }
+    }
+
+    double a, fa, b, fb;
+    if (find_bracket(&solver, x0, &a, &fa, &b, &fb))
+    {
+        if (fb == 0)
+        {
+            accept(&solver, b, fb);
+        }
+        else
+        {
+            solve_in_bracket(&solver, a, fa, b, fb);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include "bytecode.h"
+
+/*
+Root of a function of one variable, found by Newton's method safeguarded by bisection
+or by Brent's method when no derivative is available.
+Both start from an initial guess and search for a sign change around it when the guess does not converge.
+*/
+typedef struct {
+    double root;
+    double value;           // Value of function at root
+    size_t num_evaluations; // Evaluations of function and derivative
+    bool converged;         // False if root is only best estimate
+} RootResult;
+
+RootResult find_root(const Program *function, const Program *derivative, double x0);
@@ -0,0 +1,160 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include "../../util/alloc_wrappers.h"
+#include "../../util/parallel.h"
+#include "series.h"
+
+// Minimum number of terms that are summed by a worker at once
+#define CHUNK_SIZE 4096
+// Upper limit for number of chunks, chunks of long series are larger
+#define MAX_CHUNKS 4096
+// Number of terms that are evaluated column-at-a-time
+#define BLOCK_SIZE  256
+
+typedef struct {
+    double sum;
+    double comp; // Accumulated rounding errors of sum
+} Accumulator;
+
+// State of summation that is shared by workers
+typedef struct {
+    const Program *program;
+    double from;
+    size_t num_terms;
+    size_t chunk_size;
+    Accumulator *partial_sums; // Per chunk
+    size_t *first_errors;      // Per chunk: index of first erroneous term, num_terms if there is none
+    ListenerError *errors;     // Per chunk: error of that term
+} SeriesJob;
+
+static void accumulate(Accumulator *acc, double x)
+{
+    double t = acc->sum + x;
+    // Unlike Kahan's algorithm, this also compensates when x is larger than sum
+    if (fabs(acc->sum) >= fabs(x))
+    {
+        acc->comp += (acc->sum - t) + x;
+    }
+    else
+    {
+        acc->comp += (x - t) + acc->sum;
+    }
+    acc->sum = t;
+}
+
+static double get_sum(const Accumulator *acc)
+{
+    // Compensation is meaningless when sum is not finite
+    return isfinite(acc->sum) ? acc->sum + acc->comp : acc->sum;
+}
+
+/*
+Summary: Evaluates and sums terms of chunk, runs on worker thread
+*/
+static void series_work(size_t chunk_index, void *context)
+{
+    SeriesJob *job = (SeriesJob*)context;
+    size_t start = chunk_index * job->chunk_size;
+    size_t end = start + job->chunk_size < job->num_terms ? start + job->chunk_size : job->num_terms;
+
+    Accumulator acc = { 0, 0 };
+    double values[BLOCK_SIZE];
+    double results[BLOCK_SIZE];
+    ListenerError errors[BLOCK_SIZE];
+    const double *columns[] = { values };
+    job->first_errors[chunk_index] = job->num_terms;
+
+    for (size_t i = start; i < end; i += BLOCK_SIZE)
+    {
+        size_t num_rows = end - i < BLOCK_SIZE ? end - i : BLOCK_SIZE;
+        for (size_t j = 0; j < num_rows; j++)
+        {
+            values[j] = job->from + (double)(i + j);
+        }
+
+        // Terms that call rand are evaluated in order
+        if (job->program->has_side_effects)
+        {
+            for (size_t j = 0; j < num_rows; j++)
+            {
+                errors[j] = run_program(job->program, values + j, results + j);
+            }
+        }
+        else
+        {
+            run_program_batch(job->program, num_rows, columns, results, errors);
+        }
+
+        for (size_t j = 0; j < num_rows; j++)
+        {
+            if (errors[j] != LISTENERERR_SUCCESS)
+            {
+                job->first_errors[chunk_index] = i + j;
+                job->errors[chunk_index] = errors[j];
+                goto exit;
+            }
+            accumulate(&acc, results[j]);
+        }
+    }
+
+    exit:
+    job->partial_sums[chunk_index] = acc;
+}
+
+/*
+Returns: Number of terms of series from, from + 1, ..., to (0 if to < from), may exceed SERIES_MAX_TERMS
+*/
+double series_num_terms(double from, double to)
+{
+    if (to < from) return 0;
+    return floor(to - from) + 1;
+}
+
+/*
+Summary: Sums program over values from, from + 1, ..., to of its only variable, on all workers
+    Terms are evaluated like rows of a table, i.e. column-at-a-time unless program has side effects
+Params
+    program: Program with one variable slot
+    from:    Finite
+    to:      Finite and such that number of terms does not exceed SERIES_MAX_TERMS
+Returns: Sum of all terms, or error of first term that could not be evaluated
+*/
+SeriesResult series_sum(const Program *program, double from, double to)
+{
+    size_t num_terms = (size_t)series_num_terms(from, to);
+    size_t chunk_size = num_terms / MAX_CHUNKS >= CHUNK_SIZE ? num_terms / MAX_CHUNKS + 1 : CHUNK_SIZE;
+    size_t num_chunks = (num_terms + chunk_size - 1) / chunk_size;
+
+    SeriesJob job = {
+        .program = program,
+        .from = from,
+        .num_terms = num_terms,
+        .chunk_size = chunk_size,
+        .partial_sums = malloc_wrapper((num_chunks + 1) * sizeof(Accumulator)),
+        .first_errors = malloc_wrapper((num_chunks + 1) * sizeof(size_t)),
+        .errors = malloc_wrapper((num_chunks + 1) * sizeof(ListenerError))
+    };
+    run_chunks_ordered(num_chunks, program->has_side_effects ? 1 : get_num_workers(), series_work, NULL, &job);
+
+    // Partial sums are combined in order of chunks, so the sum is reproducible
+    SeriesResult result = { .sum = 0, .error = LISTENERERR_SUCCESS };
+    Accumulator total = { 0, 0 };
+    for (size_t i = 0; i < num_chunks; i++)
+    {
+        if (job.first_errors[i] != num_terms)
+        {
+            result.error = job.errors[i];
+            result.error_index = (double)job.first_errors[i];
+            break;
+        }
+        accumulate(&total, job.partial_sums[i].sum);
+        total.comp += job.partial_sums[i].comp;
+    }
+    if (result.error == LISTENERERR_SUCCESS) result.sum = get_sum(&total);
+
+    free(job.partial_sums);
+    free(job.first_errors);
+    free(job.errors);
+    return result;
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <stddef.h>
+#include "bytecode.h"
+
+// Largest number of terms of a series, indices beyond are not exactly representable anymore
+#define SERIES_MAX_TERMS 9007199254740992.0 // 2^53
+
+/*
+Sum of a series, terms are summed by compensated (Kahan-Babuska-Neumaier) summation.
+The terms are split into chunks that only depend on the number of terms,
+thus the sum does not depend on the number of worker threads.
+*/
+typedef struct {
+    double sum;
+    ListenerError error;   // Error of first term that could not be evaluated
+    double error_index;    // Index of that term, only set when error is not LISTENERERR_SUCCESS
+} SeriesResult;
+
+double series_num_terms(double from, double to);
+SeriesResult series_sum(const Program *program, double from, double to);
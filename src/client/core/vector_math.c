@@ -0,0 +1,312 @@
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <pthread.h>
+
+#include "vector_math.h"
+
+/*
+SIMD kernels are generated from vector_math_template.h for SSE2 and AVX2.
+On other architectures or compilers (or when compiled with NO_SIMD), libm is always used.
+*/
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__) && !defined(NO_SIMD)
+#define VMATH_X86
+#include <immintrin.h>
+#endif
+
+static pthread_once_t detect_once = PTHREAD_ONCE_INIT;
+static VmathLevel supported_level = VMATH_SCALAR;
+static VmathLevel selected_level = VMATH_SCALAR;
+
+typedef struct {
+    void (*exp)(size_t n, const double *x, double *out);
+    void (*ln)(size_t n, const double *x, double *out);
+    void (*sin)(size_t n, const double *x, double *out);
+    void (*cos)(size_t n, const double *x, double *out);
+    void (*atan)(size_t n, const double *x, double *out);
+    void (*pow)(size_t n, const double *x, const double *y, double *out);
+} VmathKernels;
+
+static void exp_scalar(size_t n, const double *x, double *out)
+{
+    for (size_t i = 0; i < n; i++) out[i] = exp(x[i]);
+}
+
+static void ln_scalar(size_t n, const double *x, double *out)
+{
+    for (size_t i = 0; i < n; i++) out[i] = log(x[i]);
+}
+
+static void sin_scalar(size_t n, const double *x, double *out)
+{
+    for (size_t i = 0; i < n; i++) out[i] = sin(x[i]);
+}
+
+static void cos_scalar(size_t n, const double *x, double *out)
+{
+    for (size_t i = 0; i < n; i++) out[i] = cos(x[i]);
+}
+
+static void atan_scalar(size_t n, const double *x, double *out)
+{
+    for (size_t i = 0; i < n; i++) out[i] = atan(x[i]);
+}
+
+static void pow_scalar(size_t n, const double *x, const double *y, double *out)
+{
+    for (size_t i = 0; i < n; i++) out[i] = pow(x[i], y[i]);
+}
+
+#ifdef VMATH_X86
+
+// Adding SHIFTER rounds to an integer that is held in the lowest bits of the sum
+#define SHIFTER            0x1.8p52
+#define TWO_POW_52_BITS    0x4330000000000000LL
+#define ONE_BITS           0x3FF0000000000000LL
+#define MANTISSA_MASK      0x000FFFFFFFFFFFFFLL
+#define EXP_LIMIT          708.0
+#define TRIG_LIMIT         1e5
+#define POW_EXPONENT_LIMIT 64.0
+#define SQRT2              1.41421356237309504880
+
+#define INV_LN2 1.44269504088896338700e+00
+#define LN2_HI  6.93147180369123816490e-01
+#define LN2_LO  1.90821492927058770002e-10
+#define EXP_P1  1.66666666666666019037e-01
+#define EXP_P2 -2.77777777770155933842e-03
+#define EXP_P3  6.61375632143793436117e-05
+#define EXP_P4 -1.65339022054652515390e-06
+#define EXP_P5  4.13813679705723846039e-08
+
+#define LG1 6.666666666666735130e-01
+#define LG2 3.999999999940941908e-01
+#define LG3 2.857142874366239149e-01
+#define LG4 2.222219843214978396e-01
+#define LG5 1.818357216161805012e-01
+#define LG6 1.531383769920937332e-01
+#define LG7 1.479819860511658591e-01
+
+// pi/2 = PIO2_1 + PIO2_2 + PIO2_3 + PIO2_3T, first three parts have 33 bits
+#define INV_PIO2 6.36619772367581382433e-01
+#define PIO2_1   1.57079632673412561417e+00
+#define PIO2_2   6.07710050630396597660e-11
+#define PIO2_3   2.02226624871116645580e-21
+#define PIO2_3T  8.47842766036889956997e-32
+
+#define SIN_S1 -1.66666666666666324348e-01
+#define SIN_S2  8.33333333332248946124e-03
+#define SIN_S3 -1.98412698298579493134e-04
+#define SIN_S4  2.75573137070700676789e-06
+#define SIN_S5 -2.50507602534068634195e-08
+#define SIN_S6  1.58969099521155010221e-10
+#define COS_C1  4.16666666666666019037e-02
+#define COS_C2 -1.38888888888741095749e-03
+#define COS_C3  2.48015872894767294178e-05
+#define COS_C4 -2.75573143513906633035e-07
+#define COS_C5  2.08757232129817482790e-09
+#define COS_C6 -1.13596475577881948265e-11
+
+#define ATAN_HI0  4.63647609000806093515e-01
+#define ATAN_HI1  7.85398163397448278999e-01
+#define ATAN_HI2  9.82793723247329054082e-01
+#define ATAN_HI3  1.57079632679489655800e+00
+#define ATAN_LO0  2.26987774529616870924e-17
+#define ATAN_LO1  3.06161699786838301793e-17
+#define ATAN_LO2  1.39033110312309984516e-17
+#define ATAN_LO3  6.12323399573676603587e-17
+#define ATAN_T0   3.33333333333329318027e-01
+#define ATAN_T1  -1.99999999998764832476e-01
+#define ATAN_T2   1.42857142725034663711e-01
+#define ATAN_T3  -1.11111104054623557880e-01
+#define ATAN_T4   9.09088713343650656196e-02
+#define ATAN_T5  -7.69187620504482999495e-02
+#define ATAN_T6   6.66107313738753120669e-02
+#define ATAN_T7  -5.83357013379057348645e-02
+#define ATAN_T8   4.97687799461593236017e-02
+#define ATAN_T9  -3.65315727442169155270e-02
+#define ATAN_T10  1.62858201153657823623e-02
+
+// SSE2, part of every x86-64 processor, has no fused multiply-add
+// Without it, the kernels of atan and pow measured slower than libm and are not generated
+
+#define VD           __m128d
+#define VI           __m128i
+#define LANES        2
+#define VFN(f)       f##_sse2
+#define V_LOADU      _mm_loadu_pd
+#define V_STOREU     _mm_storeu_pd
+#define V_SET1       _mm_set1_pd
+#define V_ADD        _mm_add_pd
+#define V_SUB        _mm_sub_pd
+#define V_MUL        _mm_mul_pd
+#define V_DIV        _mm_div_pd
+#define V_FMA(a, b, c) _mm_add_pd(_mm_mul_pd(a, b), c)
+#define V_AND        _mm_and_pd
+#define V_OR         _mm_or_pd
+#define V_XOR        _mm_xor_pd
+#define V_ANDNOT     _mm_andnot_pd
+#define V_GT         _mm_cmpgt_pd
+#define V_GE         _mm_cmpge_pd
+#define V_LE         _mm_cmple_pd
+#define V_NLE        _mm_cmpnle_pd
+#define V_MOVEMASK   _mm_movemask_pd
+#define V_CASTI      _mm_castpd_si128
+#define V_CASTD      _mm_castsi128_pd
+#define I_ADD64      _mm_add_epi64
+#define I_SUB64      _mm_sub_epi64
+#define I_AND        _mm_and_si128
+#define I_OR         _mm_or_si128
+#define I_SLL64      _mm_slli_epi64
+#define I_SRL64      _mm_srli_epi64
+#define I_SET1_64    _mm_set1_epi64x
+
+#include "vector_math_template.h"
+
+#undef VD
+#undef VI
+#undef LANES
+#undef VFN
+#undef V_LOADU
+#undef V_STOREU
+#undef V_SET1
+#undef V_ADD
+#undef V_SUB
+#undef V_MUL
+#undef V_DIV
+#undef V_FMA
+#undef V_AND
+#undef V_OR
+#undef V_XOR
+#undef V_ANDNOT
+#undef V_GT
+#undef V_GE
+#undef V_LE
+#undef V_NLE
+#undef V_MOVEMASK
+#undef V_CASTI
+#undef V_CASTD
+#undef I_ADD64
+#undef I_SUB64
+#undef I_AND
+#undef I_OR
+#undef I_SLL64
+#undef I_SRL64
+#undef I_SET1_64
+
+// AVX2 with FMA, only called after checking support at runtime
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+
+#define VD           __m256d
+#define VI           __m256i
+#define LANES        4
+#define VFN(f)       f##_avx2
+#define V_LOADU      _mm256_loadu_pd
+#define V_STOREU     _mm256_storeu_pd
+#define V_SET1       _mm256_set1_pd
+#define V_ADD        _mm256_add_pd
+#define V_SUB        _mm256_sub_pd
+#define V_MUL        _mm256_mul_pd
+#define V_DIV        _mm256_div_pd
+#define V_FMA        _mm256_fmadd_pd
+#define V_AND        _mm256_and_pd
+#define V_OR         _mm256_or_pd
+#define V_XOR        _mm256_xor_pd
+#define V_ANDNOT     _mm256_andnot_pd
+#define V_GT(a, b)   _mm256_cmp_pd(a, b, _CMP_GT_OQ)
+#define V_GE(a, b)   _mm256_cmp_pd(a, b, _CMP_GE_OQ)
+#define V_LE(a, b)   _mm256_cmp_pd(a, b, _CMP_LE_OQ)
+#define V_NLE(a, b)  _mm256_cmp_pd(a, b, _CMP_NLE_UQ)
+#define V_MOVEMASK   _mm256_movemask_pd
+#define V_CASTI      _mm256_castpd_si256
+#define V_CASTD      _mm256_castsi256_pd
+#define I_ADD64      _mm256_add_epi64
+#define I_SUB64      _mm256_sub_epi64
+#define I_AND        _mm256_and_si256
+#define I_OR         _mm256_or_si256
+#define I_SLL64      _mm256_slli_epi64
+#define I_SRL64      _mm256_srli_epi64
+#define I_SET1_64    _mm256_set1_epi64x
+
+#define V_NATIVE_FMA
+
+static __m256d two_prod_err_avx2(__m256d a, __m256d b, __m256d p)
+{
+    return _mm256_fmsub_pd(a, b, p);
+}
+
+#include "vector_math_template.h"
+
+#pragma GCC pop_options
+
+static const VmathKernels kernels[] = {
+    { exp_scalar, ln_scalar, sin_scalar, cos_scalar, atan_scalar, pow_scalar },
+    { exp_sse2, ln_sse2, sin_sse2, cos_sse2, atan_scalar, pow_scalar },
+    { exp_avx2, ln_avx2, sin_avx2, cos_avx2, atan_avx2, pow_avx2 }
+};
+
+static void detect_level()
+{
+    __builtin_cpu_init();
+    supported_level = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") ? VMATH_AVX2 : VMATH_SSE2;
+    selected_level = supported_level;
+}
+
+#else
+
+static const VmathKernels kernels[] = {
+    { exp_scalar, ln_scalar, sin_scalar, cos_scalar, atan_scalar, pow_scalar }
+};
+
+static void detect_level() { }
+
+#endif
+
+VmathLevel vmath_get_level()
+{
+    pthread_once(&detect_once, detect_level);
+    return selected_level;
+}
+
+/*
+Summary: Selects instruction set of kernels, levels that are not supported by the processor are lowered
+    Should not be called while other threads use kernels
+Returns: Previous level
+*/
+VmathLevel vmath_set_level(VmathLevel level)
+{
+    VmathLevel res = vmath_get_level();
+    selected_level = level > supported_level ? supported_level : level;
+    return res;
+}
+
+void vmath_exp(size_t n, const double *x, double *out)
+{
+    kernels[vmath_get_level()].exp(n, x, out);
+}
+
+void vmath_ln(size_t n, const double *x, double *out)
+{
+    kernels[vmath_get_level()].ln(n, x, out);
+}
+
+void vmath_sin(size_t n, const double *x, double *out)
+{
+    kernels[vmath_get_level()].sin(n, x, out);
+}
+
+void vmath_cos(size_t n, const double *x, double *out)
+{
+    kernels[vmath_get_level()].cos(n, x, out);
+}
+
+void vmath_atan(size_t n, const double *x, double *out)
+{
+    kernels[vmath_get_level()].atan(n, x, out);
+}
+
+void vmath_pow(size_t n, const double *x, const double *y, double *out)
+{
+    kernels[vmath_get_level()].pow(n, x, y, out);
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <stddef.h>
+
+/*
+Transcendental functions over arrays, computed by SIMD kernels on x86-64 and by libm otherwise.
+The instruction set is selected at runtime, AVX2 (with FMA) is preferred over SSE2.
+Only exp, ln, sin, cos, atan and pow have kernels, other built-ins such as tan, asin or sinh call libm per element.
+SSE2 has no kernels for atan and pow since they are slower than libm without FMA, libm is used instead.
+Output arrays may be the same as input arrays.
+
+Error bounds of SIMD kernels, in ulp relative to libm:
+    exp, ln, sin, cos, atan: 1
+    pow:                     8
+Arguments that kernels do not cover are passed to libm, thus their results are the same as those of libm:
+    exp:      |x| > 708 or NaN
+    ln:       x not a positive normal number or infinity
+    sin, cos: |x| > 1e5 or NaN or infinity
+    atan:     NaN or infinity
+    pow:      x not a positive normal number or infinity, |y| > 64 or NaN, results beyond exp range
+*/
+
+typedef enum {
+    VMATH_SCALAR, // libm
+    VMATH_SSE2,
+    VMATH_AVX2
+} VmathLevel;
+
+VmathLevel vmath_get_level();
+VmathLevel vmath_set_level(VmathLevel level);
+void vmath_exp(size_t n, const double *x, double *out);
+void vmath_ln(size_t n, const double *x, double *out);
+void vmath_sin(size_t n, const double *x, double *out);
+void vmath_cos(size_t n, const double *x, double *out);
+void vmath_atan(size_t n, const double *x, double *out);
+void vmath_pow(size_t n, const double *x, const double *y, double *out);
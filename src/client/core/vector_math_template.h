@@ -0,0 +1,397 @@
+/*
+Kernels of vector_math.c, included once per instruction set. Expects:
+    VD, VI:   Vector types of doubles and of 64-bit integers
+    LANES:    Number of doubles per vector
+    VFN(f):   Name of f for this instruction set
+    V_*, I_*: Operations on VD and VI, V_FMA(a, b, c) is a * b + c
+    V_NATIVE_FMA: Defined if V_FMA is fused, atan and pow are only generated then
+    VFN(two_prod_err)(a, b, p): Rounding error of p = a * b, only needed with V_NATIVE_FMA
+
+The algorithms and coefficients are those of fdlibm (Sun Microsystems), rewritten without branches.
+*/
+
+#define V_ZERO            V_SET1(0.0)
+#define V_ABS(x)          V_ANDNOT(V_SET1(-0.0), x)
+#define V_SELECT(m, a, b) V_OR(V_AND(m, a), V_ANDNOT(m, b))
+
+// Error of s = a + b
+static VD VFN(two_sum_err)(VD a, VD b, VD s)
+{
+    VD bb = V_SUB(s, a);
+    return V_ADD(V_SUB(a, V_SUB(s, bb)), V_SUB(b, bb));
+}
+
+/*
+Summary: Computes exp(x) * (1 + corr) for |x| <= EXP_LIMIT
+    x is reduced to r = x - k * ln(2) with |r| <= ln(2) / 2, exp(r) is approximated by a rational function
+*/
+static VD VFN(exp_core)(VD x, VD corr)
+{
+    // Lowest bits of shifted hold k
+    VD shifted = V_FMA(x, V_SET1(INV_LN2), V_SET1(SHIFTER));
+    VD k = V_SUB(shifted, V_SET1(SHIFTER));
+    VD hi = V_SUB(x, V_MUL(k, V_SET1(LN2_HI)));
+    VD lo = V_MUL(k, V_SET1(LN2_LO));
+    VD r = V_SUB(hi, lo);
+    VD t = V_MUL(r, r);
+    VD poly = V_FMA(t, V_SET1(EXP_P5), V_SET1(EXP_P4));
+    poly = V_FMA(t, poly, V_SET1(EXP_P3));
+    poly = V_FMA(t, poly, V_SET1(EXP_P2));
+    poly = V_FMA(t, poly, V_SET1(EXP_P1));
+    VD c = V_SUB(r, V_MUL(t, poly));
+    VD y = V_SUB(V_SET1(1.0), V_SUB(V_SUB(lo, V_DIV(V_MUL(r, c), V_SUB(V_SET1(2.0), c))), hi));
+    y = V_FMA(y, corr, y);
+
+    // 2^k is built from its exponent bits
+    VD scale = V_CASTD(I_SLL64(I_ADD64(V_CASTI(shifted), I_SET1_64(1023)), 52));
+    return V_MUL(y, scale);
+}
+
+/*
+Summary: Splits positive normal x into x = 2^k * (1 + f) with sqrt(2)/2 <= 1 + f < sqrt(2)
+*/
+static void VFN(log_reduce)(VD x, VD *out_k, VD *out_f)
+{
+    VI bits = V_CASTI(x);
+    // Biased exponent is converted to double by placing it in the mantissa of 2^52
+    VD k = V_SUB(V_CASTD(I_OR(I_SRL64(bits, 52), I_SET1_64(TWO_POW_52_BITS))), V_SET1(0x1p52 + 1023));
+    VD m = V_CASTD(I_OR(I_AND(bits, I_SET1_64(MANTISSA_MASK)), I_SET1_64(ONE_BITS)));
+    VD big = V_GT(m, V_SET1(SQRT2));
+    *out_k = V_ADD(k, V_AND(big, V_SET1(1.0)));
+    *out_f = V_SUB(V_SELECT(big, V_MUL(m, V_SET1(0.5)), m), V_SET1(1.0));
+}
+
+// Computes R(s^2) of log(1 + f) = 2s + s * R(s^2) with s = f / (2 + f)
+static VD VFN(log_poly)(VD s)
+{
+    VD z = V_MUL(s, s);
+    VD w = V_MUL(z, z);
+    VD t1 = V_FMA(w, V_SET1(LG6), V_SET1(LG4));
+    t1 = V_FMA(w, t1, V_SET1(LG2));
+    t1 = V_MUL(w, t1);
+    VD t2 = V_FMA(w, V_SET1(LG7), V_SET1(LG5));
+    t2 = V_FMA(w, t2, V_SET1(LG3));
+    t2 = V_FMA(w, t2, V_SET1(LG1));
+    return V_FMA(z, t2, t1);
+}
+
+// Natural logarithm of positive normal x
+static VD VFN(log_core)(VD x)
+{
+    VD k, f;
+    VFN(log_reduce)(x, &k, &f);
+    VD s = V_DIV(f, V_ADD(V_SET1(2.0), f));
+    VD hfsq = V_MUL(V_MUL(V_SET1(0.5), f), f);
+    VD inner = V_FMA(s, V_ADD(hfsq, VFN(log_poly)(s)), V_MUL(k, V_SET1(LN2_LO)));
+    return V_SUB(V_MUL(k, V_SET1(LN2_HI)), V_SUB(V_SUB(hfsq, inner), f));
+}
+
+#ifdef V_NATIVE_FMA
+
+/*
+Summary: Natural logarithm of positive normal x as unevaluated sum hi + lo,
+    the leading terms k * ln(2) + f - f^2 / 2 are summed without rounding errors
+*/
+static VD VFN(log_dd)(VD x, VD *out_lo)
+{
+    VD k, f;
+    VFN(log_reduce)(x, &k, &f);
+    VD s = V_DIV(f, V_ADD(V_SET1(2.0), f));
+    VD half_f = V_MUL(V_SET1(0.5), f);
+    VD hfsq = V_MUL(half_f, f);
+    VD hfsq_err = VFN(two_prod_err)(half_f, f, hfsq);
+    VD corr = V_SUB(V_FMA(s, V_ADD(hfsq, VFN(log_poly)(s)), V_MUL(k, V_SET1(LN2_LO))), hfsq_err);
+
+    VD a = V_MUL(k, V_SET1(LN2_HI));
+    VD b = V_ADD(a, f);
+    VD b_err = VFN(two_sum_err)(a, f, b);
+    VD neg_hfsq = V_SUB(V_ZERO, hfsq);
+    VD c = V_ADD(b, neg_hfsq);
+    VD c_err = VFN(two_sum_err)(b, neg_hfsq, c);
+    VD lo = V_ADD(V_ADD(b_err, c_err), corr);
+    VD hi = V_ADD(c, lo);
+    *out_lo = V_ADD(V_SUB(c, hi), lo);
+    return hi;
+}
+
+#endif
+
+/*
+Summary: Reduces |x| <= TRIG_LIMIT to x - n * pi/2 = hi + lo with |hi| <= pi/4
+    pi/2 is split into four parts, products of n with the first three are exact
+Returns: Value that holds n in its lowest bits
+*/
+static VD VFN(reduce_pio2)(VD x, VD *out_hi, VD *out_lo)
+{
+    VD shifted = V_FMA(x, V_SET1(INV_PIO2), V_SET1(SHIFTER));
+    VD n = V_SUB(shifted, V_SET1(SHIFTER));
+    VD r1 = V_SUB(x, V_MUL(n, V_SET1(PIO2_1)));
+    // Subtractions keep the sign of -0
+    VD w2 = V_MUL(n, V_SET1(PIO2_2));
+    VD r2 = V_SUB(r1, w2);
+    VD e2 = VFN(two_sum_err)(r1, V_SUB(V_ZERO, w2), r2);
+    VD w3 = V_MUL(n, V_SET1(PIO2_3));
+    VD r3 = V_SUB(r2, w3);
+    VD e3 = VFN(two_sum_err)(r2, V_SUB(V_ZERO, w3), r3);
+    VD neg_tail = V_SUB(V_MUL(n, V_SET1(PIO2_3T)), V_ADD(e2, e3));
+    *out_hi = V_SUB(r3, neg_tail);
+    *out_lo = V_SUB(V_SUB(r3, *out_hi), neg_tail);
+    return shifted;
+}
+
+// sin(x + y) for |x| <= pi/4 and |y| << |x|
+static VD VFN(sin_kernel)(VD x, VD y)
+{
+    VD z = V_MUL(x, x);
+    VD v = V_MUL(z, x);
+    VD r = V_FMA(z, V_SET1(SIN_S6), V_SET1(SIN_S5));
+    r = V_FMA(z, r, V_SET1(SIN_S4));
+    r = V_FMA(z, r, V_SET1(SIN_S3));
+    r = V_FMA(z, r, V_SET1(SIN_S2));
+    // x - ((z * (y / 2 - v * r) - y) - v * S1)
+    VD inner = V_SUB(V_MUL(V_SET1(0.5), y), V_MUL(v, r));
+    return V_SUB(x, V_SUB(V_SUB(V_MUL(z, inner), y), V_MUL(v, V_SET1(SIN_S1))));
+}
+
+// cos(x + y) for |x| <= pi/4 and |y| << |x|
+static VD VFN(cos_kernel)(VD x, VD y)
+{
+    VD z = V_MUL(x, x);
+    VD w = V_MUL(z, z);
+    VD r1 = V_FMA(z, V_SET1(COS_C3), V_SET1(COS_C2));
+    r1 = V_MUL(z, V_FMA(z, r1, V_SET1(COS_C1)));
+    VD r2 = V_FMA(z, V_SET1(COS_C6), V_SET1(COS_C5));
+    r2 = V_FMA(z, r2, V_SET1(COS_C4));
+    VD r = V_FMA(V_MUL(w, w), r2, r1);
+    VD hz = V_MUL(V_SET1(0.5), z);
+    VD one_minus = V_SUB(V_SET1(1.0), hz);
+    // w + (((1 - w) - hz) + (z * r - x * y))
+    VD corr = V_SUB(V_MUL(z, r), V_MUL(x, y));
+    return V_ADD(one_minus, V_ADD(V_SUB(V_SUB(V_SET1(1.0), one_minus), hz), corr));
+}
+
+/*
+Summary: Computes sin(x + quadrant * pi/2) from reduced argument
+Params
+    shifted: Holds n of reduction in its lowest bits
+*/
+static VD VFN(sin_quadrant)(VD hi, VD lo, VD shifted, long long quadrant)
+{
+    VI n = I_ADD64(V_CASTI(shifted), I_SET1_64(quadrant));
+    // All bits set in odd quadrants, sign bit set in quadrants 2 and 3
+    VD odd = V_CASTD(I_SUB64(I_SET1_64(0), I_AND(n, I_SET1_64(1))));
+    VD sign = V_CASTD(I_SLL64(I_AND(n, I_SET1_64(2)), 62));
+    VD res = V_SELECT(odd, VFN(cos_kernel)(hi, lo), VFN(sin_kernel)(hi, lo));
+    return V_XOR(res, sign);
+}
+
+#ifdef V_NATIVE_FMA
+
+static VD VFN(atan_core)(VD x)
+{
+    VD sign = V_AND(x, V_SET1(-0.0));
+    VD a = V_ABS(x);
+
+    // Intervals of |x| with reduction (num_a * |x| + num_b) / (den_a * |x| + den_b) and atan of their offset
+    VD m0 = V_GE(a, V_SET1(0.4375));
+    VD m1 = V_GE(a, V_SET1(0.6875));
+    VD m2 = V_GE(a, V_SET1(1.1875));
+    VD m3 = V_GE(a, V_SET1(2.4375));
+    VD num_a = V_SELECT(m3, V_ZERO, V_SELECT(m1, V_SET1(1.0), V_SELECT(m0, V_SET1(2.0), V_SET1(1.0))));
+    VD num_b = V_SELECT(m2, V_SET1(-1.5), V_SELECT(m0, V_SET1(-1.0), V_ZERO));
+    num_b = V_SELECT(m3, V_SET1(-1.0), num_b);
+    VD den_a = V_SELECT(m2, V_SET1(1.5), V_SELECT(m0, V_SET1(1.0), V_ZERO));
+    den_a = V_SELECT(m3, V_SET1(1.0), den_a);
+    VD den_b = V_SELECT(m3, V_ZERO, V_SELECT(m2, V_SET1(1.0), V_SELECT(m1, V_SET1(1.0),
+        V_SELECT(m0, V_SET1(2.0), V_SET1(1.0)))));
+    VD hi = V_SELECT(m3, V_SET1(ATAN_HI3), V_SELECT(m2, V_SET1(ATAN_HI2), V_SELECT(m1, V_SET1(ATAN_HI1),
+        V_SELECT(m0, V_SET1(ATAN_HI0), V_ZERO))));
+    VD lo = V_SELECT(m3, V_SET1(ATAN_LO3), V_SELECT(m2, V_SET1(ATAN_LO2), V_SELECT(m1, V_SET1(ATAN_LO1),
+        V_SELECT(m0, V_SET1(ATAN_LO0), V_ZERO))));
+    VD t = V_DIV(V_FMA(num_a, a, num_b), V_FMA(den_a, a, den_b));
+
+    VD z = V_MUL(t, t);
+    VD w = V_MUL(z, z);
+    VD s1 = V_FMA(w, V_SET1(ATAN_T10), V_SET1(ATAN_T8));
+    s1 = V_FMA(w, s1, V_SET1(ATAN_T6));
+    s1 = V_FMA(w, s1, V_SET1(ATAN_T4));
+    s1 = V_FMA(w, s1, V_SET1(ATAN_T2));
+    s1 = V_MUL(z, V_FMA(w, s1, V_SET1(ATAN_T0)));
+    VD s2 = V_FMA(w, V_SET1(ATAN_T9), V_SET1(ATAN_T7));
+    s2 = V_FMA(w, s2, V_SET1(ATAN_T5));
+    s2 = V_FMA(w, s2, V_SET1(ATAN_T3));
+    s2 = V_MUL(w, V_FMA(w, s2, V_SET1(ATAN_T1)));
+    // hi - ((t * (s1 + s2) - lo) - t)
+    VD res = V_SUB(hi, V_SUB(V_SUB(V_MUL(t, V_ADD(s1, s2)), lo), t));
+    return V_XOR(res, sign);
+}
+
+#endif
+
+/*
+Each block function computes LANES results from in to out, which may be the same array.
+Lanes that are not covered by the kernel are recomputed by libm from the saved arguments.
+*/
+
+static void VFN(exp_block)(const double *in, double *out)
+{
+    VD x = V_LOADU(in);
+    V_STOREU(out, VFN(exp_core)(x, V_ZERO));
+    int special = V_MOVEMASK(V_NLE(V_ABS(x), V_SET1(EXP_LIMIT)));
+    if (special == 0) return;
+    double saved[LANES];
+    V_STOREU(saved, x);
+    for (size_t j = 0; j < LANES; j++)
+    {
+        if (special >> j & 1) out[j] = exp(saved[j]);
+    }
+}
+
+static void VFN(ln_block)(const double *in, double *out)
+{
+    VD x = V_LOADU(in);
+    V_STOREU(out, VFN(log_core)(x));
+    int special = V_MOVEMASK(V_AND(V_GE(x, V_SET1(DBL_MIN)), V_LE(x, V_SET1(DBL_MAX)))) ^ ((1 << LANES) - 1);
+    if (special == 0) return;
+    double saved[LANES];
+    V_STOREU(saved, x);
+    for (size_t j = 0; j < LANES; j++)
+    {
+        if (special >> j & 1) out[j] = log(saved[j]);
+    }
+}
+
+static void VFN(trig_block)(const double *in, double *out, long long quadrant)
+{
+    VD x = V_LOADU(in);
+    VD hi, lo;
+    VD shifted = VFN(reduce_pio2)(x, &hi, &lo);
+    V_STOREU(out, VFN(sin_quadrant)(hi, lo, shifted, quadrant));
+    int special = V_MOVEMASK(V_NLE(V_ABS(x), V_SET1(TRIG_LIMIT)));
+    if (special == 0) return;
+    double saved[LANES];
+    V_STOREU(saved, x);
+    for (size_t j = 0; j < LANES; j++)
+    {
+        if (special >> j & 1) out[j] = quadrant == 0 ? sin(saved[j]) : cos(saved[j]);
+    }
+}
+
+static void VFN(sin_block)(const double *in, double *out)
+{
+    VFN(trig_block)(in, out, 0);
+}
+
+// cos(x) = sin(x + pi/2)
+static void VFN(cos_block)(const double *in, double *out)
+{
+    VFN(trig_block)(in, out, 1);
+}
+
+#ifdef V_NATIVE_FMA
+
+static void VFN(atan_block)(const double *in, double *out)
+{
+    VD x = V_LOADU(in);
+    V_STOREU(out, VFN(atan_core)(x));
+    int special = V_MOVEMASK(V_NLE(V_ABS(x), V_SET1(DBL_MAX)));
+    if (special == 0) return;
+    double saved[LANES];
+    V_STOREU(saved, x);
+    for (size_t j = 0; j < LANES; j++)
+    {
+        if (special >> j & 1) out[j] = atan(saved[j]);
+    }
+}
+
+// pow(x, y) = exp(y * ln(x)), product is computed from ln(x) = hi + lo without rounding errors
+static void VFN(pow_block)(const double *in_x, const double *in_y, double *out)
+{
+    VD x = V_LOADU(in_x);
+    VD y = V_LOADU(in_y);
+    VD lo;
+    VD hi = VFN(log_dd)(x, &lo);
+    VD t = V_MUL(y, hi);
+    VD t_lo = V_FMA(y, lo, VFN(two_prod_err)(y, hi, t));
+    V_STOREU(out, VFN(exp_core)(t, t_lo));
+
+    VD covered = V_AND(V_GE(x, V_SET1(DBL_MIN)), V_LE(x, V_SET1(DBL_MAX)));
+    covered = V_AND(covered, V_LE(V_ABS(y), V_SET1(POW_EXPONENT_LIMIT)));
+    covered = V_AND(covered, V_LE(V_ABS(t), V_SET1(EXP_LIMIT)));
+    int special = V_MOVEMASK(covered) ^ ((1 << LANES) - 1);
+    if (special == 0) return;
+    double saved_x[LANES];
+    double saved_y[LANES];
+    V_STOREU(saved_x, x);
+    V_STOREU(saved_y, y);
+    for (size_t j = 0; j < LANES; j++)
+    {
+        if (special >> j & 1) out[j] = pow(saved_x[j], saved_y[j]);
+    }
+}
+
+#endif
+
+/*
+Summary: Applies block function to whole array, last partial block is padded
+*/
+static void VFN(apply1)(void (*block)(const double*, double*), size_t n, const double *x, double *out)
+{
+    size_t i = 0;
+    for (; i + LANES <= n; i += LANES) block(x + i, out + i);
+    if (i == n) return;
+
+    double in[LANES] = { 0 };
+    double res[LANES];
+    memcpy(in, x + i, (n - i) * sizeof(double));
+    block(in, res);
+    memcpy(out + i, res, (n - i) * sizeof(double));
+}
+
+static void VFN(exp)(size_t n, const double *x, double *out)
+{
+    VFN(apply1)(VFN(exp_block), n, x, out);
+}
+
+static void VFN(ln)(size_t n, const double *x, double *out)
+{
+    VFN(apply1)(VFN(ln_block), n, x, out);
+}
+
+static void VFN(sin)(size_t n, const double *x, double *out)
+{
+    VFN(apply1)(VFN(sin_block), n, x, out);
+}
+
+static void VFN(cos)(size_t n, const double *x, double *out)
+{
+    VFN(apply1)(VFN(cos_block), n, x, out);
+}
+
+#ifdef V_NATIVE_FMA
+
+static void VFN(atan)(size_t n, const double *x, double *out)
+{
+    VFN(apply1)(VFN(atan_block), n, x, out);
+}
+
+static void VFN(pow)(size_t n, const double *x, const double *y, double *out)
+{
+    size_t i = 0;
+    for (; i + LANES <= n; i += LANES) VFN(pow_block)(x + i, y + i, out + i);
+    if (i == n) return;
+
+    double in_x[LANES] = { 0 };
+    double in_y[LANES] = { 0 };
+    double res[LANES];
+    memcpy(in_x, x + i, (n - i) * sizeof(double));
+    memcpy(in_y, y + i, (n - i) * sizeof(double));
+    VFN(pow_block)(in_x, in_y, res);
+    memcpy(out + i, res, (n - i) * sizeof(double));
+}
+
+#endif
+
+#undef V_ZERO
+#undef V_ABS
+#undef V_SELECT
@@ -2,9 +2,11 @@
 #include <unistd.h>
 #include <stdbool.h>
 #include <string.h>
+#include <signal.h>
 
 #include "../util/trie.h"
 #include "../util/console_util.h"
+#include "../util/governor.h"
 #include "commands/commands.h"
 #include "version.h"
 
@@ -43,6 +45,23 @@ bool *parse_arg(Trie *switches, const char *arg)
     }
 }
 
+/*
+Summary: Ctrl-C cancels running command and returns to prompt, it terminates ccalc when no command is running
+*/
+static void handle_interrupt(int signal_number)
+{
+    if (governor_cancel())
+    {
+        // Handler may have been reset on delivery
+        signal(signal_number, handle_interrupt);
+    }
+    else
+    {
+        signal(signal_number, SIG_DFL);
+        raise(signal_number);
+    }
+}
+
 int main(int argc, char **argv)
 {
     // Build trie of strings that can be used as switches
@@ -107,6 +126,7 @@ int main(int argc, char **argv)
     // Since we know that we parse commands or enter interactive mode, build arithmetic context and initialize commands
     init_commands();
     atexit(unload_commands);
+    signal(SIGINT, handle_interrupt);
     
     // Parse supplied commands non-interactively
     if (commands_index != -1)
@@ -8,7 +8,8 @@ ParsingContext __g_propositional_ctx;
 
 void init_propositional_ctx()
 {
-    __g_propositional_ctx = get_arith_ctx();
+    // Overlay built-in arithmetic operators instead of building them again
+    __g_propositional_ctx = ctx_create_child(g_builtin_ctx);
     if (!ctx_add_ops(g_propositional_ctx, NUM_PROPOSITIONAL_OPS,
         op_get_function("type", 1),
         op_get_function("equal", 2),
@@ -3,6 +3,7 @@
 
 #include "../core/arith_context.h"
 #include "../core/arith_evaluation.h"
+#include "../core/plugins.h"
 #include "propositional_evaluation.h"
 #include "propositional_context.h"
 
@@ -15,7 +16,7 @@
 ListenerError prop_op_evaluate(const Operator *op, size_t num_args, const double *args, double *out)
 {
     // Propositional context is an extension of the arithmetic context
-    if (op->id < NUM_ARITH_OPS) return arith_op_evaluate(op, num_args, args, out);
+    if (op->id < NUM_ARITH_OPS || is_plugin_op(op) || get_composite_function(op) != NULL) return arith_op_evaluate(op, num_args, args, out);
 
     switch (op->id)
     {
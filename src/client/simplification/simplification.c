@@ -9,10 +9,12 @@
 #include "../../engine/transformation/rule_parsing.h"
 #include "../../engine/parsing/parser.h"
 #include "../../util/console_util.h"
+#include "../../util/governor.h"
 #include "../../util/linked_list.h"
 
 #include "../core/arith_context.h"
 #include "../core/arith_evaluation.h"
+#include "../core/bytecode.h"
 #include "simplification.h"
 #include "propositional_context.h"
 #include "propositional_evaluation.h"
@@ -33,9 +35,6 @@ Rulesets: 1. Elimination
 bool initialized = false;
 Vector rulesets[NUM_RULESETS];
 
-Pattern deriv_before;
-Node *deriv_after;
-Pattern malformed_deriv;
 
 bool simplification_is_initialized()
 {
@@ -93,10 +92,6 @@ ssize_t init_simplification(const char *ruleset_path)
     }
     fclose(ruleset_file);
 
-    get_pattern(P("x'"), 0, NULL, &deriv_before);
-    deriv_after = P("deriv(x, z)");
-    parse_pattern("deriv(x, y) WHERE type(y) != VAR", g_propositional_ctx, &malformed_deriv);
-
     initialized = true;
 
     ssize_t res = 0;
@@ -110,9 +105,6 @@ ssize_t init_simplification(const char *ruleset_path)
 void unload_simplification()
 {
     if (!initialized) return;
-    free_pattern(&deriv_before);
-    free_tree(deriv_after);
-    free_pattern(&malformed_deriv);
     for (size_t i = 0; i < NUM_RULESETS; i++)
     {
         free_ruleset(&rulesets[i]);
@@ -131,50 +123,63 @@ static void apply_simplification(Node **tree, Vector *ruleset)
     replace_negative_consts(tree);
 }
 
-ListenerError apply_derivatives(Node **tree, const Node **errnode)
+/*
+Summary: Transforms shorthand derivatives x' to deriv(x, var) and checks that derivatives are well-formed
+    Needs no ruleset, so that derivatives can also be evaluated numerically without it
+Params
+    errnode: Node in which error occurred
+*/
+ListenerError normalize_derivatives(Node **tree, const Node **errnode)
 {
-    Matching matching;
-    Node **matched;
-    // Transform shorthand derivative to deriv(expr, x)
-    while ((matched = find_matching((const Node**)tree, &deriv_before, NULL, &matching)) != NULL)
+    if (get_type(*tree) != NTYPE_OPERATOR) return LISTENERERR_SUCCESS;
+
+    if (get_op(*tree)->id == 2) // x'
     {
         // Check if there is more than one variable in within derivative shorthand
         const char *vars[2];
-        size_t var_count = list_variables(*matched, 2, vars, NULL);
+        size_t var_count = list_variables(*tree, 2, vars, NULL);
         if (var_count > 1)
         {
-            if (errnode != NULL) *errnode = *matched;
+            if (errnode != NULL) *errnode = *tree;
             return LISTENERERR_MALFORMED_DERIV_A;
         }
 
-        Node *replacement = tree_copy(deriv_after);
-        set_token_index(replacement, get_token_index(*matched));
-
-        if (var_count == 1)
-        {
-            tree_replace(get_child_addr(replacement, 1), malloc_variable_node(vars[0], 0, 0));
-        }
-
-        tree_replace(get_child_addr(replacement, 0), tree_copy(matching.mapped_nodes[0].nodes[0]));
-        tree_replace(matched, replacement);
+        Node *replacement = malloc_operator_node(ctx_lookup_op(g_ctx, "deriv", OP_PLACE_FUNCTION), 2,
+            get_token_index(*tree));
+        set_child(replacement, 0, tree_copy(get_child(*tree, 0)));
+        set_child(replacement, 1, malloc_variable_node(var_count == 1 ? vars[0] : "z", 0, 0));
+        tree_replace(tree, replacement);
     }
 
-    // Check for deriv(x, y) WHERE !(type(y) == VAR)
-    if ((matched = find_matching((const Node**)tree, &malformed_deriv, propositional_checker, &matching)) != NULL)
+    if (get_op(*tree)->id == 3 && get_type(get_child(*tree, 1)) != NTYPE_VARIABLE) // deriv(x, y)
     {
-        if (errnode != NULL) *errnode = *matched;
+        if (errnode != NULL) *errnode = *tree;
         return LISTENERERR_MALFORMED_DERIV_B;
     }
 
+    for (size_t i = 0; i < get_num_children(*tree); i++)
+    {
+        ListenerError res = normalize_derivatives(get_child_addr(*tree, i), errnode);
+        if (res != LISTENERERR_SUCCESS) return res;
+    }
+    return LISTENERERR_SUCCESS;
+}
+
+ListenerError apply_derivatives(Node **tree, const Node **errnode)
+{
+    ListenerError res = normalize_derivatives(tree, errnode);
+    if (res != LISTENERERR_SUCCESS) return res;
+
     apply_simplification(tree, rulesets + 1);
 
     // If the tree still contains deriv-operators, the user attempted to derivate 
     // a subtree for which no reduction rule exists.
-    Node **unresolved_derivation = find_op((const Node**)tree, get_op(deriv_after));
+    Node **unresolved_derivation = find_op((const Node**)tree, ctx_lookup_op(g_ctx, "deriv", OP_PLACE_FUNCTION));
     if (unresolved_derivation != NULL)
     {
         if (errnode != NULL) *errnode = *unresolved_derivation;
-        return LISTENERERR_IMPOSSIBLE_DERIV;
+        // Rules may just not have been applied because budget of command is exhausted
+        return governor_get_state() == BUDGET_AVAILABLE ? LISTENERERR_IMPOSSIBLE_DERIV : LISTENERERR_BUDGET_EXCEEDED;
     }
 
     return LISTENERERR_SUCCESS;
@@ -216,3 +221,32 @@ ListenerError simplify(Node **tree, const Node **errnode)
 
     return LISTENERERR_SUCCESS;
 }
+
+/*
+Summary: Like simplify, but for trees that are evaluated numerically afterwards
+    Derivatives in trees of at most one variable are kept as deriv(expr, var) when compile_program can
+    evaluate them in forward mode, so neither the derivative rules nor the ruleset are needed for them
+    Other derivatives are left to simplify, which keeps them in tree when no ruleset is loaded,
+    thus compile_program can still fail on the result
+Params
+    tree:    Tree to simplify
+    errnode: Node in which error occurred
+*/
+ListenerError simplify_for_evaluation(Node **tree, const Node **errnode)
+{
+    const char *vars[2];
+    if (list_variables(*tree, 2, vars, NULL) > 1) return simplify(tree, errnode);
+
+    ListenerError res = tree_reduce_constant_subtrees(tree, arith_op_evaluate, errnode);
+    if (res != LISTENERERR_SUCCESS) return res;
+    res = normalize_derivatives(tree, errnode);
+    if (res != LISTENERERR_SUCCESS) return res;
+
+    // Rewriting would only enlarge derivatives that are evaluated numerically
+    if (find_op((const Node**)tree, ctx_lookup_op(g_ctx, "deriv", OP_PLACE_FUNCTION)) != NULL
+        && can_compile_derivatives(*tree))
+    {
+        return LISTENERERR_SUCCESS;
+    }
+    return simplify(tree, errnode);
+}
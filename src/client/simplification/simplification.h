@@ -8,3 +8,5 @@ bool simplification_is_initialized();
 ssize_t init_simplification(const char *file);
 void unload_simplification();
 ListenerError simplify(Node **tree, const Node **errnode);
+ListenerError normalize_derivatives(Node **tree, const Node **errnode);
+ListenerError simplify_for_evaluation(Node **tree, const Node **errnode);
@@ -2,6 +2,7 @@
 #include <stdarg.h>
 #include <string.h>
 
+#include "../util/alloc_wrappers.h"
 #include "context.h"
 
 /*
@@ -11,19 +12,44 @@ Summary: This method is used to create a new ParsingContext without glue-op and
 ParsingContext ctx_create()
 {
     ParsingContext res = (ParsingContext){
+        .parent        = NULL,
         .op_list       = list_create(sizeof(Operator)),
         .keywords_trie = trie_create(0),
         .glue_op       = NULL,
+        .num_hidden    = 0,
+        .next_id       = 0,
+        .num_infix_ops = { 0 },
     };
 
     for (size_t i = 0; i < OP_NUM_PLACEMENTS; i++)
     {
         res.op_tries[i] = trie_create(sizeof(ListNode*));
+        res.hidden_tries[i] = trie_create(0);
     }
 
     return res;
 }
 
+/*
+Summary: Creates a context that overlays parent. Operators of parent are visible in the new context,
+    but additions and deletions only affect the new context. Glue-op is inherited.
+*/
+ParsingContext ctx_create_child(const ParsingContext *parent)
+{
+    ParsingContext res = ctx_create();
+    res.parent     = parent;
+    res.glue_op    = parent->glue_op;
+    res.num_hidden = parent->num_hidden;
+    res.next_id    = parent->next_id;
+    // Parent is read-only, thus its infix operators can be accounted for once
+    memcpy(res.num_infix_ops, parent->num_infix_ops, sizeof(res.num_infix_ops));
+    memcpy(res.infix_assocs, parent->infix_assocs, sizeof(res.infix_assocs));
+    return res;
+}
+
+/*
+Summary: Frees own operators of context, parent is not affected
+*/
 void ctx_destroy(ParsingContext *ctx)
 {
     list_destroy(&ctx->op_list);
@@ -31,6 +57,7 @@ void ctx_destroy(ParsingContext *ctx)
     for (size_t i = 0; i < OP_NUM_PLACEMENTS; i++)
     {
         trie_destroy(&ctx->op_tries[i]);
+        trie_destroy(&ctx->hidden_tries[i]);
     }
 }
 
@@ -75,24 +102,17 @@ const Operator *ctx_add_op(ParsingContext *ctx, Operator op)
     // Consistency checks
     if (op.placement == OP_PLACE_INFIX)
     {
-        ListNode *curr = ctx->op_list.first;
-        while (curr != NULL)
+        if (ctx->num_infix_ops[op.precedence] != 0
+            && ctx->infix_assocs[op.precedence] != op.assoc)
         {
-            Operator *opB = (Operator*)curr->data;
-            if (opB->placement == OP_PLACE_INFIX
-                && opB->precedence == op.precedence)
-            {                
-                if (opB->assoc != op.assoc)
-                {
-                    return NULL;
-                }
-            }
-            curr = curr->next;
+            return NULL;
         }
+        ctx->num_infix_ops[op.precedence]++;
+        ctx->infix_assocs[op.precedence] = op.assoc;
     }
     
     // Successfully passed the checks
-    op.id = list_count(&ctx->op_list);
+    op.id = ctx->next_id++;
     ListNode *list_node = list_append(&ctx->op_list, &op);
     TRIE_ADD_ELEM(&ctx->op_tries[op.placement], op.name, ListNode*, list_node);
     trie_add_str(&ctx->keywords_trie, op.name);
@@ -100,10 +120,15 @@ const Operator *ctx_add_op(ParsingContext *ctx, Operator op)
 }
 
 /*
-Summary: 
+Summary: Removes operator from context. Operators of a parent are hidden in this layer instead.
+Returns: False if no operator of given name and placement is visible in context
 */
 bool ctx_delete_op(ParsingContext *ctx, const char *name, OpPlacement placement)
 {
+    const Operator *op = ctx_lookup_op(ctx, name, placement);
+    if (op == NULL) return false;
+    if (placement == OP_PLACE_INFIX) ctx->num_infix_ops[op->precedence]--;
+
     ListNode **node = NULL;
     if (trie_contains(&ctx->op_tries[placement], name, (void**)&node))
     {
@@ -114,7 +139,10 @@ bool ctx_delete_op(ParsingContext *ctx, const char *name, OpPlacement placement)
     }
     else
     {
-        return false;
+        // Operator is owned by a parent, which is read-only
+        trie_add_str(&ctx->hidden_tries[placement], name);
+        ctx->num_hidden++;
+        return true;
     }    
 }
 
@@ -136,22 +164,62 @@ bool ctx_set_glue_op(ParsingContext *ctx, const Operator *op)
 }
 
 /*
-Summmary: Searches for operator of given name and placement
+Summmary: Searches for operator of given name and placement, falls through to parent if not found
 Returns: NULL if no operator has been found or invalid arguments given, otherwise pointer to operator in ctx->operators
 */
 const Operator *ctx_lookup_op(const ParsingContext *ctx, const char *name, OpPlacement placement)
 {
     if (ctx == NULL || name == NULL) return NULL;
 
-    // Operators are stored in a linked list, a trie is used to lookup the correct listnode
-    ListNode **node = NULL;
-    if (trie_contains(&ctx->op_tries[placement], name, (void**)&node))
+    for (const ParsingContext *layer = ctx; layer != NULL; layer = layer->parent)
     {
-        // Return pointer to payload of listnode
-        return (const Operator*)(*node)->data;
+        // Operators are stored in a linked list, a trie is used to lookup the correct listnode
+        ListNode **node = NULL;
+        if (trie_contains(&layer->op_tries[placement], name, (void**)&node))
+        {
+            // Return pointer to payload of listnode
+            return (const Operator*)(*node)->data;
+        }
+
+        // Operator of parent has been deleted in this layer
+        if (trie_contains(&layer->hidden_tries[placement], name, NULL)) return NULL;
     }
-    else
+    return NULL;
+}
+
+static bool is_visible_keyword(const ParsingContext *ctx, const char *name)
+{
+    for (size_t i = 0; i < OP_NUM_PLACEMENTS; i++)
+    {
+        if (ctx_lookup_op(ctx, name, i) != NULL) return true;
+    }
+    return false;
+}
+
+/*
+Summary: Used by tokenizer to find keywords (operator names) at the start of string
+Returns: Length of longest keyword that string begins with, 0 if there is none
+*/
+size_t ctx_lookup_keyword(const ParsingContext *ctx, const char *string)
+{
+    size_t res = 0;
+    for (const ParsingContext *layer = ctx; layer != NULL; layer = layer->parent)
+    {
+        size_t length = trie_longest_prefix(&layer->keywords_trie, string, NULL);
+        if (length > res) res = length;
+    }
+
+    // Fast path: No operator of a parent has been deleted, thus every keyword is visible
+    if (ctx->num_hidden == 0 || res == 0) return res;
+
+    // Otherwise, shorten the candidate until it is the name of a visible operator
+    char *prefix = malloc_wrapper(res + 1);
+    for (; res > 0; res--)
     {
-        return NULL;
+        memcpy(prefix, string, res);
+        prefix[res] = '\0';
+        if (is_visible_keyword(ctx, prefix)) break;
     }
+    free(prefix);
+    return res;
 }
@@ -4,18 +4,33 @@
 #include "../util/linked_list.h"
 #include "../util/trie.h"
 
-typedef struct
+/*
+Contexts can be layered: A child context overlays a read-only parent.
+It only stores its own operators and the names of parent operators it deleted,
+lookups that are not answered by the child fall through to the parent.
+A parent must outlive its children and must not be changed while it has any.
+*/
+typedef struct ParsingContext
 {
-    const Operator *glue_op;          // Points to a payload of a listnode of op_list
-    LinkedList op_list;               // List of operators (payload: Operator)
-    Trie op_tries[OP_NUM_PLACEMENTS]; // Tries for fast operator lookup (payload: *ListNode)
-    Trie keywords_trie;               // Contains all names for keyword lookup in tokenizer (no payload)
+    const struct ParsingContext *parent;   // Read-only base, NULL if context is not layered
+    const Operator *glue_op;               // Points to a payload of a listnode of op_list (of this context or a parent)
+    LinkedList op_list;                    // List of own operators (payload: Operator)
+    Trie op_tries[OP_NUM_PLACEMENTS];      // Tries for fast operator lookup (payload: *ListNode)
+    Trie hidden_tries[OP_NUM_PLACEMENTS];  // Names of operators of parent that have been deleted in this layer (no payload)
+    Trie keywords_trie;                    // Contains own names for keyword lookup in tokenizer (no payload)
+    size_t num_hidden;                     // Number of hidden operators in this and all parent layers
+    size_t next_id;                        // Id of next operator to be added, ids are unique across layers
+    // Number of visible infix operators of each precedence and their common associativity (for consistency checks)
+    size_t num_infix_ops[OP_MAX_PRECEDENCE + 1];
+    OpAssociativity infix_assocs[OP_MAX_PRECEDENCE + 1];
 } ParsingContext;
 
 ParsingContext ctx_create();
+ParsingContext ctx_create_child(const ParsingContext *parent);
 void ctx_destroy(ParsingContext *ctx);
 bool ctx_add_ops(ParsingContext *ctx, size_t count, ...);
 const Operator *ctx_add_op(ParsingContext *ctx, Operator op);
 bool ctx_delete_op(ParsingContext *ctx, const char *name, OpPlacement placement);
 bool ctx_set_glue_op(ParsingContext *ctx, const Operator *op);
 const Operator *ctx_lookup_op(const ParsingContext *ctx, const char *name, OpPlacement placement);
+size_t ctx_lookup_keyword(const ParsingContext *ctx, const char *string);
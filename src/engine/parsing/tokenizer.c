@@ -4,7 +4,6 @@
 #include <stdio.h>
 
 #include "../util/string_util.h"
-#include "../util/trie.h"
 #include "../util/alloc_wrappers.h"
 #include "tokenizer.h"
 
@@ -34,10 +33,10 @@ static void push_token(const char *input, size_t length, Vector *tokens)
 Summary: Splits input string into several tokens to be parsed
 Params:
     input:         Input string to tokenize
-    keywords_trie: Allowed to be NULL
+    ctx:           Context whose operator names are used as keywords, allowed to be NULL
     out_tokens:    Vector of pointers to malloced tokens (free with free_tokens)
 */
-void tokenize(const char *input, const Trie *keywords_trie, Vector *out_tokens)
+void tokenize(const char *input, const ParsingContext *ctx, Vector *out_tokens)
 {
     if (input == NULL) return;
 
@@ -69,9 +68,9 @@ void tokenize(const char *input, const Trie *keywords_trie, Vector *out_tokens)
         }
 
         // Did we find a keyword?
-        if (next_state != TOKSTATE_LETTER && keywords_trie != NULL) // We don't want to find keywords in strings
+        if (next_state != TOKSTATE_LETTER && ctx != NULL) // We don't want to find keywords in strings
         {
-            size_t keyword_len = trie_longest_prefix(keywords_trie, input + i, NULL);
+            size_t keyword_len = ctx_lookup_keyword(ctx, input + i);
             if (keyword_len > 0)
             {
                 push_token(input + i, keyword_len, out_tokens);
@@ -6,6 +6,7 @@
 #include "matching.h"
 #include "transformation.h"
 #include "../util/vector.h"
+#include "../util/governor.h"
 #include "../tree/tree_util.h"
 #include "../util/console_util.h"
 #include "../util/string_util.h"
@@ -95,7 +96,8 @@ static void match_parameter_lists(
     }));
 
     size_t curr_index = 0;
-    while (curr_index < vec_count(&vec_suffixes))
+    // Number of suffixes can grow polynomially in number of tree children with degree of number of lists
+    while (curr_index < vec_count(&vec_suffixes) && governor_take_matching())
     {
         // Since vec_suffixes's buffer could be realloced by any insertion, we can't store a pointer to it
         SuffixNode curr = *(SuffixNode*)vec_get(&vec_suffixes, curr_index);
@@ -213,6 +215,8 @@ static void extend_matching(
     NodeList tree_list,
     Vector *out_matchings)
 {
+    if (!governor_take_matching()) return;
+
     switch (get_type(pattern))
     {
         // 1. Check if variable is bound, if it is, check occurrence. Otherwise, bind.
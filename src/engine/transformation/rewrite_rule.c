@@ -4,6 +4,7 @@
 #include "../util/string_util.h"
 #include "../util/console_util.h"
 #include "../util/alloc_wrappers.h"
+#include "../util/governor.h"
 #include "../tree/tree_util.h"
 #include "../tree/tree_to_string.h"
 #include "rewrite_rule.h"
@@ -67,6 +68,15 @@ void set_tok_index_for_all(Node *tree, size_t index)
     }
 }
 
+static void transform_matched_subtree(Node **matched_subtree, const RewriteRule *rule, const Matching *matching)
+{
+    Node *transformed = tree_copy(rule->after);
+    // Every new node in rhs of rule emerged from root of matched subtree
+    set_tok_index_for_all(transformed, get_token_index(*matched_subtree));
+    transform_by_matching(rule->pattern.num_free_vars, rule->pattern.free_vars, matching, &transformed);
+    tree_replace(matched_subtree, transformed);
+}
+
 /*
 Summary: Tries to find matching in tree and directly transforms tree by it
 Returns: True when matching could be applied, false otherwise
@@ -80,12 +90,19 @@ bool apply_rule(Node **tree, const RewriteRule *rule, ConstraintChecker checker)
     Node **matched_subtree = find_matching((const Node**)tree, &rule->pattern, checker, &matching);
     if (matched_subtree == NULL) return false;
     // If matching is found, transform tree with it
-    Node *transformed = tree_copy(rule->after);
-    // Every new node in rhs of rule emerged from root of matched subtree
-    set_tok_index_for_all(transformed, get_token_index(*matched_subtree));
-    transform_by_matching(rule->pattern.num_free_vars, rule->pattern.free_vars, &matching, &transformed);
-    tree_replace(matched_subtree, transformed);
+    transform_matched_subtree(matched_subtree, rule, &matching);
+    return true;
+}
 
+/*
+Summary: Like apply_rule, but only tries to match the root of tree
+    Useful when caller already knows where rule is applicable
+*/
+bool apply_rule_at_root(Node **tree, const RewriteRule *rule, ConstraintChecker checker)
+{
+    Matching matching;
+    if (!get_matching((const Node**)tree, &rule->pattern, checker, &matching)) return false;
+    transform_matched_subtree(tree, rule, &matching);
     return true;
 }
 
@@ -116,7 +133,7 @@ size_t apply_ruleset(Node **tree, const Vector *ruleset, ConstraintChecker check
 
 /*
 Summary: Tries to apply rules (priorized by order) until no rule can be applied any more
-    Guarantees to terminate after MAX_RULESET_ITERATIONS rule appliances
+    Guarantees to terminate after cap rule appliances or when budget of governed command is exhausted
 */
 size_t apply_ruleset_by_iterator(Node **tree, Iterator *iterator, ConstraintChecker checker, size_t cap)
 {
@@ -127,7 +144,7 @@ size_t apply_ruleset_by_iterator(Node **tree, Iterator *iterator, ConstraintChec
     #endif
 
     size_t counter = 0;
-    while (true)
+    while (governor_take_step())
     {
         bool applied_flag = false;
         RewriteRule *curr_rule = NULL;
@@ -160,5 +177,5 @@ size_t apply_ruleset_by_iterator(Node **tree, Iterator *iterator, ConstraintChec
             }
         }
     }
-    return 0; // To make compiler happy
+    return counter;
 }
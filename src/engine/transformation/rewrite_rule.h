@@ -13,6 +13,7 @@ typedef struct
 bool get_rule(Pattern pattern, Node *after, RewriteRule *out_rule);
 void free_rule(RewriteRule *rule);
 bool apply_rule(Node **tree, const RewriteRule *rule, ConstraintChecker checker);
+bool apply_rule_at_root(Node **tree, const RewriteRule *rule, ConstraintChecker checker);
 
 Vector get_empty_ruleset();
 void add_to_ruleset(Vector *rules, RewriteRule rule);
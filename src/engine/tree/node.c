@@ -1,5 +1,6 @@
 #include <string.h>
 #include "../util/alloc_wrappers.h"
+#include "../util/governor.h"
 #include "node.h"
 
 struct Node {
@@ -36,6 +37,7 @@ Node *malloc_variable_node(const char *var_name, size_t id, size_t tok_index)
     res->base.token_index = tok_index;
     res->id = id;
     strcpy(res->var_name, var_name);
+    governor_node_allocated();
     return (Node*)res;
 }
 
@@ -45,6 +47,7 @@ Node *malloc_constant_node(double value, size_t tok_index)
     res->base.type = NTYPE_CONSTANT;
     res->base.token_index = tok_index;
     res->const_value = value;
+    governor_node_allocated();
     return (Node*)res;
 }
 
@@ -57,6 +60,7 @@ Node *malloc_operator_node(const Operator *op, size_t num_children, size_t tok_i
     res->base.token_index = tok_index;
     res->op = op;
     res->num_children = num_children;
+    governor_node_allocated();
     return (Node*)res;
 }
 
@@ -71,6 +75,7 @@ void free_tree(Node *tree)
         }
     }
     free(tree);
+    governor_node_freed();
 }
 
 NodeType get_type(const Node *node)
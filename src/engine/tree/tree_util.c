@@ -1,5 +1,6 @@
 #include <string.h>
 #include <sys/types.h>
+#include "../util/governor.h"
 #include "tree_util.h"
 #include "node.h"
 
@@ -108,6 +109,7 @@ void tree_replace_by_list(Node **parent, size_t child_to_replace, NodeList list)
                 get_child(*parent, child_to_replace + i + 1));
         }
         free(*parent);
+        governor_node_freed();
         *parent = new_parent;
     }
     else
@@ -331,7 +333,7 @@ size_t replace_variable_nodes(Node **tree, const Node *tree_to_copy, const char
 /* ~ ~ ~ ~ ~ ~ ~ ~ ~ Traversal ~ ~ ~ ~ ~ ~ ~ ~ ~ */
 
 /*
-Summary: Evaluates operator tree
+Summary: Evaluates operator tree, fails when time or nodes of governed command are exhausted
 Returns: True if reduction could be applied, i.e. no variable in tree and reduction-function did not return false
 Params
     tree:      Tree to reduce to a constant
@@ -348,6 +350,12 @@ ListenerError tree_reduce(const Node *tree, TreeListener listener, double *out,
 
         case NTYPE_OPERATOR:
         {
+            if (!governor_check_limits())
+            {
+                if (out_errnode != NULL) *out_errnode = tree;
+                return LISTENERERR_BUDGET_EXCEEDED;
+            }
+
             size_t num_args = get_num_children(tree);
             double args[MAX_CHILDREN];
 
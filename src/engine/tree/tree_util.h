@@ -3,6 +3,7 @@
 
 #define LISTENERERR_SUCCESS                0
 #define LISTENERERR_VARIABLE_ENCOUNTERED -50
+#define LISTENERERR_BUDGET_EXCEEDED      -51
 
 typedef int ListenerError;
 typedef ListenerError (*TreeListener)(const Operator *op, size_t num_children, const double *children, double *out);
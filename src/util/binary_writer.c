@@ -0,0 +1,84 @@
+#include <string.h>
+
+#include "alloc_wrappers.h"
+#include "binary_writer.h"
+
+static bool is_little_endian()
+{
+    uint16_t one = 1;
+    return *(unsigned char*)&one == 1;
+}
+
+BinaryWriter binary_writer_create(FILE *file)
+{
+    return (BinaryWriter){
+        .file = file,
+        .buffer = malloc_wrapper(BINARY_WRITER_BUFFER_SIZE),
+        .count = 0,
+        .failed = false
+    };
+}
+
+static void flush(BinaryWriter *writer)
+{
+    if (!writer->failed && fwrite(writer->buffer, 1, writer->count, writer->file) != writer->count)
+    {
+        writer->failed = true;
+    }
+    writer->count = 0;
+}
+
+void binary_write_bytes(BinaryWriter *writer, size_t num_bytes, const void *bytes)
+{
+    const unsigned char *source = bytes;
+    while (num_bytes > 0)
+    {
+        if (writer->count == BINARY_WRITER_BUFFER_SIZE) flush(writer);
+        size_t num_copied = BINARY_WRITER_BUFFER_SIZE - writer->count < num_bytes
+            ? BINARY_WRITER_BUFFER_SIZE - writer->count
+            : num_bytes;
+        memcpy(writer->buffer + writer->count, source, num_copied);
+        writer->count += num_copied;
+        source += num_copied;
+        num_bytes -= num_copied;
+    }
+}
+
+void binary_write_u64(BinaryWriter *writer, uint64_t value)
+{
+    unsigned char bytes[8];
+    for (size_t i = 0; i < 8; i++)
+    {
+        bytes[i] = (unsigned char)(value >> (8 * i));
+    }
+    binary_write_bytes(writer, 8, bytes);
+}
+
+/*
+Summary: Writes values as IEEE 754 doubles in little-endian byte order
+*/
+void binary_write_doubles(BinaryWriter *writer, size_t num_values, const double *values)
+{
+    if (is_little_endian())
+    {
+        binary_write_bytes(writer, num_values * sizeof(double), values);
+        return;
+    }
+    for (size_t i = 0; i < num_values; i++)
+    {
+        uint64_t bits;
+        memcpy(&bits, &values[i], sizeof(double));
+        binary_write_u64(writer, bits);
+    }
+}
+
+/*
+Summary: Writes remaining buffered bytes and frees buffer, file is not closed
+Returns: False if any write failed
+*/
+bool binary_writer_finish(BinaryWriter *writer)
+{
+    flush(writer);
+    free(writer->buffer);
+    return !writer->failed && fflush(writer->file) == 0;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Bytes that are collected before they are written to file at once
+#define BINARY_WRITER_BUFFER_SIZE 1048576
+
+/*
+Writes little-endian binary data through a large buffer, regardless of byte order of host.
+*/
+typedef struct {
+    FILE *file;
+    unsigned char *buffer;
+    size_t count;  // Bytes in buffer
+    bool failed;   // Set when a write failed, further writes are ignored
+} BinaryWriter;
+
+BinaryWriter binary_writer_create(FILE *file);
+void binary_write_bytes(BinaryWriter *writer, size_t num_bytes, const void *bytes);
+void binary_write_u64(BinaryWriter *writer, uint64_t value);
+void binary_write_doubles(BinaryWriter *writer, size_t num_values, const double *values);
+bool binary_writer_finish(BinaryWriter *writer);
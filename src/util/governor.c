@@ -0,0 +1,195 @@
+#define _POSIX_C_SOURCE 199309L
+#include <time.h>
+#include <signal.h>
+
+#include "governor.h"
+
+// Clock is only read every CLOCK_INTERVAL checks since reading it is comparably slow
+#define CLOCK_INTERVAL 1024
+
+static Budget budget = {
+    .max_rewrite_steps = 100000,
+    .max_matchings     = 10000000,
+    .max_seconds       = 60,
+    .max_nodes         = 10000000
+};
+
+// Set while a command is governed on any thread, can be read by signal handler
+static volatile sig_atomic_t running = 0;
+// Set by signal handler, read by all threads
+static volatile sig_atomic_t cancelled = 0;
+// Set by any thread that sees that time of command is exhausted, read by all threads
+static volatile sig_atomic_t out_of_time = 0;
+// Start of outermost command, written before any worker is started
+static struct timespec start_time;
+// Number of commands that are governed on calling thread, commands can run commands (e.g. load)
+static int depth = 0;
+
+// State of command that is governed on this thread
+static __thread bool active = false;
+static __thread BudgetState state = BUDGET_AVAILABLE;
+static __thread size_t num_steps = 0;
+static __thread size_t num_matchings = 0;
+static __thread long num_nodes = 0;
+// Clock is read by each thread on its own
+static __thread size_t num_checks = 0;
+
+void governor_set_budget(Budget new_budget)
+{
+    budget = new_budget;
+}
+
+Budget governor_get_budget()
+{
+    return budget;
+}
+
+/*
+Summary: Starts to govern a command on calling thread, resets all counters
+    Commands that are run by a governed command share its budget, only outermost call has an effect
+*/
+void governor_begin()
+{
+    if (depth++ > 0) return;
+    cancelled = 0;
+    out_of_time = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+    running = 1;
+    active = true;
+    state = BUDGET_AVAILABLE;
+    num_steps = 0;
+    num_matchings = 0;
+    num_nodes = 0;
+}
+
+/*
+Summary: Stops to govern a command, cancellation is reset when outermost command ends
+*/
+void governor_end()
+{
+    if (depth == 0 || --depth > 0) return;
+    active = false;
+    running = 0;
+    cancelled = 0;
+    out_of_time = 0;
+}
+
+static double get_elapsed_seconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start_time.tv_sec) + (now.tv_nsec - start_time.tv_nsec) / 1e9;
+}
+
+/*
+Summary: Cheap check for cancellation and time that can be called on any thread, e.g. once per evaluation
+    The clock is only read now and then, once time is exhausted this is seen by all threads
+Returns: True if command has been cancelled or its time is exhausted, evaluation should stop then
+*/
+bool governor_is_stopped()
+{
+    if (cancelled || out_of_time) return true;
+    if (!running || budget.max_seconds == 0 || ++num_checks % CLOCK_INTERVAL != 0) return false;
+    if (get_elapsed_seconds() > budget.max_seconds) out_of_time = 1;
+    return out_of_time != 0;
+}
+
+/*
+Summary: Checks for cancellation, time and nodes, nodes are only counted on thread that began command
+Returns: False if command is cancelled or time or nodes are exhausted
+*/
+bool governor_check_limits()
+{
+    if (governor_is_stopped()) return false;
+    if (!active) return true;
+    if (state == BUDGET_NODES_EXHAUSTED) return false;
+
+    if (budget.max_nodes != 0 && num_nodes > 0 && (size_t)num_nodes > budget.max_nodes)
+    {
+        state = BUDGET_NODES_EXHAUSTED;
+        return false;
+    }
+    return true;
+}
+
+/*
+Summary: Counts a round of applying rewrite rules
+Returns: False if any part of budget is exhausted, rewriting should stop then
+*/
+bool governor_take_step()
+{
+    if (!active) return true;
+    if (!governor_check_limits() || state != BUDGET_AVAILABLE) return false;
+    if (budget.max_rewrite_steps != 0 && ++num_steps > budget.max_rewrite_steps)
+    {
+        state = BUDGET_STEPS_EXHAUSTED;
+        return false;
+    }
+    return true;
+}
+
+/*
+Summary: Counts a partial matching
+Returns: False if any part of budget is exhausted, matching should stop then
+*/
+bool governor_take_matching()
+{
+    if (!active) return true;
+    if (!governor_check_limits() || state != BUDGET_AVAILABLE) return false;
+    if (budget.max_matchings != 0 && ++num_matchings > budget.max_matchings)
+    {
+        state = BUDGET_MATCHINGS_EXHAUSTED;
+        return false;
+    }
+    return true;
+}
+
+BudgetState governor_get_state()
+{
+    if (!active) return BUDGET_AVAILABLE;
+    if (cancelled) return BUDGET_CANCELLED;
+    return out_of_time ? BUDGET_TIME_EXHAUSTED : state;
+}
+
+const char *governor_state_to_str(BudgetState value)
+{
+    switch (value)
+    {
+        case BUDGET_AVAILABLE:
+            return "Budget available";
+        case BUDGET_STEPS_EXHAUSTED:
+            return "Rewrite steps exhausted";
+        case BUDGET_MATCHINGS_EXHAUSTED:
+            return "Partial matchings exhausted";
+        case BUDGET_TIME_EXHAUSTED:
+            return "Time exhausted";
+        case BUDGET_NODES_EXHAUSTED:
+            return "Nodes exhausted";
+        case BUDGET_CANCELLED:
+            return "Cancelled";
+        default:
+            return "Unknown state";
+    }
+}
+
+void governor_node_allocated()
+{
+    if (active) num_nodes++;
+}
+
+void governor_node_freed()
+{
+    if (active) num_nodes--;
+}
+
+/*
+Summary: Cancels running command, is async-signal-safe
+Returns: False if no command is running
+*/
+bool governor_cancel()
+{
+    if (!running) return false;
+    cancelled = 1;
+    return true;
+}
+
@@ -0,0 +1,44 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+Limits of resources a single command may use, 0 means unlimited.
+*/
+typedef struct {
+    size_t max_rewrite_steps; // Rounds of applying rewrite rules
+    size_t max_matchings;     // Partial matchings the matcher may try
+    double max_seconds;       // Wall-clock time since command started
+    size_t max_nodes;         // Nodes that are alive in addition to those alive when command started
+} Budget;
+
+typedef enum {
+    BUDGET_AVAILABLE,
+    BUDGET_STEPS_EXHAUSTED,
+    BUDGET_MATCHINGS_EXHAUSTED,
+    BUDGET_TIME_EXHAUSTED,
+    BUDGET_NODES_EXHAUSTED,
+    BUDGET_CANCELLED
+} BudgetState;
+
+/*
+The governor enforces the budget of a command. Steps, matchings and nodes are only counted on the thread
+that began the command, cancellation and time are seen by all threads, e.g. workers of a table.
+When steps or matchings are exhausted, rewriting stops and leaves a partially simplified tree.
+When time or nodes are exhausted, evaluation fails too.
+A command can be cancelled from a signal handler, this stops rewriting and evaluation.
+Calls of governor_begin and governor_end can be nested, nested commands are governed as part of outermost command.
+*/
+void governor_set_budget(Budget budget);
+Budget governor_get_budget();
+void governor_begin();
+void governor_end();
+bool governor_take_step();
+bool governor_take_matching();
+bool governor_check_limits();
+BudgetState governor_get_state();
+const char *governor_state_to_str(BudgetState state);
+void governor_node_allocated();
+void governor_node_freed();
+bool governor_cancel();
+bool governor_is_stopped();
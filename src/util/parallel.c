@@ -0,0 +1,128 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "alloc_wrappers.h"
+#include "parallel.h"
+
+// Upper limit for number of worker threads
+#define MAX_WORKERS 256
+
+static size_t num_workers = 1;
+
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t chunk_done; // Signaled when a chunk has been processed
+    size_t num_chunks;
+    size_t next_chunk;         // Index of next chunk that has not been claimed by a worker
+    bool *done;                // Per chunk: true when processed
+    ChunkWorker work;
+    void *context;
+} Job;
+
+/*
+Summary: Sets number of workers to number of online processors
+*/
+void init_parallel()
+{
+    long num_procs = sysconf(_SC_NPROCESSORS_ONLN);
+    set_num_workers(num_procs > 0 ? (size_t)num_procs : 1);
+}
+
+size_t get_num_workers()
+{
+    return num_workers;
+}
+
+/*
+Params
+    value: Number of workers, is clamped to [1, MAX_WORKERS]
+*/
+void set_num_workers(size_t value)
+{
+    if (value < 1) value = 1;
+    if (value > MAX_WORKERS) value = MAX_WORKERS;
+    num_workers = value;
+}
+
+static void *worker_main(void *arg)
+{
+    Job *job = (Job*)arg;
+    while (true)
+    {
+        pthread_mutex_lock(&job->mutex);
+        size_t chunk = job->next_chunk++;
+        pthread_mutex_unlock(&job->mutex);
+        if (chunk >= job->num_chunks) return NULL;
+
+        job->work(chunk, job->context);
+
+        pthread_mutex_lock(&job->mutex);
+        job->done[chunk] = true;
+        pthread_cond_broadcast(&job->chunk_done);
+        pthread_mutex_unlock(&job->mutex);
+    }
+}
+
+/*
+Summary: Processes chunks on worker threads, consumes them in order on calling thread as soon as they are processed
+    Chunks are claimed in ascending order, so consumption can start early and memory of results can be recycled
+Params
+    max_threads: Number of threads to use at most, is further limited by number of workers
+                 When 1, chunks are processed and consumed alternately on calling thread
+    consume:     Can be NULL
+*/
+void run_chunks_ordered(size_t num_chunks, size_t max_threads, ChunkWorker work, ChunkConsumer consume, void *context)
+{
+    size_t num_threads = max_threads < num_workers ? max_threads : num_workers;
+    if (num_threads > num_chunks) num_threads = num_chunks;
+
+    pthread_t threads[MAX_WORKERS];
+    Job job = {
+        .num_chunks = num_chunks,
+        .next_chunk = 0,
+        .done = calloc_wrapper(num_chunks == 0 ? 1 : num_chunks, sizeof(bool)),
+        .work = work,
+        .context = context
+    };
+    pthread_mutex_init(&job.mutex, NULL);
+    pthread_cond_init(&job.chunk_done, NULL);
+
+    size_t num_started = 0;
+    if (num_threads > 1)
+    {
+        while (num_started < num_threads && pthread_create(&threads[num_started], NULL, worker_main, &job) == 0)
+        {
+            num_started++;
+        }
+    }
+
+    if (num_started == 0)
+    {
+        // No threads needed or none could be started
+        for (size_t i = 0; i < num_chunks; i++)
+        {
+            work(i, context);
+            if (consume != NULL) consume(i, context);
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < num_chunks; i++)
+        {
+            pthread_mutex_lock(&job.mutex);
+            while (!job.done[i]) pthread_cond_wait(&job.chunk_done, &job.mutex);
+            pthread_mutex_unlock(&job.mutex);
+            if (consume != NULL) consume(i, context);
+        }
+        for (size_t i = 0; i < num_started; i++)
+        {
+            pthread_join(threads[i], NULL);
+        }
+    }
+
+    pthread_mutex_destroy(&job.mutex);
+    pthread_cond_destroy(&job.chunk_done);
+    free(job.done);
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+Summary: Processes one chunk, called concurrently on worker threads
+*/
+typedef void (*ChunkWorker)(size_t chunk_index, void *context);
+/*
+Summary: Receives chunks in ascending order on calling thread after they have been processed
+*/
+typedef void (*ChunkConsumer)(size_t chunk_index, void *context);
+
+void init_parallel();
+size_t get_num_workers();
+void set_num_workers(size_t num_workers);
+void run_chunks_ordered(size_t num_chunks, size_t max_threads, ChunkWorker work, ChunkConsumer consume, void *context);
@@ -37,7 +37,7 @@ void get_random_tree(size_t max_inner_nodes, Node **out)
     else
     {
         // Choose random operator
-        Operator *op = list_get_at(&g_ctx->op_list, op_indices[rand() % NUM_OP_INDICES]);
+        Operator *op = list_get_at(&g_builtin_ctx->op_list, op_indices[rand() % NUM_OP_INDICES]);
         size_t num_children;
 
         if (op->arity == OP_DYNAMIC_ARITY)
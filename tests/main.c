@@ -15,6 +15,14 @@
 #include "test_table.h"
 #include "test_simplification.h"
 #include "test_data_structures.h"
+#include "test_context.h"
+#include "test_bytecode.h"
+#include "test_parallel.h"
+#include "test_export.h"
+#include "test_plugin.h"
+#include "test_kernels.h"
+#include "test_numerics.h"
+#include "test_csv.h"
 
 #define FUZZER_SEED 21
 
@@ -24,7 +32,7 @@ Please check with valgrind when all tests pass
 Memory leaks are intentionally present when tests fail (for brevity)
 */
 
-static const size_t NUM_TESTS = 7;
+static const size_t NUM_TESTS = 15;
 static Test (*test_getters[])() = {
     get_tree_util_test,
     get_parser_test,
@@ -32,7 +40,15 @@ static Test (*test_getters[])() = {
     get_randomized_test,
     get_table_test,
     get_simplification_test,
-    get_data_structures_test
+    get_data_structures_test,
+    get_context_test,
+    get_bytecode_test,
+    get_parallel_test,
+    get_export_test,
+    get_plugin_test,
+    get_kernels_test,
+    get_numerics_test,
+    get_csv_test
 };
 
 int main()
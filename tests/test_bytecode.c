@@ -0,0 +1,510 @@
+#include <stdlib.h>
+#include <math.h>
+
+#include "../src/engine/tree/tree_util.h"
+#include "../src/engine/tree/tree_to_string.h"
+#include "../src/engine/parsing/parser.h"
+#include "../src/client/core/arith_context.h"
+#include "../src/client/core/arith_evaluation.h"
+#include "../src/client/core/bytecode.h"
+#include "../src/client/core/jit.h"
+#include "../src/client/core/gradient.h"
+#include "../src/client/core/vector_math.h"
+#include "test_bytecode.h"
+#include "fuzzer.h"
+
+#define MAX_INNER_NODES 20
+#define NUM_CASES       1000
+#define DEEP_TREE_DEPTH 200
+#define NUM_BATCH_CASES 100
+#define NUM_BATCH_ROWS  300
+#define NUM_GRADIENT_OP_CASES   200
+#define MAX_GRADIENT_ARG_NODES  4
+
+// Same names as used by fuzzer
+#define NUM_VARS 5
+static const char *var_names[] = { "x", "y", "z", "abc", "def" };
+
+#define NUM_VALUES 8
+static double values[] = { 0, 1, -1, 0.5, -2.75, 3, 10, 1e-3 };
+
+// Expressions with operators that are not chosen by fuzzer and shapes that are compiled to superinstructions
+#define NUM_EXPRESSIONS 13
+static const char *expressions[] = {
+    "x^2 + y^0.5 - z^-1",
+    "0^x + x^0",
+    "2^x^y",
+    "sin(x) * cos(y) + exp(z)",
+    "x * y + z",
+    "z + x * y",
+    "x * y - z",
+    "z - x * y",
+    "3 * x * y + -abc * def",
+    "sqrt(ln(x)) / sin(y)",
+    "max(x, y * z, sin(abc)) + +def",
+    "x! + y C z + fib(abc)",
+    "0^sqrt(-x - 1) + y / sqrt(z - 20)" // Comparisons with NaN
+};
+
+// Derivatives compiled in forward mode and hand-written derivatives, evaluated at positive x
+#define NUM_DERIVATIVES 9
+static const struct {
+    const char *derivative;
+    const char *expected;
+} derivatives[] = {
+    { "deriv(x^3 - 2 * x, x)",                  "3 * x^2 - 2" },
+    { "deriv(sin(x) * exp(x), x)",              "(cos(x) + sin(x)) * exp(x)" },
+    { "deriv(x / (1 + x^2), x)",                "(1 - x^2) / (1 + x^2)^2" },
+    { "deriv(x^x, x)",                          "x^x * (ln(x) + 1)" },
+    { "deriv(2^x + ln(x) + lg(x), x)",          "2^x * ln(2) + 1 / x + 1 / (x * ln(10))" },
+    { "deriv(sqrt(x) * cos(x), x)",             "cos(x) / (2 * sqrt(x)) - sqrt(x) * sin(x)" },
+    { "deriv(tan(x) + atan(x) + tanh(x), x)",   "1 / cos(x)^2 + 1 / (1 + x^2) + 1 / cosh(x)^2" },
+    { "deriv(asin(x / 4) + acosh(x + 1), x)",   "1 / (4 * sqrt(1 - x^2 / 16)) + 1 / sqrt((x + 1)^2 - 1)" },
+    { "deriv(abs(-x) * floor(x) + frac(x) + y, x)", "floor(x) + 1" }
+};
+
+#define NUM_DERIVATIVE_POINTS 4
+static double derivative_points[] = { 0.5, 1.5, 2.25, 3 };
+
+static bool results_equal(double a, double b)
+{
+    return a == b || (isnan(a) && isnan(b));
+}
+
+/*
+Summary: Evaluates tree with tree_reduce after replacing variables with constants
+*/
+static ListenerError reference_evaluate(const Node *tree, const double *var_values, double *out)
+{
+    Node *copy = tree_copy(tree);
+    for (size_t i = 0; i < NUM_VARS; i++)
+    {
+        Node *value = malloc_constant_node(var_values[i], 0);
+        replace_variable_nodes(&copy, value, var_names[i]);
+        free_tree(value);
+    }
+    ListenerError res = tree_reduce(copy, arith_op_evaluate, out, NULL);
+    free_tree(copy);
+    return res;
+}
+
+/*
+Summary: Compares result and error code of compiled program with those of tree_reduce,
+    once interpreted and once translated to native code (if supported on this platform)
+*/
+static bool check_tree(StringBuilder *error_builder, const Node *tree, const double *var_values)
+{
+    double expected = 0;
+    ListenerError expected_err = reference_evaluate(tree, var_values, &expected);
+
+    for (size_t jit = 0; jit < 2; jit++)
+    {
+        bool prev_jit = set_jit_enabled(jit == 1);
+        Program program;
+        bool compiled = compile_program(tree, NUM_VARS, var_names, &program);
+        set_jit_enabled(prev_jit);
+        if (!compiled)
+        {
+            ERROR("Compilation failed for: %s\n", tree_to_str(tree, false));
+        }
+#if defined(__x86_64__) && !defined(NO_JIT)
+        if (jit == 1 && program.native_code == NULL)
+        {
+            ERROR("No native code generated for: %s\n", tree_to_str(tree, false));
+        }
+#endif
+
+        double actual = 0;
+        ListenerError actual_err = run_program(&program, var_values, &actual);
+        free_program(&program);
+
+        if (expected_err != actual_err)
+        {
+            ERROR("Error code %d instead of %d (jit: %zu) for: %s\n", actual_err, expected_err, jit, tree_to_str(tree, false));
+        }
+        if (expected_err == LISTENERERR_SUCCESS && !results_equal(expected, actual))
+        {
+            ERROR("Result %.17g instead of %.17g (jit: %zu) for: %s\n", actual, expected, jit, tree_to_str(tree, false));
+        }
+    }
+    return true;
+}
+
+/*
+Summary: Compares column-at-a-time evaluation of tree with row-by-row evaluation for each level of SIMD kernels
+    Results are only the same without kernels, error codes are always the same
+*/
+static bool check_batch(StringBuilder *error_builder, const Node *tree)
+{
+    Program program;
+    compile_program(tree, NUM_VARS, var_names, &program);
+
+    double columns[NUM_VARS][NUM_BATCH_ROWS];
+    const double *column_ptrs[NUM_VARS];
+    for (size_t i = 0; i < NUM_VARS; i++)
+    {
+        for (size_t j = 0; j < NUM_BATCH_ROWS; j++)
+        {
+            columns[i][j] = values[rand() % NUM_VALUES];
+        }
+        column_ptrs[i] = columns[i];
+    }
+
+    VmathLevel prev_level = vmath_get_level();
+    for (VmathLevel level = VMATH_SCALAR; level <= VMATH_AVX2; level++)
+    {
+        vmath_set_level(level);
+        double results[NUM_BATCH_ROWS];
+        ListenerError errors[NUM_BATCH_ROWS];
+        run_program_batch(&program, NUM_BATCH_ROWS, column_ptrs, results, errors);
+
+        for (size_t j = 0; j < NUM_BATCH_ROWS; j++)
+        {
+            double var_values[NUM_VARS];
+            for (size_t i = 0; i < NUM_VARS; i++) var_values[i] = columns[i][j];
+            double expected = 0;
+            ListenerError expected_err = run_program(&program, var_values, &expected);
+
+            if (expected_err != errors[j])
+            {
+                ERROR("Error code %d instead of %d in row %zu (level %d) for: %s\n",
+                    errors[j], expected_err, j, level, tree_to_str(tree, false));
+            }
+            if (level == VMATH_SCALAR && expected_err == LISTENERERR_SUCCESS && !results_equal(expected, results[j]))
+            {
+                ERROR("Result %.17g instead of %.17g in row %zu for: %s\n", results[j], expected, j, tree_to_str(tree, false));
+            }
+        }
+    }
+    vmath_set_level(prev_level);
+
+    free_program(&program);
+    return true;
+}
+
+/*
+Summary: Compares derivatives computed in forward mode and in reverse mode
+    with hand-written derivative evaluated by tree_reduce
+*/
+static bool check_derivative(StringBuilder *error_builder, const char *derivative, const char *expected)
+{
+    Node *tree = parse_easy(g_ctx, derivative);
+    Node *expected_tree = parse_easy(g_ctx, expected);
+    if (tree == NULL || expected_tree == NULL)
+    {
+        ERROR("Parser error for: %s\n", derivative);
+    }
+    if (!can_compile_derivatives(tree))
+    {
+        ERROR("Derivative can not be compiled: %s\n", derivative);
+    }
+
+    for (size_t jit = 0; jit < 2; jit++)
+    {
+        bool prev_jit = set_jit_enabled(jit == 1);
+        Program program;
+        bool compiled = compile_program(tree, NUM_VARS, var_names, &program);
+        set_jit_enabled(prev_jit);
+        if (!compiled)
+        {
+            ERROR("Compilation failed for: %s\n", derivative);
+        }
+
+        for (size_t i = 0; i < NUM_DERIVATIVE_POINTS; i++)
+        {
+            double var_values[NUM_VARS] = { derivative_points[i], 1, 1, 1, 1 };
+            double expected_val = 0;
+            double actual = 0;
+            reference_evaluate(expected_tree, var_values, &expected_val);
+            if (run_program(&program, var_values, &actual) != LISTENERERR_SUCCESS
+                || fabs(actual - expected_val) > 1e-12 * fabs(expected_val) + 1e-12)
+            {
+                ERROR("Result %.17g instead of %.17g at %g (jit: %zu) for: %s\n",
+                    actual, expected_val, derivative_points[i], jit, derivative);
+            }
+        }
+        free_program(&program);
+    }
+
+    // Reverse mode yields the same derivative
+    for (size_t i = 0; i < NUM_DERIVATIVE_POINTS; i++)
+    {
+        double var_values[NUM_VARS] = { derivative_points[i], 1, 1, 1, 1 };
+        double expected_val = 0;
+        double value = 0;
+        double gradient[NUM_VARS];
+        reference_evaluate(expected_tree, var_values, &expected_val);
+        if (tree_gradient(get_child(tree, 0), NUM_VARS, var_names, var_values, &value, gradient) != LISTENERERR_SUCCESS
+            || fabs(gradient[0] - expected_val) > 1e-12 * fabs(expected_val) + 1e-12)
+        {
+            ERROR("Gradient %.17g instead of %.17g at %g for: %s\n",
+                gradient[0], expected_val, derivative_points[i], derivative);
+        }
+    }
+
+    if (!check_batch(error_builder, tree)) return false;
+    free_tree(tree);
+    free_tree(expected_tree);
+    return true;
+}
+
+static Node *op_node(size_t id, size_t num_children, Node *a, Node *b)
+{
+    Node *res = malloc_operator_node(list_get_at(&g_builtin_ctx->op_list, id), num_children, 0);
+    set_child(res, 0, a);
+    if (num_children == 2) set_child(res, 1, b);
+    return res;
+}
+
+/*
+Summary: Rewrites operators without rule in compile_dual to equivalent ones with rule,
+    max and min are replaced by the argument they select at var_values, which is the one tree_gradient follows
+*/
+static Node *expand_for_dual(const Node *tree, const double *var_values)
+{
+    if (get_type(tree) != NTYPE_OPERATOR) return tree_copy(tree);
+    size_t id = get_op(tree)->id;
+    size_t num_args = get_num_children(tree);
+    Node *args[MAX_CHILDREN];
+    for (size_t i = 0; i < num_args; i++) args[i] = expand_for_dual(get_child(tree, i), var_values);
+
+    Node *res = NULL;
+    switch (id)
+    {
+        case 10: // x mod y = x - trunc(x / y) * y
+            res = op_node(5, 2, tree_copy(args[0]), op_node(6, 2,
+                op_node(40, 1, op_node(7, 2, args[0], tree_copy(args[1])), NULL), args[1]));
+            break;
+        case 14: // x% = x / 100
+            res = op_node(7, 2, args[0], malloc_constant_node(100, 0));
+            break;
+        case 16: // root(x, n) = x^(1 / n)
+            res = op_node(8, 2, args[0], op_node(7, 2, malloc_constant_node(1, 0), args[1]));
+            break;
+        case 18: // log(x, n) = ln(x) / ln(n)
+            res = op_node(7, 2, op_node(19, 1, args[0], NULL), op_node(19, 1, args[1], NULL));
+            break;
+        case 34: // max(x, y, ...)
+        case 35: // min(x, y, ...)
+        {
+            double value = 0;
+            reference_evaluate(tree, var_values, &value);
+            for (size_t i = 0; i < num_args; i++)
+            {
+                double arg_value = 0;
+                reference_evaluate(get_child(tree, i), var_values, &arg_value);
+                if (res == NULL && arg_value == value) res = args[i];
+                else free_tree(args[i]);
+            }
+            if (res == NULL) res = malloc_constant_node(value, 0);
+            break;
+        }
+        case 43: // sum(x, y, ...)
+        case 44: // prod(x, y, ...)
+        case 45: // avg(x, y, ...) = sum(x, y, ...) / n
+            if (num_args == 0) return malloc_constant_node(id == 44 ? 1 : 0, 0);
+            res = args[0];
+            for (size_t i = 1; i < num_args; i++) res = op_node(id == 44 ? 6 : 4, 2, res, args[i]);
+            if (id == 45) res = op_node(7, 2, res, malloc_constant_node(num_args, 0));
+            break;
+        default:
+            res = malloc_operator_node(get_op(tree), num_args, 0);
+            for (size_t i = 0; i < num_args; i++) set_child(res, i, args[i]);
+    }
+    return res;
+}
+
+static bool derivatives_close(double a, double b)
+{
+    return results_equal(a, b) || fabs(a - b) <= 1e-9 * fmax(fabs(a), fabs(b)) + 1e-12;
+}
+
+/*
+Summary: Compares value and partial derivatives of tree_gradient with tree_reduce and forward mode of compile_dual
+    Derivatives are only compared where the expanded tree has the same value and both modes yield finite results
+*/
+static bool check_gradient(StringBuilder *error_builder, const Node *tree, const double *var_values)
+{
+    double expected_value = 0;
+    ListenerError expected_err = reference_evaluate(tree, var_values, &expected_value);
+    double value = 0;
+    double gradient[NUM_VARS];
+    ListenerError err = tree_gradient(tree, NUM_VARS, var_names, var_values, &value, gradient);
+    if (err != expected_err)
+    {
+        ERROR("Gradient has error code %d instead of %d for: %s\n", err, expected_err, tree_to_str(tree, false));
+    }
+    if (err != LISTENERERR_SUCCESS) return true;
+    if (!results_equal(value, expected_value))
+    {
+        ERROR("Gradient has value %.17g instead of %.17g for: %s\n", value, expected_value, tree_to_str(tree, false));
+    }
+
+    Node *expanded = expand_for_dual(tree, var_values);
+    double expanded_value = 0;
+    if (reference_evaluate(expanded, var_values, &expanded_value) != LISTENERERR_SUCCESS
+        || !derivatives_close(expanded_value, value))
+    {
+        free_tree(expanded);
+        return true;
+    }
+
+    const Operator *deriv = ctx_lookup_op(g_ctx, "deriv", OP_PLACE_FUNCTION);
+    for (size_t i = 0; i < NUM_VARS; i++)
+    {
+        Node *derivative = malloc_operator_node(deriv, 2, 0);
+        set_child(derivative, 0, tree_copy(expanded));
+        set_child(derivative, 1, malloc_variable_node(var_names[i], 0, 0));
+        Program program;
+        if (!can_compile_derivatives(derivative) || !compile_program(derivative, NUM_VARS, var_names, &program))
+        {
+            ERROR("Derivative can not be compiled: %s\n", tree_to_str(derivative, false));
+        }
+        double expected = 0;
+        ListenerError forward_err = run_program(&program, var_values, &expected);
+        free_program(&program);
+        free_tree(derivative);
+
+        if (forward_err == LISTENERERR_SUCCESS && isfinite(expected) && isfinite(gradient[i])
+            && !derivatives_close(gradient[i], expected))
+        {
+            ERROR("Partial derivative %.17g instead of %.17g with respect to %s at (%g, %g, %g, %g, %g) for: %s\n",
+                gradient[i], expected, var_names[i], var_values[0], var_values[1], var_values[2], var_values[3],
+                var_values[4], tree_to_str(tree, false));
+        }
+    }
+    free_tree(expanded);
+    return true;
+}
+
+/*
+Summary: Checks derivative rule of each operator that tree_gradient knows, arguments are random trees
+*/
+static bool gradient_op_test(StringBuilder *error_builder)
+{
+    for (size_t id = 0; id <= 45; id++)
+    {
+        // @x, deriv(x, y), x', x C y and x! have no derivative rule
+        if (id == 1 || id == 2 || id == 3 || id == 9 || id == 13) continue;
+        Operator *op = list_get_at(&g_builtin_ctx->op_list, id);
+        for (size_t i = 0; i < NUM_GRADIENT_OP_CASES; i++)
+        {
+            size_t num_args = op->arity == OP_DYNAMIC_ARITY ? (size_t)(rand() % 5) : op->arity;
+            Node *tree = malloc_operator_node(op, num_args, 0);
+            for (size_t j = 0; j < num_args; j++)
+            {
+                get_random_tree(rand() % (MAX_GRADIENT_ARG_NODES + 1), get_child_addr(tree, j));
+            }
+            double var_values[NUM_VARS];
+            for (size_t j = 0; j < NUM_VARS; j++) var_values[j] = values[rand() % NUM_VALUES];
+            if (!check_gradient(error_builder, tree, var_values)) return false;
+            free_tree(tree);
+        }
+    }
+    return true;
+}
+
+/*
+Summary: Differential test of compiled programs against tree_reduce on random trees and fixed expressions
+    and of column-at-a-time evaluation against row-by-row evaluation
+*/
+bool bytecode_test(StringBuilder *error_builder)
+{
+    for (size_t i = 0; i < NUM_CASES; i++)
+    {
+        Node *tree = NULL;
+        get_random_tree(MAX_INNER_NODES, &tree);
+        double var_values[NUM_VARS];
+        for (size_t j = 0; j < NUM_VARS; j++)
+        {
+            var_values[j] = values[rand() % NUM_VALUES];
+        }
+        if (!check_tree(error_builder, tree, var_values)) return false;
+        if (!check_gradient(error_builder, tree, var_values)) return false;
+        if (i < NUM_BATCH_CASES && !check_batch(error_builder, tree)) return false;
+        free_tree(tree);
+    }
+
+    for (size_t i = 0; i < NUM_EXPRESSIONS; i++)
+    {
+        Node *tree = parse_easy(g_ctx, expressions[i]);
+        if (tree == NULL)
+        {
+            ERROR("Parser error for: %s\n", expressions[i]);
+        }
+        for (size_t j = 0; j < NUM_VALUES; j++)
+        {
+            double var_values[NUM_VARS];
+            for (size_t k = 0; k < NUM_VARS; k++)
+            {
+                var_values[k] = values[(j + k) % NUM_VALUES];
+            }
+            if (!check_tree(error_builder, tree, var_values)) return false;
+        }
+        if (!check_batch(error_builder, tree)) return false;
+        free_tree(tree);
+    }
+
+    if (!gradient_op_test(error_builder)) return false;
+    for (size_t i = 0; i < NUM_DERIVATIVES; i++)
+    {
+        if (!check_derivative(error_builder, derivatives[i].derivative, derivatives[i].expected)) return false;
+    }
+
+    // Forward mode knows no derivative of max and no second derivatives, shorthand needs to be transformed first
+    const char *not_compilable[] = { "deriv(max(x, 1), x)", "deriv(deriv(x^3, x), x)", "x'" };
+    for (size_t i = 0; i < 3; i++)
+    {
+        Node *tree = parse_easy(g_ctx, not_compilable[i]);
+        Program program;
+        // Shorthand is compiled to a call that fails when run
+        if (can_compile_derivatives(tree) || (i < 2 && compile_program(tree, NUM_VARS, var_names, &program)))
+        {
+            ERROR("Derivative without rule is compiled: %s\n", not_compilable[i]);
+        }
+        free_tree(tree);
+    }
+
+    // Deep tree that does not fit in local stack: 1 - (2 - (3 - ...))
+    const Operator *minus = ctx_lookup_op(g_ctx, "-", OP_PLACE_INFIX);
+    Node *deep = malloc_variable_node("x", 0, 0);
+    for (size_t i = 0; i < DEEP_TREE_DEPTH; i++)
+    {
+        Node *parent = malloc_operator_node(minus, 2, 0);
+        set_child(parent, 0, malloc_constant_node(i, 0));
+        set_child(parent, 1, deep);
+        deep = parent;
+    }
+    Program deep_program;
+    double deep_expected = 0;
+    double deep_actual = 0;
+    double x = 0.25;
+    if (!compile_program(deep, 1, var_names, &deep_program))
+    {
+        ERROR("Compilation of deep tree failed\n");
+    }
+    reference_evaluate(deep, (double[]){ x, 0, 0, 0, 0 }, &deep_expected);
+    if (run_program(&deep_program, &x, &deep_actual) != LISTENERERR_SUCCESS
+        || !results_equal(deep_expected, deep_actual))
+    {
+        ERROR("Wrong result of deep tree\n");
+    }
+    free_program(&deep_program);
+
+    // Unbound variable
+    if (compile_program(deep, 0, NULL, &deep_program))
+    {
+        ERROR("Compilation of tree with unbound variable succeeded\n");
+    }
+    free_tree(deep);
+
+    return true;
+}
+
+Test get_bytecode_test()
+{
+    return (Test){
+        bytecode_test,
+        "Bytecode"
+    };
+}
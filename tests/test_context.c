@@ -0,0 +1,82 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/engine/parsing/context.h"
+#include "../src/engine/parsing/parser.h"
+#include "../src/engine/tree/tree_util.h"
+#include "test_context.h"
+
+bool context_test(StringBuilder *error_builder)
+{
+    ParsingContext base = ctx_create();
+    ctx_add_ops(&base, 3,
+        op_get_infix("+", 1, OP_ASSOC_LEFT),
+        op_get_prefix("!", 2),
+        op_get_infix("!=", 0, OP_ASSOC_LEFT));
+    ctx_set_glue_op(&base, ctx_lookup_op(&base, "+", OP_PLACE_INFIX));
+
+    ParsingContext child = ctx_create_child(&base);
+    const Operator *f = ctx_add_op(&child, op_get_function("f", 1));
+
+    // Case 1: Lookups fall through, additions do not affect parent
+    if (f == NULL || f->id != 3)
+    {
+        ERROR("Operator of child has not been added with unique id\n");
+    }
+    if (ctx_lookup_op(&child, "+", OP_PLACE_INFIX) != ctx_lookup_op(&base, "+", OP_PLACE_INFIX)
+        || ctx_lookup_op(&child, "+", OP_PLACE_INFIX) == NULL)
+    {
+        ERROR("Lookup in child does not fall through to parent\n");
+    }
+    if (ctx_lookup_op(&base, "f", OP_PLACE_FUNCTION) != NULL)
+    {
+        ERROR("Addition to child is visible in parent\n");
+    }
+    if (child.glue_op != base.glue_op)
+    {
+        ERROR("Glue-op has not been inherited\n");
+    }
+    if (ctx_add_op(&child, op_get_infix("-", 1, OP_ASSOC_RIGHT)) != NULL)
+    {
+        ERROR("Associativity of parent has not been checked\n");
+    }
+
+    // Case 2: Parsing in child uses operators of both layers
+    Node *tree = parse_easy(&child, "f(1 + 2) != 3");
+    if (tree == NULL || get_op(tree) != ctx_lookup_op(&base, "!=", OP_PLACE_INFIX))
+    {
+        ERROR("Unexpected parse result in child context\n");
+    }
+    free_tree(tree);
+
+    // Case 3: Deleting an operator of parent hides it in child only
+    if (!ctx_delete_op(&child, "!=", OP_PLACE_INFIX))
+    {
+        ERROR_RETURN_VAL("ctx_delete_op");
+    }
+    if (ctx_lookup_op(&child, "!=", OP_PLACE_INFIX) != NULL
+        || ctx_lookup_op(&base, "!=", OP_PLACE_INFIX) == NULL)
+    {
+        ERROR("Deletion in child did not hide operator of parent\n");
+    }
+    if (ctx_lookup_keyword(&child, "!=3") != 1 || ctx_lookup_keyword(&base, "!=3") != 2)
+    {
+        ERROR_RETURN_VAL("ctx_lookup_keyword");
+    }
+    if (ctx_delete_op(&child, "!=", OP_PLACE_INFIX))
+    {
+        ERROR("Operator has been deleted twice\n");
+    }
+
+    ctx_destroy(&child);
+    ctx_destroy(&base);
+    return true;
+}
+
+Test get_context_test()
+{
+    return (Test){
+        context_test,
+        "Context"
+    };
+}
@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/engine/parsing/parser.h"
+#include "../src/client/core/arith_context.h"
+#include "../src/client/core/csv.h"
+#include "test_csv.h"
+
+// Longer than initial read buffer of reader, such that it has to grow
+#define LONG_LINE_LENGTH 200000
+#define OUTPUT_SIZE      4096
+
+static const char *MAP_INPUT = "7,oops,\"quoted, \"\"text\"\"\"\r\n0,4,x\n\n2,3,y";
+static const char *MAP_OUTPUT = "7,oops,\"quoted, \"\"text\"\"\",Error\n0,4,x,Error\n2,3,y,0.10000000000000009\n";
+
+// Writes content to temporary file and rewinds it
+static FILE *create_file(const char *content)
+{
+    FILE *file = tmpfile();
+    if (file == NULL) return NULL;
+    fputs(content, file);
+    rewind(file);
+    return file;
+}
+
+static bool reader_test(StringBuilder *error_builder)
+{
+    char *long_line = malloc(LONG_LINE_LENGTH + 1);
+    memset(long_line, 'a', LONG_LINE_LENGTH);
+    long_line[LONG_LINE_LENGTH] = '\0';
+    FILE *file = tmpfile();
+    if (file == NULL) ERROR("Could not create temporary file\n");
+    fprintf(file, "first\r\n%s\n\nlast", long_line);
+    rewind(file);
+
+    CsvReader reader = csv_create_reader(file);
+    const char *expected[] = { "first", long_line, "", "last" };
+    for (size_t i = 0; i < 4; i++)
+    {
+        char *line = csv_read_line(&reader);
+        if (line == NULL || strcmp(line, expected[i]) != 0)
+        {
+            ERROR("Line %zu has not been read correctly\n", i);
+        }
+    }
+    if (csv_read_line(&reader) != NULL) ERROR("Reader did not stop at end of file\n");
+    csv_free_reader(&reader);
+    fclose(file);
+    free(long_line);
+
+    char line[] = "1,,x y,last";
+    char *fields[3];
+    if (csv_split(line, ',', 3, fields) != 4
+        || strcmp(fields[0], "1") != 0 || strcmp(fields[1], "") != 0 || strcmp(fields[2], "x y") != 0)
+    {
+        ERROR("Fields have not been split correctly\n");
+    }
+    char quoted[] = "\"a,\"\"b\"\"\"\t2";
+    if (csv_split(quoted, '\t', 3, fields) != 2 || strcmp(fields[0], "a,\"b\"") != 0 || strcmp(fields[1], "2") != 0)
+    {
+        ERROR("Quoted field has not been split correctly\n");
+    }
+    return true;
+}
+
+static bool map_test(StringBuilder *error_builder)
+{
+    // Variables are bound to second and first column
+    const char *vars[] = { "b", "a" };
+    const size_t columns[] = { 1, 0 };
+    Node *tree = parse_easy(g_ctx, "b / a - 1.4");
+    Program program;
+    if (tree == NULL || !compile_program(tree, 2, vars, &program))
+    {
+        ERROR("Compilation of expression failed\n");
+    }
+    free_tree(tree);
+
+    FILE *in = create_file(MAP_INPUT);
+    FILE *out = tmpfile();
+    if (in == NULL || out == NULL) ERROR("Could not create temporary file\n");
+    CsvReader reader = csv_create_reader(in);
+    CsvMapResult result;
+    if (!csv_map(&reader, out, ',', &program, columns, &result))
+    {
+        ERROR("Output could not be written\n");
+    }
+    if (result.num_rows != 3 || result.num_errors != 2)
+    {
+        ERROR("Mapped %zu rows with %zu errors\n", result.num_rows, result.num_errors);
+    }
+
+    char output[OUTPUT_SIZE];
+    rewind(out);
+    size_t length = fread(output, 1, OUTPUT_SIZE - 1, out);
+    output[length] = '\0';
+    if (strcmp(output, MAP_OUTPUT) != 0)
+    {
+        ERROR("Wrong output of map:\n%s\n", output);
+    }
+
+    csv_free_reader(&reader);
+    fclose(in);
+    fclose(out);
+    free_program(&program);
+    return true;
+}
+
+/*
+Summary: Tests reading and splitting of CSV files, and mapping of rows to results
+*/
+bool csv_test(StringBuilder *error_builder)
+{
+    return reader_test(error_builder) && map_test(error_builder);
+}
+
+Test get_csv_test()
+{
+    return (Test){
+        csv_test,
+        "Csv"
+    };
+}
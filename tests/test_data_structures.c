@@ -4,6 +4,10 @@
 #include "test_data_structures.h"
 #include "../src/util/linked_list.h"
 #include "../src/util/trie.h"
+#include "../src/client/core/memo.h"
+#include "../src/client/core/result_cache.h"
+#include "../src/client/core/arith_context.h"
+#include "../src/engine/parsing/parser.h"
 
 bool data_structures_test(StringBuilder *error_builder)
 {
@@ -119,6 +123,67 @@ bool data_structures_test(StringBuilder *error_builder)
     trie_remove_str(&trie, "aaaaaaaaaaaa");
     trie_destroy(&trie);
 
+    // Memo cache: keys are bits of arguments, least recently used entry is replaced
+    MemoCache *memo = memo_create(2, 2);
+    double result = 0;
+    ListenerError err = LISTENERERR_SUCCESS;
+    memo_insert(memo, (double[]){ 1, 2 }, 3, LISTENERERR_SUCCESS);
+    memo_insert(memo, (double[]){ 0, 0 }, 0, 6);
+    if (!memo_lookup(memo, (double[]){ 1, 2 }, &result, &err) || result != 3 || err != LISTENERERR_SUCCESS)
+    {
+        ERROR_RETURN_VAL("memo_lookup");
+    }
+    if (memo_lookup(memo, (double[]){ -0.0, 0 }, &result, &err))
+    {
+        ERROR("-0 and 0 should be different keys\n");
+    }
+    memo_insert(memo, (double[]){ 2, 1 }, 5, LISTENERERR_SUCCESS);
+    if (memo_lookup(memo, (double[]){ 0, 0 }, &result, &err))
+    {
+        ERROR("Least recently used entry has not been replaced\n");
+    }
+    if (!memo_lookup(memo, (double[]){ 1, 2 }, &result, &err) || !memo_lookup(memo, (double[]){ 2, 1 }, &result, &err))
+    {
+        ERROR_RETURN_VAL("memo_lookup");
+    }
+    if (memo->hits != 3 || memo->misses != 2 || memo->count != 2)
+    {
+        ERROR("Memo counters are %zu hits, %zu misses, %zu entries\n", memo->hits, memo->misses, memo->count);
+    }
+    memo_destroy(memo);
+
+    // Result cache: operands of + and * are unordered, least recently used entry is replaced
+    result_cache_clear();
+    ResultCacheStats before = result_cache_get_stats();
+    result_cache_insert(parse_easy(g_ctx, "(1 + 2) * sin(3)"), 42);
+    Node *swapped = parse_easy(g_ctx, "sin(3) * (2 + 1)");
+    Node *other = parse_easy(g_ctx, "(1 - 2) * sin(3)");
+    if (!result_cache_lookup(swapped, &result) || result != 42)
+    {
+        ERROR("Commutative operands are not canonical in result cache\n");
+    }
+    if (result_cache_lookup(other, &result))
+    {
+        ERROR("Operands of subtraction have been swapped in result cache\n");
+    }
+    for (size_t i = 0; i < RESULT_CACHE_CAPACITY; i++)
+    {
+        result_cache_insert(malloc_constant_node((double)i, 0), (double)i);
+    }
+    if (result_cache_lookup(swapped, &result))
+    {
+        ERROR("Least recently used result has not been replaced\n");
+    }
+    ResultCacheStats after = result_cache_get_stats();
+    if (after.hits - before.hits != 1 || after.misses - before.misses != 2 || after.count != RESULT_CACHE_CAPACITY)
+    {
+        ERROR("Result cache counters are %zu hits, %zu misses, %zu entries\n",
+            after.hits - before.hits, after.misses - before.misses, after.count);
+    }
+    result_cache_clear();
+    free_tree(swapped);
+    free_tree(other);
+
     return true;
 }
 
@@ -0,0 +1,303 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+
+#include "../src/util/console_util.h"
+#include "../src/engine/tree/tree_util.h"
+#include "../src/client/core/arith_context.h"
+#include "../src/client/core/arith_evaluation.h"
+#include "../src/client/core/c_export.h"
+#include "../src/client/commands/commands.h"
+#include "test_export.h"
+
+#define PATH_SIZE    64
+#define COMMAND_SIZE 256
+
+#define NUM_DEFINITIONS 9
+static const char *definitions[] = {
+    "exa(x, y) = x^2 + 3*y - sin(x)/y",
+    "exb(n) = n! + fib(n) + gcd(n, 12) + lcm(n, 4) + n C 2",
+    "exc = 42",
+    "exd(out, int) = max(out, int, 2) + sum(out, int) + sgn(out) + out mod 3 + root(out, 3) + log(out, 2) + out%",
+    "exe(x) = 0^x + -x + x/(x - 1) + avg(x, 1) + prod(x, x) - floor(x) + frac(x)",
+    "exf(x, y) = x", // Unused parameter
+    "exg(x) = exa(x, x - 1) * exb(2)", // Calls of other functions
+    "exh(n) = fib(9 * n) - n! / 1e200", // Integer operators beyond 64 bits
+    "exi(n, k) = n C k + gcd(n^5, 2^70) - lcm(2^60, k)"
+};
+
+// Each definition uses one operator that is implemented by helpers, other helpers must not be emitted
+#define NUM_HELPER_DEFINITIONS 6
+static const char *helper_definitions[] = {
+    "exj(n) = gcd(n, 6)",
+    "exj(n) = lcm(n, 6)",
+    "exj(n) = n C 3",
+    "exj(n) = n!",
+    "exj(n) = fib(n)",
+    "exj(n) = rand(n, 6)"
+};
+
+// Calls of exported functions with arguments, including calls that fail
+#define NUM_CALLS 19
+static const struct {
+    const char *name;
+    size_t num_args;
+    double args[2];
+} calls[] = {
+    { "exa", 2, { 1.5, 2 } },
+    { "exa", 2, { -0.25, 1e-3 } },
+    { "exa", 2, { 1, 0 } },
+    { "exb", 1, { 7 } },
+    { "exb", 1, { -5.5 } },
+    { "exc", 0, { 0 } },
+    { "exd", 2, { 2.5, -4 } },
+    { "exd", 2, { 10, 0.5 } },
+    { "exe", 1, { 0 } },
+    { "exe", 1, { 1 } },
+    { "exe", 1, { -3.75 } },
+    { "exf", 2, { 3, 4 } },
+    { "exg", 1, { 3 } },
+    { "exg", 1, { 1 } },
+    { "exh", 1, { 150 } },
+    { "exh", 1, { -101.5 } },
+    { "exi", 2, { 160, 80 } },
+    { "exi", 2, { 1000, 498 } },
+    { "exi", 2, { 3e19, 3 } }
+};
+
+/*
+Summary: Evaluates right hand side of user-defined function with tree_reduce
+*/
+static ListenerError reference_evaluate(const char *name, const double *args, double *out)
+{
+    const RewriteRule *rule = get_composite_function(ctx_lookup_op(g_ctx, name, OP_PLACE_FUNCTION));
+    Node *copy = tree_copy(rule->after);
+    for (size_t i = 0; i < get_num_children(rule->pattern.pattern); i++)
+    {
+        Node *value = malloc_constant_node(args[i], 0);
+        replace_variable_nodes(&copy, value, get_var_name(get_child(rule->pattern.pattern, i)));
+        free_tree(value);
+    }
+    ListenerError res = tree_reduce(copy, arith_op_evaluate, out, NULL);
+    free_tree(copy);
+    return res;
+}
+
+static bool write_file(const char *path, const char *content)
+{
+    FILE *file = fopen(path, "w");
+    if (file == NULL) return false;
+    fputs(content, file);
+    fclose(file);
+    return true;
+}
+
+/*
+Summary: Writes program that prints error code and result of each call
+*/
+static void get_driver(StringBuilder *builder)
+{
+    strbuilder_append(builder, "#include <stdio.h>\n");
+    for (size_t i = 0; i < NUM_CALLS; i++)
+    {
+        strbuilder_append(builder, "int " C_EXPORT_PREFIX "%s(", calls[i].name);
+        for (size_t j = 0; j < calls[i].num_args; j++) strbuilder_append(builder, "double, ");
+        strbuilder_append(builder, "double*);\n");
+    }
+    strbuilder_append(builder, "int main()\n{\n    double out = 0;\n    int err = 0;\n");
+    for (size_t i = 0; i < NUM_CALLS; i++)
+    {
+        strbuilder_append(builder, "    err = " C_EXPORT_PREFIX "%s(", calls[i].name);
+        for (size_t j = 0; j < calls[i].num_args; j++) strbuilder_append(builder, "%a, ", calls[i].args[j]);
+        strbuilder_append(builder, "&out);\n    printf(\"%%d %%a\\n\", err, err == 0 ? out : 0.0);\n");
+    }
+    strbuilder_append(builder, "    return 0;\n}\n");
+}
+
+/*
+Summary: Writes table with fold as binary file and compares it with expected records
+*/
+static bool binary_table_test(StringBuilder *error_builder)
+{
+    char path[] = "/tmp/ccalc_tableXXXXXX";
+    int fd = mkstemp(path);
+    if (fd == -1)
+    {
+        ERROR("Could not create temporary file\n");
+    }
+    close(fd);
+
+    char command[COMMAND_SIZE];
+    sprintf(command, "table 1/x ; -1 ; 1 ; 0.5 fold x+y ; 0 > header %s", path);
+    bool interactive = set_interactive(false);
+    bool success = exec_command(command);
+    set_interactive(interactive);
+    if (!success)
+    {
+        ERROR("Table could not be written to %s\n", path);
+    }
+
+    // Magic and counts of columns and rows, records of x, 1/x and sum of previous values of 1/x
+    unsigned char expected_header[24] = { 'C', 'C', 'A', 'L', 'C', 'F', '6', '4', 3, 0, 0, 0, 0, 0, 0, 0, 5 };
+    double expected[] = {
+        -1,   -1,  -1,
+        -0.5, -2,  -3,
+        0,    NAN, -3,
+        0.5,  2,   -1,
+        1,    1,   0
+    };
+    unsigned char content[24 + sizeof(expected) + 1];
+    FILE *file = fopen(path, "rb");
+    size_t length = fread(content, 1, sizeof(content), file);
+    fclose(file);
+    remove(path);
+    if (length != sizeof(content) - 1 || memcmp(content, expected_header, 24) != 0)
+    {
+        ERROR("Binary table has wrong header or length %zu\n", length);
+    }
+    for (size_t i = 0; i < sizeof(expected) / sizeof(double); i++)
+    {
+        uint64_t bits = 0;
+        for (size_t j = 0; j < 8; j++)
+        {
+            bits |= (uint64_t)content[24 + i * 8 + j] << (8 * j);
+        }
+        double actual;
+        memcpy(&actual, &bits, sizeof(double));
+        if (actual != expected[i] && !(isnan(actual) && isnan(expected[i])))
+        {
+            ERROR("Value %zu of binary table is %.17g instead of %.17g\n", i, actual, expected[i]);
+        }
+    }
+    return true;
+}
+
+/*
+Summary: Exports modules of a single function, each of them needs to compile without warnings about unused helpers
+*/
+static bool unused_helpers_test(StringBuilder *error_builder, const char *module_path)
+{
+    for (size_t i = 0; i < NUM_HELPER_DEFINITIONS; i++)
+    {
+        clear_composite_functions();
+        char command[COMMAND_SIZE];
+        strcpy(command, helper_definitions[i]);
+        bool interactive = set_interactive(false);
+        bool defined = exec_command(command);
+        set_interactive(interactive);
+        if (!defined)
+        {
+            ERROR("Definition failed: %s\n", helper_definitions[i]);
+        }
+
+        StringBuilder module = strbuilder_create(100);
+        export_c_module(&module);
+        write_file(module_path, module.buffer);
+        vec_destroy(&module);
+        sprintf(command, "cc -std=c99 -Wall -Wextra -pedantic -Werror -c -o /dev/null %s", module_path);
+        if (system(command) != 0)
+        {
+            ERROR("Generated module of %s does not compile (see %s)\n", helper_definitions[i], module_path);
+        }
+    }
+    clear_composite_functions();
+    return true;
+}
+
+/*
+Summary: Exports functions, compiles generated module with C compiler of system
+    and compares results of compiled functions with those of tree_reduce
+    Skipped when there is no C compiler, binary output of tables is tested either way
+*/
+bool export_test(StringBuilder *error_builder)
+{
+    if (!binary_table_test(error_builder)) return false;
+    if (system("cc --version > /dev/null 2>&1") != 0) return true;
+
+    bool interactive = set_interactive(false);
+    for (size_t i = 0; i < NUM_DEFINITIONS; i++)
+    {
+        char command[COMMAND_SIZE];
+        strcpy(command, definitions[i]);
+        if (!exec_command(command))
+        {
+            ERROR("Definition failed: %s\n", definitions[i]);
+        }
+    }
+    set_interactive(interactive);
+
+    char dir[] = "/tmp/ccalc_exportXXXXXX";
+    if (mkdtemp(dir) == NULL)
+    {
+        ERROR("Could not create temporary directory\n");
+    }
+    char module_path[PATH_SIZE];
+    char driver_path[PATH_SIZE];
+    char binary_path[PATH_SIZE];
+    char command[COMMAND_SIZE];
+    sprintf(module_path, "%s/module.c", dir);
+    sprintf(driver_path, "%s/driver.c", dir);
+    sprintf(binary_path, "%s/driver", dir);
+
+    StringBuilder module = strbuilder_create(100);
+    StringBuilder driver = strbuilder_create(100);
+    if (!export_c_module(&module))
+    {
+        ERROR("Export failed\n");
+    }
+    get_driver(&driver);
+    write_file(module_path, module.buffer);
+    write_file(driver_path, driver.buffer);
+    vec_destroy(&module);
+    vec_destroy(&driver);
+
+    sprintf(command, "cc -std=c99 -Wall -Wextra -pedantic -Werror -o %s %s %s -lm",
+        binary_path, module_path, driver_path);
+    if (system(command) != 0)
+    {
+        ERROR("Generated module does not compile (see %s)\n", module_path);
+    }
+
+    FILE *output = popen(binary_path, "r");
+    for (size_t i = 0; i < NUM_CALLS; i++)
+    {
+        int actual_err = -1;
+        double actual = 0;
+        if (fscanf(output, "%d %la", &actual_err, &actual) != 2)
+        {
+            ERROR("Could not read output of compiled module\n");
+        }
+
+        double expected = 0;
+        ListenerError expected_err = reference_evaluate(calls[i].name, calls[i].args, &expected);
+        if ((int)expected_err != actual_err)
+        {
+            ERROR("Error code %d instead of %d for call %zu of %s\n", actual_err, expected_err, i, calls[i].name);
+        }
+        if (expected_err == LISTENERERR_SUCCESS && expected != actual && !(isnan(expected) && isnan(actual)))
+        {
+            ERROR("Result %.17g instead of %.17g for call %zu of %s\n", actual, expected, i, calls[i].name);
+        }
+    }
+    pclose(output);
+    if (!unused_helpers_test(error_builder, module_path)) return false;
+
+    remove(module_path);
+    remove(driver_path);
+    remove(binary_path);
+    rmdir(dir);
+    clear_composite_functions();
+    return true;
+}
+
+Test get_export_test()
+{
+    return (Test){
+        export_test,
+        "Export"
+    };
+}
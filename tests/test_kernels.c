@@ -0,0 +1,321 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+
+#include "../src/client/core/integer_kernels.h"
+#include "../src/client/core/vector_math.h"
+#include "test_kernels.h"
+
+#define NUM_EXACT_FIB      94
+#define NUM_GCD_CASES      10000
+#define NUM_PASCAL_ROWS    68
+#define NUM_LARGE_BINOMIAL 5
+#define BINOMIAL_TOLERANCE 1e-9
+// Odd number of values, such that last block of every instruction set is partial
+#define NUM_VMATH_VALUES   10001
+#define NUM_VMATH_FUNCS    6
+#define NUM_SPECIAL_VALUES 12
+
+static uint64_t random_u64()
+{
+    uint64_t res = 0;
+    for (size_t i = 0; i < 4; i++) res = (res << 16) ^ (uint64_t)(rand() & 0xFFFF);
+    return res;
+}
+
+static uint64_t reference_gcd(uint64_t a, uint64_t b)
+{
+    while (b != 0)
+    {
+        uint64_t rem = a % b;
+        a = b;
+        b = rem;
+    }
+    return a;
+}
+
+static bool fib_test(StringBuilder *error_builder)
+{
+    // Every Fibonacci number up to F(93) is exact
+    uint64_t prev = 1;
+    uint64_t curr = 0;
+    for (size_t n = 0; n < NUM_EXACT_FIB; n++)
+    {
+        if (int_fib(n) != (double)curr) ERROR("fib(%zu) is not exact.\n", n);
+        if (int_fib(-(double)n) != (n % 2 == 0 && n != 0 ? -(double)curr : (double)curr))
+        {
+            ERROR("fib(-%zu) has wrong sign or value.\n", n);
+        }
+        uint64_t next = prev + curr;
+        prev = curr;
+        curr = next;
+    }
+
+    // Fast doubling agrees with summation in double up to the largest finite value
+    double a = int_fib(NUM_EXACT_FIB - 2);
+    double b = int_fib(NUM_EXACT_FIB - 1);
+    for (size_t n = NUM_EXACT_FIB; n <= 1476; n++)
+    {
+        double next = a + b;
+        if (fabs(int_fib(n) - next) > 1e-13 * next) ERROR("fib(%zu) is off by more than rounding.\n", n);
+        a = b;
+        b = next;
+    }
+    if (int_fib(7.9) != 13) ERROR("fib does not truncate its argument.\n");
+    if (!isinf(int_fib(1477)) || !isinf(int_fib(1e300))) ERROR("fib does not overflow to infinity.\n");
+    if (int_fib(-1478) != -INFINITY) ERROR("fib of even negative number does not overflow to -infinity.\n");
+    if (!isnan(int_fib(NAN))) ERROR("fib(NaN) is not NaN.\n");
+    return true;
+}
+
+static bool gcd_test(StringBuilder *error_builder)
+{
+    for (size_t i = 0; i < NUM_GCD_CASES; i++)
+    {
+        // Shift to below 2^53 so that arguments are exact, multiply to have large common factors
+        uint64_t factor = random_u64() >> (40 + rand() % 24);
+        uint64_t a = (random_u64() >> (rand() % 64)) % ((1ull << 53) / (factor + 1)) * factor;
+        uint64_t b = (random_u64() >> (rand() % 64)) % ((1ull << 53) / (factor + 1)) * factor;
+        if (int_gcd(a, b) != (double)reference_gcd(a, b))
+        {
+            ERROR("gcd(%llu, %llu) is not %llu.\n",
+                (unsigned long long)a, (unsigned long long)b, (unsigned long long)reference_gcd(a, b));
+        }
+        if (int_gcd(-(double)a, b) != (double)reference_gcd(a, b)) ERROR("gcd does not ignore signs.\n");
+    }
+
+    if (int_gcd(0, 0) != 0 || int_gcd(0, 12) != 12 || int_gcd(12.7, 0) != 12) ERROR("gcd with zero is wrong.\n");
+    // Arguments beyond 2^64 use Euclid on doubles
+    if (int_gcd(ldexp(3, 100), ldexp(5, 90)) != ldexp(1, 90)) ERROR("gcd of large powers of two is wrong.\n");
+    if (int_gcd(1e300, 1) != 1) ERROR("gcd(1e300, 1) is not 1.\n");
+    if (!isnan(int_gcd(INFINITY, 2)) || !isnan(int_gcd(NAN, 2))) ERROR("gcd of non-finite number is not NaN.\n");
+
+    if (int_lcm(14, 24) != 168 || int_lcm(-4, 6) != 12) ERROR("lcm is wrong.\n");
+    if (int_lcm(0, 0) != 0) ERROR("lcm(0, 0) is not 0.\n");
+    if (int_lcm(ldexp(1, 60), ldexp(1, 62)) != ldexp(1, 62)) ERROR("lcm overflows in intermediate result.\n");
+    return true;
+}
+
+static bool factorial_test(StringBuilder *error_builder)
+{
+    // Factorials up to 22! are representable exactly, 18! and larger have trailing zeros in binary
+    uint64_t exact = 1;
+    for (size_t n = 0; n <= 20; n++)
+    {
+        if (n > 0) exact *= n;
+        if (int_factorial(n) != (double)exact) ERROR("%zu! is not exact.\n", n);
+    }
+    if (int_factorial(21) != int_factorial(20) * 21 || int_factorial(22) != int_factorial(21) * 22)
+    {
+        ERROR("21! or 22! is not exact.\n");
+    }
+    // Larger factorials are correctly rounded, thus close to lgamma
+    for (size_t n = 23; n <= 170; n++)
+    {
+        if (fabs(log(int_factorial(n)) - lgamma(n + 1)) > 1e-12 * lgamma(n + 1)) ERROR("%zu! is wrong.\n", n);
+    }
+
+    if (int_factorial(4.5) != 24) ERROR("Factorial does not truncate its argument.\n");
+    if (int_factorial(-3) != 1) ERROR("Factorial of negative number is not 1.\n");
+    if (!isinf(int_factorial(171)) || !isinf(int_factorial(INFINITY))) ERROR("171! is not infinity.\n");
+    if (!isnan(int_factorial(NAN))) ERROR("NaN! is not NaN.\n");
+    return true;
+}
+
+static bool binomial_test(StringBuilder *error_builder)
+{
+    // Every entry of Pascal's triangle up to row 67 fits in 64 bits
+    uint64_t row[NUM_PASCAL_ROWS] = { 1 };
+    for (size_t n = 0; n < NUM_PASCAL_ROWS; n++)
+    {
+        for (size_t k = n; k > 0; k--) row[k] += row[k - 1];
+        for (size_t k = 0; k <= n; k++)
+        {
+            if (int_binomial(n, k) != (double)row[k])
+            {
+                ERROR("%zu C %zu is not %llu.\n", n, k, (unsigned long long)row[k]);
+            }
+        }
+        if (int_binomial(n, n + 1) != 0) ERROR("%zu C %zu is not 0.\n", n, n + 1);
+    }
+
+    // Coefficients beyond 64 bits, expected values are correctly rounded
+    static const struct { double n; double k; double expected; } large[NUM_LARGE_BINOMIAL] = {
+        { 100, 50, 1.008913445455642e+29 },
+        { 1000, 20, 3.394828113024576e+41 },
+        { 1000, 500, 2.7028824094543655e+299 },
+        { 1000, 980, 3.394828113024576e+41 },
+        { 1e15, 2, 4.999999999999995e+29 }
+    };
+    for (size_t i = 0; i < NUM_LARGE_BINOMIAL; i++)
+    {
+        double res = int_binomial(large[i].n, large[i].k);
+        if (fabs(res - large[i].expected) > BINOMIAL_TOLERANCE * large[i].expected)
+        {
+            ERROR("%g C %g is %g instead of %g.\n", large[i].n, large[i].k, res, large[i].expected);
+        }
+    }
+    if (int_binomial(1e6, 3) != 166666166667000000.0) ERROR("1e6 C 3 is not exact.\n");
+    if (!isinf(int_binomial(1e5, 5e4))) ERROR("Huge binomial coefficient does not overflow to infinity.\n");
+    return true;
+}
+
+static const double special_values[NUM_SPECIAL_VALUES] = {
+    0.0, -0.0, INFINITY, -INFINITY, NAN, 4e-320, -1, DBL_MAX, 709.9, -745.5, 1e6, 1e300
+};
+
+// Error bounds of vector_math.h
+static const struct {
+    const char *name;
+    double max_ulp;
+} vmath_funcs[NUM_VMATH_FUNCS] = {
+    { "exp", 1 },
+    { "ln", 1 },
+    { "sin", 1 },
+    { "cos", 1 },
+    { "atan", 1 },
+    { "pow", 8 }
+};
+
+static double random_between(double min, double max)
+{
+    return min + (max - min) * ((double)rand() / RAND_MAX);
+}
+
+/*
+Returns: Distance of actual to expected in units in the last place of expected, infinity if only one is NaN or infinite
+*/
+static double ulp_distance(double actual, double expected)
+{
+    if (actual == expected || (isnan(actual) && isnan(expected))) return 0;
+    if (!isfinite(actual) || !isfinite(expected)) return INFINITY;
+    double ulp = nextafter(fabs(expected), INFINITY) - fabs(expected);
+    return fabs(actual - expected) / ulp;
+}
+
+// Writes random arguments of i-th function in ranges covered by kernels and libm, followed by special values
+static void get_vmath_args(size_t func, double *x, double *y)
+{
+    for (size_t i = 0; i < NUM_VMATH_VALUES - NUM_SPECIAL_VALUES; i++)
+    {
+        y[i] = random_between(-64, 64);
+        switch (func)
+        {
+            case 0:
+                x[i] = i % 2 == 0 ? random_between(-750, 750) : random_between(-1, 1);
+                break;
+            case 1:
+            case 5:
+                x[i] = i % 2 == 0 ? exp(random_between(-720, 720)) : random_between(0.5, 2);
+                break;
+            case 2:
+            case 3:
+                // Arguments close to multiples of pi/2 need an accurate reduction
+                x[i] = i % 3 == 0 ? random_between(-2e5, 2e5) : random_between(-10, 10);
+                if (i % 3 == 1) x[i] = (rand() % 60000) * 1.5707963267948966 + random_between(-1e-9, 1e-9);
+                break;
+            default:
+                x[i] = random_between(-3, 3) * pow(10, random_between(-8, 8));
+        }
+    }
+    for (size_t i = 0; i < NUM_SPECIAL_VALUES; i++)
+    {
+        x[NUM_VMATH_VALUES - NUM_SPECIAL_VALUES + i] = special_values[i];
+        y[NUM_VMATH_VALUES - NUM_SPECIAL_VALUES + i] = special_values[(i + 1) % NUM_SPECIAL_VALUES];
+    }
+}
+
+static void apply_vmath(size_t func, size_t n, const double *x, const double *y, double *out)
+{
+    switch (func)
+    {
+        case 0: vmath_exp(n, x, out); break;
+        case 1: vmath_ln(n, x, out); break;
+        case 2: vmath_sin(n, x, out); break;
+        case 3: vmath_cos(n, x, out); break;
+        case 4: vmath_atan(n, x, out); break;
+        default: vmath_pow(n, x, y, out);
+    }
+}
+
+static double apply_libm(size_t func, double x, double y)
+{
+    switch (func)
+    {
+        case 0: return exp(x);
+        case 1: return log(x);
+        case 2: return sin(x);
+        case 3: return cos(x);
+        case 4: return atan(x);
+        default: return pow(x, y);
+    }
+}
+
+/*
+Summary: Compares kernels of each supported instruction set with libm, signs of zeros must be the same
+*/
+static bool vmath_test(StringBuilder *error_builder)
+{
+    double *x = malloc(NUM_VMATH_VALUES * sizeof(double));
+    double *y = malloc(NUM_VMATH_VALUES * sizeof(double));
+    double *out = malloc(NUM_VMATH_VALUES * sizeof(double));
+    VmathLevel prev_level = vmath_get_level();
+
+    for (VmathLevel level = VMATH_SCALAR; level <= VMATH_AVX2; level++)
+    {
+        vmath_set_level(level);
+        if (vmath_get_level() != level) break; // Not supported by processor
+        for (size_t func = 0; func < NUM_VMATH_FUNCS; func++)
+        {
+            get_vmath_args(func, x, y);
+            apply_vmath(func, NUM_VMATH_VALUES, x, y, out);
+            for (size_t i = 0; i < NUM_VMATH_VALUES; i++)
+            {
+                double expected = apply_libm(func, x[i], y[i]);
+                double max_ulp = level == VMATH_SCALAR ? 0 : vmath_funcs[func].max_ulp;
+                if (ulp_distance(out[i], expected) > max_ulp || (!isnan(expected) && signbit(out[i]) != signbit(expected)))
+                {
+                    ERROR("%s(%.17g, %.17g) is %.17g instead of %.17g (level %d).\n",
+                        vmath_funcs[func].name, x[i], y[i], out[i], expected, level);
+                }
+            }
+
+            // Results are written in place
+            memcpy(out, x, NUM_VMATH_VALUES * sizeof(double));
+            apply_vmath(func, NUM_VMATH_VALUES, out, y, out);
+            for (size_t i = 0; i < NUM_VMATH_VALUES; i++)
+            {
+                double expected = apply_libm(func, x[i], y[i]);
+                if (ulp_distance(out[i], expected) > vmath_funcs[func].max_ulp)
+                {
+                    ERROR("%s is wrong when output is input (level %d).\n", vmath_funcs[func].name, level);
+                }
+            }
+        }
+    }
+
+    vmath_set_level(prev_level);
+    free(x);
+    free(y);
+    free(out);
+    return true;
+}
+
+bool kernels_test(StringBuilder *error_builder)
+{
+    return fib_test(error_builder)
+        && gcd_test(error_builder)
+        && factorial_test(error_builder)
+        && binomial_test(error_builder)
+        && vmath_test(error_builder);
+}
+
+Test get_kernels_test()
+{
+    return (Test){
+        kernels_test,
+        "Kernels"
+    };
+}
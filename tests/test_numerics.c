@@ -0,0 +1,332 @@
+#include <stdlib.h>
+#include <math.h>
+
+#include "../src/util/parallel.h"
+#include "../src/engine/parsing/parser.h"
+#include "../src/client/core/arith_context.h"
+#include "../src/client/core/arith_evaluation.h"
+#include "../src/client/core/series.h"
+#include "../src/client/core/integration.h"
+#include "../src/client/core/roots.h"
+#include "../src/client/core/montecarlo.h"
+#include "../src/client/core/grid.h"
+#include "test_numerics.h"
+
+#define NUM_WORKERS       4
+#define NUM_TERMS   1000000
+#define NUM_SAMPLES  200000
+#define PI          3.14159265358979323846
+#define STRBUILDER_STARTSIZE 16
+
+// Integrals with known values, including singularities at bounds and kinks
+#define NUM_INTEGRALS 7
+static const struct {
+    const char *integrand;
+    double a;
+    double b;
+    double tol;
+    double expected;
+} integrals[] = {
+    { "x^2",            0,   1,  1e-10, 1.0 / 3 },
+    { "sin(x)",         0,   PI, 1e-12, 2 },
+    { "exp(-(x^2))",    -10, 10, 1e-13, 1.7724538509055160273 },
+    { "1/sqrt(x)",      0,   1,  1e-10, 2 },
+    { "ln(x)",          0,   1,  1e-10, -1 },
+    { "abs(x - 1/3)",   0,   1,  1e-10, 5.0 / 18 },
+    { "x",              1,   0,  1e-10, -0.5 }
+};
+
+// Roots with initial guesses, found with and without derivative
+#define NUM_ROOTS 5
+static const struct {
+    const char *function;
+    double x0;
+    double expected;
+} roots[] = {
+    { "x^2 - 2",             1,   1.4142135623730951 },
+    { "cos(x) - x",          0,   0.7390851332151607 },
+    { "x^3 - 2 * x - 5",     100, 2.0945514815423265 },
+    { "exp(x) - 1000000",    0,   13.815510557964274 },
+    { "max(x, 1 - x) - 0.7", 0.1, 0.3 }
+};
+
+// Compiles expression with one variable or none if var is NULL
+static bool compile(const char *expr, const char *var, Program *out_program)
+{
+    Node *tree = parse_easy(g_ctx, expr);
+    if (tree == NULL) return false;
+    bool success = compile_program(tree, var == NULL ? 0 : 1, &var, out_program);
+    free_tree(tree);
+    return success;
+}
+
+static bool series_test(StringBuilder *error_builder)
+{
+    Program program, const_program, pole_program;
+    if (!compile("1/k^2", "k", &program) || !compile("0.1", "k", &const_program)
+        || !compile("1/(k-3000)", "k", &pole_program))
+    {
+        ERROR("Compilation of series failed\n");
+    }
+
+    // Sum is compensated and does not depend on number of workers
+    set_num_workers(NUM_WORKERS);
+    SeriesResult parallel = series_sum(&program, 1, NUM_TERMS);
+    SeriesResult constant = series_sum(&const_program, 1, NUM_TERMS);
+    SeriesResult pole = series_sum(&pole_program, 1, NUM_TERMS);
+    SeriesResult empty = series_sum(&program, 1, 0);
+    set_num_workers(1);
+    SeriesResult sequential = series_sum(&program, 1, NUM_TERMS);
+    if (parallel.error != LISTENERERR_SUCCESS || parallel.sum != sequential.sum
+        || fabs(parallel.sum - (PI * PI / 6 - 1.0 / NUM_TERMS)) > 1e-11)
+    {
+        ERROR("Wrong sum of series: %.17g (sequential: %.17g)\n", parallel.sum, sequential.sum);
+    }
+    if (constant.sum != NUM_TERMS / 10)
+    {
+        ERROR("Sum of constant series is not compensated: %.17g\n", constant.sum);
+    }
+    if (pole.error != LISTENERERR_DIVISION_BY_ZERO || pole.error_index != 2999)
+    {
+        ERROR("Wrong error of series: %d at index %g\n", pole.error, pole.error_index);
+    }
+    if (empty.error != LISTENERERR_SUCCESS || empty.sum != 0)
+    {
+        ERROR("Empty series does not sum to zero\n");
+    }
+
+    free_program(&program);
+    free_program(&const_program);
+    free_program(&pole_program);
+    return true;
+}
+
+static bool integration_test(StringBuilder *error_builder)
+{
+    for (size_t i = 0; i < NUM_INTEGRALS; i++)
+    {
+        Program program;
+        if (!compile(integrals[i].integrand, "x", &program))
+        {
+            ERROR("Compilation failed for: %s\n", integrals[i].integrand);
+        }
+
+        set_num_workers(NUM_WORKERS);
+        IntegrationResult parallel = integrate_program(&program, integrals[i].a, integrals[i].b, integrals[i].tol);
+        set_num_workers(1);
+        IntegrationResult sequential = integrate_program(&program, integrals[i].a, integrals[i].b, integrals[i].tol);
+        free_program(&program);
+
+        double tol = integrals[i].tol * (fabs(integrals[i].expected) > 1 ? fabs(integrals[i].expected) : 1);
+        if (parallel.eval_error != LISTENERERR_SUCCESS || !parallel.converged || parallel.error > tol
+            || fabs(parallel.integral - integrals[i].expected) > tol)
+        {
+            ERROR("Integral is %.17g (error %g) instead of %.17g for: %s\n",
+                parallel.integral, parallel.error, integrals[i].expected, integrals[i].integrand);
+        }
+        if (parallel.integral != sequential.integral || parallel.num_evaluations != sequential.num_evaluations)
+        {
+            ERROR("Integral depends on number of workers for: %s\n", integrals[i].integrand);
+        }
+    }
+
+    // Evaluation error at center of interval
+    Program pole_program;
+    compile("1/x", "x", &pole_program);
+    IntegrationResult pole = integrate_program(&pole_program, -1, 1, 1e-10);
+    if (pole.eval_error != LISTENERERR_DIVISION_BY_ZERO || pole.error_point != 0)
+    {
+        ERROR("Wrong error of integral: %d at %g\n", pole.eval_error, pole.error_point);
+    }
+
+    // Unreachable tolerance yields best estimate
+    IntegrationResult unreachable = integrate_program(&pole_program, 1, 2, 1e-30);
+    if (unreachable.converged || fabs(unreachable.integral - log(2)) > 1e-14)
+    {
+        ERROR("Unreachable tolerance has not been detected\n");
+    }
+    free_program(&pole_program);
+    return true;
+}
+
+static bool roots_test(StringBuilder *error_builder)
+{
+    for (size_t i = 0; i < NUM_ROOTS; i++)
+    {
+        Program program;
+        Program derivative;
+        Vector builder = strbuilder_create(STRBUILDER_STARTSIZE);
+        strbuilder_append(&builder, "deriv(%s, x)", roots[i].function);
+        if (!compile(roots[i].function, "x", &program))
+        {
+            ERROR("Compilation failed for: %s\n", roots[i].function);
+        }
+        // Forward mode knows no derivative of max, so Brent's method is used twice for it
+        bool has_derivative = compile(builder.buffer, "x", &derivative);
+        vec_destroy(&builder);
+
+        for (size_t j = 0; j < 2; j++)
+        {
+            RootResult result = find_root(&program, j == 0 && has_derivative ? &derivative : NULL, roots[i].x0);
+            if (!result.converged || fabs(result.root - roots[i].expected) > 4e-16 * fabs(roots[i].expected))
+            {
+                ERROR("Root is %.17g instead of %.17g (derivative: %d) for: %s\n",
+                    result.root, roots[i].expected, j == 0 && has_derivative, roots[i].function);
+            }
+        }
+        free_program(&program);
+        if (has_derivative) free_program(&derivative);
+    }
+
+    // Sign change at pole and function without root
+    const char *no_roots[] = { "1/x", "x^2 + 1" };
+    for (size_t i = 0; i < 2; i++)
+    {
+        Program program;
+        compile(no_roots[i], "x", &program);
+        RootResult result = find_root(&program, NULL, 1);
+        free_program(&program);
+        if (result.converged)
+        {
+            ERROR("Root %.17g has been found for: %s\n", result.root, no_roots[i]);
+        }
+    }
+    return true;
+}
+
+static bool montecarlo_test(StringBuilder *error_builder)
+{
+    Program dice;
+    Program pole;
+    if (!compile("rand(0, 6) + 1", NULL, &dice) || !compile("1 / rand(0, 2)", NULL, &pole))
+    {
+        ERROR("Compilation of random expressions failed\n");
+    }
+
+    // Results only depend on seed
+    set_num_workers(NUM_WORKERS);
+    MonteCarloResult parallel = monte_carlo(&dice, NUM_SAMPLES, 42);
+    MonteCarloResult other_seed = monte_carlo(&dice, NUM_SAMPLES, 43);
+    MonteCarloResult pole_result = monte_carlo(&pole, NUM_SAMPLES, 42);
+    set_num_workers(1);
+    MonteCarloResult sequential = monte_carlo(&dice, NUM_SAMPLES, 42);
+    if (parallel.mean != sequential.mean || parallel.variance != sequential.variance)
+    {
+        ERROR("Monte Carlo result depends on number of workers\n");
+    }
+    if (parallel.mean == other_seed.mean)
+    {
+        ERROR("Monte Carlo result does not depend on seed\n");
+    }
+
+    // Fair dice: mean 3.5, variance 35/12, mean is checked within 5 standard errors
+    if (parallel.error != LISTENERERR_SUCCESS
+        || fabs(parallel.mean - 3.5) > 5 * sqrt(35.0 / 12 / NUM_SAMPLES)
+        || fabs(parallel.variance - 35.0 / 12) > 0.05)
+    {
+        ERROR("Wrong mean %.17g or variance %.17g of dice\n", parallel.mean, parallel.variance);
+    }
+    if (pole_result.error != LISTENERERR_DIVISION_BY_ZERO)
+    {
+        ERROR("Division by zero in sample has not been reported\n");
+    }
+
+    free_program(&dice);
+    free_program(&pole);
+    return true;
+}
+
+// Collects results of grid and checks that they arrive in order
+typedef struct {
+    size_t next_cell;
+    double *results;
+    ListenerError *errors;
+} GridResults;
+
+static void collect_grid(size_t first_cell, size_t num_cells, const double *results,
+    const ListenerError *errors, void *context)
+{
+    GridResults *collected = (GridResults*)context;
+    if (first_cell != collected->next_cell) return;
+    for (size_t i = 0; i < num_cells; i++)
+    {
+        collected->results[first_cell + i] = results[i];
+        collected->errors[first_cell + i] = errors[i];
+    }
+    collected->next_cell += num_cells;
+}
+
+static bool grid_test(StringBuilder *error_builder)
+{
+    const GridAxis axes[] = {
+        { "x", 0, 1, 4 },
+        { "y", -1, 0.5, 5 },
+        { "z", 0, 0.001, 3000 }
+    };
+    const char *vars[] = { "x", "y", "z" };
+    Node *tree = parse_easy(g_ctx, "sin(x * y) + exp(y) * z + ln(x) / (y + 1)");
+    Program reference;
+    Grid grid;
+    if (tree == NULL || !compile_program(tree, 3, vars, &reference) || !grid_compile(tree, 3, axes, &grid))
+    {
+        ERROR("Compilation of grid failed\n");
+    }
+    free_tree(tree);
+    if (grid.num_cells != 60000 || grid.num_hoisted != 3)
+    {
+        ERROR("Grid has %zu cells and %zu hoisted subtrees\n", grid.num_cells, grid.num_hoisted);
+    }
+
+    // Hoisted evaluation yields same results as evaluation of whole expression per cell
+    GridResults collected = {
+        .next_cell = 0,
+        .results = malloc(grid.num_cells * sizeof(double)),
+        .errors = malloc(grid.num_cells * sizeof(ListenerError))
+    };
+    set_num_workers(NUM_WORKERS);
+    grid_evaluate(&grid, collect_grid, &collected);
+    if (collected.next_cell != grid.num_cells)
+    {
+        ERROR("Cells of grid have not been consumed in order\n");
+    }
+    for (size_t i = 0; i < grid.num_cells; i++)
+    {
+        double values[3];
+        double expected;
+        grid_cell_values(&grid, i, values);
+        ListenerError error = run_program(&reference, values, &expected);
+        if (error != collected.errors[i]
+            || (error == LISTENERERR_SUCCESS && fabs(expected - collected.results[i]) > 1e-12 * fabs(expected)))
+        {
+            ERROR("Wrong value of grid at (%g, %g, %g): %.17g instead of %.17g\n",
+                values[0], values[1], values[2], collected.results[i], expected);
+        }
+    }
+
+    free(collected.results);
+    free(collected.errors);
+    free_program(&reference);
+    grid_free(&grid);
+    return true;
+}
+
+/*
+Summary: Tests numeric commands (series, integrate, solve, montecarlo, grid tables) on results with known values
+    and checks that their results do not depend on number of workers
+*/
+bool numerics_test(StringBuilder *error_builder)
+{
+    size_t prev_workers = get_num_workers();
+    bool success = series_test(error_builder) && integration_test(error_builder) && roots_test(error_builder)
+        && montecarlo_test(error_builder) && grid_test(error_builder);
+    set_num_workers(prev_workers);
+    return success;
+}
+
+Test get_numerics_test()
+{
+    return (Test){
+        numerics_test,
+        "Numerics"
+    };
+}
@@ -0,0 +1,78 @@
+#include <stdlib.h>
+
+#include "../src/util/parallel.h"
+#include "test_parallel.h"
+
+#define NUM_CHUNKS     1000
+#define NUM_WORKERS       4
+#define WORK_PER_CHUNK 1000
+
+typedef struct {
+    double results[NUM_CHUNKS];
+    size_t next_expected; // Index of chunk that has to be consumed next
+    bool in_order;
+} Context;
+
+static void work(size_t chunk_index, void *context)
+{
+    Context *ctx = (Context*)context;
+    // Varying amount of work to let chunks finish out of order
+    double res = 0;
+    for (size_t i = 0; i < (chunk_index * 7919) % WORK_PER_CHUNK; i++) res += i;
+    ctx->results[chunk_index] = res + chunk_index;
+}
+
+static void consume(size_t chunk_index, void *context)
+{
+    Context *ctx = (Context*)context;
+    if (chunk_index != ctx->next_expected || ctx->results[chunk_index] < chunk_index) ctx->in_order = false;
+    ctx->next_expected++;
+}
+
+bool parallel_test(StringBuilder *error_builder)
+{
+    size_t prev_workers = get_num_workers();
+    set_num_workers(NUM_WORKERS);
+
+    // Case 1: Multiple threads
+    Context ctx = { .next_expected = 0, .in_order = true };
+    run_chunks_ordered(NUM_CHUNKS, NUM_WORKERS, work, consume, &ctx);
+    if (!ctx.in_order || ctx.next_expected != NUM_CHUNKS)
+    {
+        ERROR("Chunks have not been consumed in order\n");
+    }
+
+    // Case 2: Single thread
+    ctx = (Context){ .next_expected = 0, .in_order = true };
+    run_chunks_ordered(NUM_CHUNKS, 1, work, consume, &ctx);
+    if (!ctx.in_order || ctx.next_expected != NUM_CHUNKS)
+    {
+        ERROR("Chunks have not been consumed in order on single thread\n");
+    }
+
+    // Case 3: No chunks
+    ctx = (Context){ .next_expected = 0, .in_order = true };
+    run_chunks_ordered(0, NUM_WORKERS, work, consume, &ctx);
+    if (ctx.next_expected != 0)
+    {
+        ERROR("Consumer has been called without chunks\n");
+    }
+
+    // Case 4: Number of workers is clamped
+    set_num_workers(0);
+    if (get_num_workers() != 1)
+    {
+        ERROR("Number of workers has not been clamped\n");
+    }
+
+    set_num_workers(prev_workers);
+    return true;
+}
+
+Test get_parallel_test()
+{
+    return (Test){
+        parallel_test,
+        "Parallel"
+    };
+}
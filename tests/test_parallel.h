@@ -0,0 +1,4 @@
+#pragma once
+#include "test.h"
+
+Test get_parallel_test();
@@ -0,0 +1,198 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+
+#include "../src/util/console_util.h"
+#include "../src/engine/tree/tree_util.h"
+#include "../src/engine/tree/tree_to_string.h"
+#include "../src/engine/parsing/parser.h"
+#include "../src/client/core/arith_context.h"
+#include "../src/client/core/arith_evaluation.h"
+#include "../src/client/core/bytecode.h"
+#include "../src/client/core/plugins.h"
+#include "../src/client/simplification/propositional_context.h"
+#include "test_plugin.h"
+
+#define PATH_SIZE    64
+#define COMMAND_SIZE 256
+#define NUM_ROWS     1000
+
+// Operators of second plugin are never added since one of them clashes with an operator of the first plugin
+static const char *plugin_sources[] = {
+    "#include <math.h>\n"
+    "#include \"plugin_api.h\"\n"
+    "static int eval_hyp(size_t n, const double *a, double *out)\n"
+    "{ (void)n; *out = sqrt(a[0] * a[0] + a[1] * a[1]); return PLUGIN_SUCCESS; }\n"
+    "static void batch_hyp(size_t rows, size_t n, const double **c, double *out, int *err)\n"
+    "{ (void)n; for (size_t r = 0; r < rows; r++) { out[r] = sqrt(c[0][r] * c[0][r] + c[1][r] * c[1][r]); err[r] = 0; } }\n"
+    "static int eval_recip(size_t n, const double *a, double *out)\n"
+    "{ (void)n; if (a[0] == 0) return PLUGIN_DIVISION_BY_ZERO; *out = 1 / a[0]; return PLUGIN_SUCCESS; }\n"
+    "static int eval_count(size_t n, const double *a, double *out)\n"
+    "{ (void)a; *out = (double)n; return PLUGIN_SUCCESS; }\n"
+    "static const PluginOperator ops[] = {\n"
+    "    { \"plughyp\", PLUGIN_PLACE_FUNCTION, 2, 0, PLUGIN_ASSOC_LEFT, eval_hyp, batch_hyp },\n"
+    "    { \"plugrecip\", PLUGIN_PLACE_FUNCTION, 1, 0, PLUGIN_ASSOC_LEFT, eval_recip, NULL },\n"
+    "    { \"plugcount\", PLUGIN_PLACE_FUNCTION, PLUGIN_DYNAMIC_ARITY, 0, PLUGIN_ASSOC_LEFT, eval_count, NULL }\n"
+    "};\n"
+    "const PluginDescription ccalc_plugin = { PLUGIN_API_VERSION, 3, ops };\n",
+
+    "#include \"plugin_api.h\"\n"
+    "static int eval(size_t n, const double *a, double *out) { (void)n; (void)a; *out = 0; return 0; }\n"
+    "static const PluginOperator ops[] = {\n"
+    "    { \"plugnew\", PLUGIN_PLACE_FUNCTION, 1, 0, PLUGIN_ASSOC_LEFT, eval, NULL },\n"
+    "    { \"plughyp\", PLUGIN_PLACE_FUNCTION, 2, 0, PLUGIN_ASSOC_LEFT, eval, NULL }\n"
+    "};\n"
+    "const PluginDescription ccalc_plugin = { PLUGIN_API_VERSION, 2, ops };\n"
+};
+
+#define NUM_EXPRESSIONS 4
+static const struct {
+    const char *expr;
+    double x;
+    ListenerError error;
+    double result;
+} expressions[] = {
+    { "plughyp(x, 4) + 1", 3, LISTENERERR_SUCCESS, 6 },
+    { "plugrecip(x) * 2", 4, LISTENERERR_SUCCESS, 0.5 },
+    { "plugrecip(x - 2)", 2, LISTENERERR_DIVISION_BY_ZERO, 0 },
+    { "plugcount(x, x, x)", 1, LISTENERERR_SUCCESS, 3 }
+};
+
+static bool build_plugin(const char *dir, size_t index, char *out_path)
+{
+    char source_path[PATH_SIZE];
+    char command[COMMAND_SIZE];
+    sprintf(source_path, "%s/plugin%zu.c", dir, index);
+    sprintf(out_path, "%s/plugin%zu.so", dir, index);
+
+    FILE *file = fopen(source_path, "w");
+    if (file == NULL) return false;
+    fputs(plugin_sources[index], file);
+    fclose(file);
+
+    sprintf(command, "cc -std=c99 -Wall -Wextra -Werror -shared -fPIC -I./src/client/core -o %s %s -lm",
+        out_path, source_path);
+    bool res = system(command) == 0;
+    remove(source_path);
+    return res;
+}
+
+/*
+Summary: Compares column-at-a-time evaluation of a program with plugin operators with row-by-row evaluation
+*/
+static bool check_batch(StringBuilder *error_builder, const char *expr)
+{
+    Node *tree = parse_easy(g_ctx, expr);
+    Program program;
+    const char *var_names[] = { "x" };
+    if (!compile_program(tree, 1, var_names, &program))
+    {
+        ERROR("Compilation failed for: %s\n", expr);
+    }
+
+    double column[NUM_ROWS];
+    const double *columns[] = { column };
+    double results[NUM_ROWS];
+    ListenerError errors[NUM_ROWS];
+    for (size_t i = 0; i < NUM_ROWS; i++) column[i] = (double)(i % 7) - 3;
+    run_program_batch(&program, NUM_ROWS, columns, results, errors);
+
+    for (size_t i = 0; i < NUM_ROWS; i++)
+    {
+        double expected = 0;
+        ListenerError expected_err = run_program(&program, &column[i], &expected);
+        if (expected_err != errors[i] || (expected_err == LISTENERERR_SUCCESS && expected != results[i]))
+        {
+            ERROR("Batch result differs in row %zu for: %s\n", i, expr);
+        }
+    }
+    free_program(&program);
+    free_tree(tree);
+    return true;
+}
+
+/*
+Summary: Builds plugins with C compiler of system, loads them and evaluates their operators
+    by tree_reduce, by compiled programs and column-at-a-time
+    Skipped when there is no C compiler
+*/
+bool plugin_test(StringBuilder *error_builder)
+{
+    if (system("cc --version > /dev/null 2>&1") != 0) return true;
+
+    char dir[] = "/tmp/ccalc_pluginXXXXXX";
+    if (mkdtemp(dir) == NULL)
+    {
+        ERROR("Could not create temporary directory\n");
+    }
+    char paths[2][PATH_SIZE];
+    for (size_t i = 0; i < 2; i++)
+    {
+        if (!build_plugin(dir, i, paths[i]))
+        {
+            ERROR("Plugin %zu does not compile\n", i);
+        }
+    }
+
+    if (load_plugin(paths[0]) != 3)
+    {
+        ERROR("Loading plugin failed\n");
+    }
+    bool interactive = set_interactive(false);
+    ssize_t clashing_count = load_plugin(paths[1]);
+    ssize_t missing_count = load_plugin("/nonexistent/plugin.so");
+    set_interactive(interactive);
+    if (clashing_count != -1 || missing_count != -1)
+    {
+        ERROR("Loading clashing or missing plugin succeeded\n");
+    }
+    if (ctx_lookup_op(g_ctx, "plugnew", OP_PLACE_FUNCTION) != NULL)
+    {
+        ERROR("Operator of clashing plugin has been added\n");
+    }
+
+    for (size_t i = 0; i < NUM_EXPRESSIONS; i++)
+    {
+        Node *tree = parse_easy(g_ctx, expressions[i].expr);
+        if (tree == NULL)
+        {
+            ERROR("Parser error for: %s\n", expressions[i].expr);
+        }
+        Node *value = malloc_constant_node(expressions[i].x, 0);
+        replace_variable_nodes(&tree, value, "x");
+        free_tree(value);
+
+        double result = 0;
+        ListenerError err = tree_reduce(tree, arith_op_evaluate, &result, NULL);
+        if (err != expressions[i].error || (err == LISTENERERR_SUCCESS && result != expressions[i].result))
+        {
+            ERROR("Wrong result %.17g (error %d) for: %s\n", result, err, expressions[i].expr);
+        }
+        free_tree(tree);
+
+        if (!check_batch(error_builder, expressions[i].expr)) return false;
+    }
+
+    // Operators of propositional context have ids that can belong to plugin operators in g_ctx
+    const Operator *prop_op = ctx_lookup_op(g_propositional_ctx, "==", OP_PLACE_INFIX);
+    const Operator *plugin_op = ctx_lookup_op(g_ctx, "plughyp", OP_PLACE_FUNCTION);
+    if (is_plugin_op(prop_op) || !is_plugin_op(plugin_op) || get_plugin_op(plugin_op->id) == NULL)
+    {
+        ERROR("Operators of plugins not told apart from other operators\n");
+    }
+
+    for (size_t i = 0; i < 2; i++) remove(paths[i]);
+    rmdir(dir);
+    return true;
+}
+
+Test get_plugin_test()
+{
+    return (Test){
+        plugin_test,
+        "Plugin"
+    };
+}
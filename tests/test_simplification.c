@@ -8,7 +8,12 @@
 #include "../src/engine/parsing/parser.h"
 #include "../src/client/core/arith_context.h"
 #include "../src/client/core/arith_evaluation.h"
+#include "../src/client/core/bytecode.h"
+#include "../src/client/core/gradient.h"
 #include "../src/client/simplification/simplification.h"
+#include "../src/client/commands/commands.h"
+#include "../src/util/console_util.h"
+#include "../src/util/governor.h"
 #include "test_simplification.h"
 
 static const size_t NUM_CASES = 20;
@@ -37,6 +42,230 @@ const char *cases[] = {
     "(x+y-y)'",            "1",
 };
 
+// Each level calls the previous one twice, expanded right hand sides would grow exponentially
+#define NUM_NESTED_LEVELS 16
+
+static bool exec(const char *command)
+{
+    char buffer[100];
+    strcpy(buffer, command);
+    return exec_command(buffer);
+}
+
+/*
+Summary: Checks that calls of user-defined functions are evaluated without expanding them,
+    unless the result is not constant or a derivative is taken
+*/
+static bool functions_test(StringBuilder *error_builder)
+{
+    bool interactive = set_interactive(false);
+    exec("nesta(x) = x + 1");
+    for (size_t i = 1; i < NUM_NESTED_LEVELS; i++)
+    {
+        char definition[100];
+        sprintf(definition, "nest%c(x) = nest%c(x) + nest%c(x + 1)", (char)('a' + i), (char)('a' + i - 1), (char)('a' + i - 1));
+        if (!exec(definition))
+        {
+            ERROR("Definition failed: %s\n", definition);
+        }
+    }
+    set_interactive(interactive);
+
+    // Nesting 2^15 calls with arguments 1, ..., 16 yields 2^15 * (1 + 15/2 + 1)
+    char constant_input[] = "nestp(1)";
+    char symbolic_input[] = "nestb(x)'";
+    Node *constant = NULL;
+    Node *symbolic = NULL;
+    if (!arith_parse_symbolic(constant_input, 0, &constant) || get_type(constant) != NTYPE_CONSTANT
+        || get_const_value(constant) != 32768 * 9.5)
+    {
+        ERROR("Wrong result of nested calls\n");
+    }
+    if (!arith_parse_symbolic(symbolic_input, 0, &symbolic)
+        || get_type(symbolic) != NTYPE_CONSTANT || get_const_value(symbolic) != 2)
+    {
+        ERROR("Derivative of call not computed\n");
+    }
+    free_tree(constant);
+    free_tree(symbolic);
+
+    const Operator *nestp = ctx_lookup_op(g_ctx, "nestp", OP_PLACE_FUNCTION);
+    const Operator *nesto = ctx_lookup_op(g_ctx, "nesto", OP_PLACE_FUNCTION);
+    if (find_op((const Node**)&get_composite_function(nestp)->after, nesto) == NULL)
+    {
+        ERROR("Right hand side has been expanded\n");
+    }
+
+    // Cached results are the same, calls of lower levels repeat arguments
+    for (size_t i = 0; i < NUM_NESTED_LEVELS; i++)
+    {
+        char name[] = "nesta";
+        name[4] = (char)('a' + i);
+        set_composite_memo(ctx_lookup_op(g_ctx, name, OP_PLACE_FUNCTION), 8);
+    }
+    char cached_input[] = "nestp(1)";
+    if (!arith_parse_symbolic(cached_input, 0, &constant) || get_const_value(constant) != 32768 * 9.5)
+    {
+        ERROR("Wrong result of nested calls with cached results\n");
+    }
+    free_tree(constant);
+    if (get_composite_memo(ctx_lookup_op(g_ctx, "nestb", OP_PLACE_FUNCTION))->hits == 0)
+    {
+        ERROR("No cached result has been used\n");
+    }
+    interactive = set_interactive(false);
+    exec("nestrand(x) = rand(1, x)");
+    set_interactive(interactive);
+    if (set_composite_memo(ctx_lookup_op(g_ctx, "nestrand", OP_PLACE_FUNCTION), 8))
+    {
+        ERROR("Results of impure function are cached\n");
+    }
+
+    // Derivatives that are evaluated numerically are kept and computed in forward mode
+    char numeric_input[] = "(nestc(x) * x)'";
+    char two_vars_input[] = "deriv(x * y, y)";
+    Node *numeric = NULL;
+    Node *two_vars = NULL;
+    Program program;
+    const char *var = "x";
+    double x = 1.5;
+    double result = 0;
+    if (!arith_parse(numeric_input, 0, &numeric)
+        || find_op((const Node**)&numeric, ctx_lookup_op(g_ctx, "deriv", OP_PLACE_FUNCTION)) == NULL
+        || !compile_program(numeric, 1, &var, &program))
+    {
+        ERROR("Derivative to evaluate numerically has not been kept\n");
+    }
+    // (4x + 8)x has derivative 8x + 8
+    if (run_program(&program, &x, &result) != LISTENERERR_SUCCESS || result != 20)
+    {
+        ERROR("Wrong result of derivative in forward mode: %.17g\n", result);
+    }
+    free_program(&program);
+    free_tree(numeric);
+    // Result would depend on y, which is not bound, thus the derivative rules are used
+    if (!arith_parse(two_vars_input, 0, &two_vars)
+        || get_type(two_vars) != NTYPE_VARIABLE || strcmp(get_var_name(two_vars), "x") != 0)
+    {
+        ERROR("Derivative in two variables has not been simplified\n");
+    }
+    free_tree(two_vars);
+
+    // All partial derivatives in one sweep, calls are followed instead of expanded
+    interactive = set_interactive(false);
+    exec("nestgrad(x, y) = nestc(x * y) + y^2 / x");
+    set_interactive(interactive);
+    RewriteRule *nestgrad = get_composite_function(ctx_lookup_op(g_ctx, "nestgrad", OP_PLACE_FUNCTION));
+    const char *params[] = { "x", "y" };
+    double gradient[2];
+    // (4xy + 8) + y^2/x at (2, 3): value 36.5, partials 12 - 9/4 and 8 + 3
+    if (tree_gradient(nestgrad->after, 2, params, (double[]){ 2, 3 }, &result, gradient) != LISTENERERR_SUCCESS
+        || result != 36.5 || gradient[0] != 9.75 || gradient[1] != 11)
+    {
+        ERROR("Wrong gradient: %.17g, %.17g\n", gradient[0], gradient[1]);
+    }
+
+    // Callers get right hand side of removed function
+    char clear_input[] = "clear nesta";
+    exec_command(clear_input);
+    Node *call = parse_easy(g_ctx, "nestc(2)");
+    if (arith_evaluate(call) != 16)
+    {
+        ERROR("Wrong result after callee has been removed\n");
+    }
+    free_tree(call);
+    clear_composite_functions();
+    return true;
+}
+
+/*
+Summary: Checks that rewriting stops with a partially simplified tree when steps are exhausted,
+    and that evaluation fails when nodes or time are exhausted or command is cancelled
+*/
+static bool budget_test(StringBuilder *error_builder)
+{
+    Budget budget = governor_get_budget();
+    governor_set_budget((Budget){ .max_rewrite_steps = 2 });
+    governor_begin();
+    Node *partial = parse_easy(g_ctx, "x+x+x+x+x");
+    Node *complete = parse_easy(g_ctx, "5x");
+    if (simplify(&partial, NULL) != LISTENERERR_SUCCESS || governor_get_state() != BUDGET_STEPS_EXHAUSTED
+        || tree_equals(partial, complete))
+    {
+        ERROR("Simplification did not stop when rewrite steps were exhausted\n");
+    }
+    governor_end();
+    free_tree(partial);
+    free_tree(complete);
+
+    governor_set_budget((Budget){ .max_nodes = 2 });
+    governor_begin();
+    Node *sum = parse_easy(g_ctx, "1+2+3");
+    double result = 0;
+    if (tree_reduce(sum, arith_op_evaluate, &result, NULL) != LISTENERERR_BUDGET_EXCEEDED
+        || governor_get_state() != BUDGET_NODES_EXHAUSTED)
+    {
+        ERROR("Evaluation did not fail when nodes were exhausted\n");
+    }
+    governor_end();
+
+    // Budget is only enforced while a command is governed
+    if (governor_get_state() != BUDGET_AVAILABLE
+        || tree_reduce(sum, arith_op_evaluate, &result, NULL) != LISTENERERR_SUCCESS || result != 6)
+    {
+        ERROR("Budget was enforced outside of command\n");
+    }
+
+    // Cancellation stops evaluation until command ends
+    governor_begin();
+    Program program;
+    compile_program(sum, 0, NULL, &program);
+    if (!governor_cancel() || run_program(&program, NULL, &result) != LISTENERERR_BUDGET_EXCEEDED
+        || tree_reduce(sum, arith_op_evaluate, &result, NULL) != LISTENERERR_BUDGET_EXCEEDED
+        || governor_get_state() != BUDGET_CANCELLED)
+    {
+        ERROR("Evaluation did not stop when command was cancelled\n");
+    }
+    governor_end();
+    if (governor_cancel() || run_program(&program, NULL, &result) != LISTENERERR_SUCCESS || result != 6)
+    {
+        ERROR("Cancellation outlived command\n");
+    }
+
+    // Nested commands are cancelled with outermost command
+    governor_begin();
+    governor_begin();
+    governor_cancel();
+    governor_end();
+    bool nested_stopped = governor_is_stopped();
+    governor_end();
+    if (!nested_stopped || governor_is_stopped())
+    {
+        ERROR("Cancellation did not end with outermost command\n");
+    }
+
+    // Time is checked by compiled and batch evaluation, clock is only read now and then
+    governor_set_budget((Budget){ .max_seconds = 1e-9 });
+    governor_begin();
+    ListenerError error = LISTENERERR_SUCCESS;
+    for (size_t i = 0; i < 10000 && error == LISTENERERR_SUCCESS; i++)
+    {
+        error = run_program(&program, NULL, &result);
+    }
+    ListenerError batch_error = LISTENERERR_SUCCESS;
+    run_program_batch(&program, 1, NULL, &result, &batch_error);
+    if (error != LISTENERERR_BUDGET_EXCEEDED || batch_error != LISTENERERR_BUDGET_EXCEEDED
+        || governor_get_state() != BUDGET_TIME_EXHAUSTED)
+    {
+        ERROR("Evaluation did not stop when time was exhausted\n");
+    }
+    governor_end();
+    free_program(&program);
+    free_tree(sum);
+    governor_set_budget(budget);
+    return true;
+}
+
 bool simplification_test(StringBuilder *error_builder)
 {
     if (!simplification_is_initialized())
@@ -83,6 +312,9 @@ bool simplification_test(StringBuilder *error_builder)
         free_tree(right);
     }
 
+    if (!functions_test(error_builder)) return false;
+    if (!budget_test(error_builder)) return false;
+
     // Fuzzer test to detect illegal simplification rules
     /*for (size_t i = 0; i < NUM_FUZZER_CASES; i++)
     {